@@ -8,6 +8,7 @@ import serial
 import serial.tools.list_ports
 
 from .arghdlc import Framer, Deframer
+from .packets import GoertzelResultPacket, BenchStatsPacket
 
 class ArgaliTarget:
     '''A tethered Argali device, intended for your EOL station
@@ -32,6 +33,12 @@ class ArgaliTarget:
         
         self.adc_cb = None
         self.adc_buf = bytes()
+
+        self.goertzel_cb = None
+        self.pending_goertzel_buffers = 0
+
+        self.bench_cb = None
+        self.pending_bench = False
         
         self.pending_echo = False
         self.pending_dac = False
@@ -164,7 +171,7 @@ class ArgaliTarget:
         self.logline_cb = cb
         
     def pending_input(self):
-        if self.pending_echo or self.pending_dac or (self.pending_adc_bytes > 0):
+        if self.pending_echo or self.pending_dac or (self.pending_adc_bytes > 0) or (self.pending_goertzel_buffers > 0) or self.pending_bench:
             return True
 
     def tx(self, bs):
@@ -225,6 +232,8 @@ class ArgaliTarget:
             ord('E'): self._echo_rx,
             ord('D'): self._dac_rx,
             ord('A'): self._adc_rx,
+            ord('G'): self._goertzel_rx,
+            ord('B'): self._bench_rx,
             }
 
         family = f.payload[0]
@@ -337,6 +346,52 @@ class ArgaliTarget:
                         print(f'{i:4d}: {self.adc_buf[i:i+16].hex()}')
                 
 
+    def set_goertzel_cb(self, cb):
+        '''Set the callback for Goertzel results
+
+        This is called with a GoertzelResultPacket for every buffer
+        analyzed in a Goertzel run.
+        '''
+        self.goertzel_cb = cb
+
+    def _goertzel_rx(self, f):
+        '''Handles inbound Goertzel result packets'''
+
+        payload = f.payload
+        if payload[1] != ord('r'):
+            return self._unknown_family(f)
+
+        result = GoertzelResultPacket.unpack(payload)
+        self.pending_goertzel_buffers -= 1
+
+        if self.goertzel_cb:
+            self.goertzel_cb(result)
+        else:
+            print(f'Goertzel buffer {result.buffer_no}: {result.amplitudes}')
+
+    def set_bench_cb(self, cb):
+        '''Set the callback for benchmark results
+
+        This is called with a BenchStatsPacket in response to each
+        BenchQueryPacket.
+        '''
+        self.bench_cb = cb
+
+    def _bench_rx(self, f):
+        '''Handles inbound benchmark packets'''
+
+        payload = f.payload
+        if payload[1] != ord('q'):
+            return self._unknown_family(f)
+
+        stats = BenchStatsPacket.unpack(payload)
+        self.pending_bench = False
+
+        if self.bench_cb:
+            self.bench_cb(stats)
+        else:
+            print(f'ADC callback: {stats.count} calls, {stats.min_cycles}/{stats.avg_cycles}/{stats.max_cycles} cycles min/avg/max')
+
     def idle(self, n):
         self.tx(b'~' * n)
 
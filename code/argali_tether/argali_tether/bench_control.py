@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+
+# Times the on-device DTMF decoder, as run from the ADC ISR
+
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from argali_tether.argali_target import ArgaliTarget
+from argali_tether.packets import *
+
+# Get the default argali argument parser
+parser = ArgaliTarget.argparser()
+
+parser.add_argument("--run", help="Run the DTMF decoder on the ADC (needs the ADC args)", action="store_true")
+parser.add_argument("--wait", help="Seconds to let the run go before querying (default 2)", type=float, default=2.0)
+parser.add_argument("--query", help="Fetch the ADC callback timings", action="store_true")
+
+BenchDTMFPacket.add_arguments(parser)
+BenchQueryPacket.add_arguments(parser)
+
+args = parser.parse_args()
+tgt = ArgaliTarget.from_args(args)
+
+def logline(f):
+    payload = f.payload
+    decoded = f'  Log: {payload.decode("iso8859-1")}'
+    l = decoded
+    print(l)
+
+def bench_cb(stats):
+    print(f'{stats.count} callbacks at {stats.cpu_hz/1e6:.0f}MHz:')
+    for name, cycles in [("min", stats.min_cycles), ("avg", stats.avg_cycles), ("max", stats.max_cycles)]:
+        line = f'  {name}: {cycles:8d} cycles {stats.us(cycles):9.1f}us'
+        if args.run:
+            n_samples = args.num_points * len(sum(args.channels, []))
+            line += f' {1000*stats.us(cycles)/n_samples:8.1f}ns/sample'
+        print(line)
+
+
+tgt.register_logline_cb(logline)
+tgt.set_bench_cb(bench_cb)
+
+if not (args.run or args.query):
+    print("Need --run (with its args) and/or --query")
+    sys.exit(1)
+
+if args.run:
+    tgt.queue_packet(BenchDTMFPacket.from_args(args))
+
+    while tgt.pending_frames:
+        tgt.poll()
+        time.sleep(0.01)
+
+    time.sleep(args.wait)
+
+if args.query:
+    if args.reset is None:
+        args.reset = 0
+    tgt.pending_bench = True
+    tgt.queue_packet(BenchQueryPacket.from_args(args))
+
+while tgt.pending_frames or tgt.pending_bench:
+    tgt.poll()
+    time.sleep(0.01)
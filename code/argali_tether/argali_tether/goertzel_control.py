@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+
+# Runs the on-device Goertzel bank against the ADC
+
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from argali_tether.argali_target import ArgaliTarget
+from argali_tether.packets import *
+
+# Get the default argali argument parser
+parser = ArgaliTarget.argparser()
+
+parser.add_argument("--configure", help="Set the Goertzel frequencies (needs --freqs)", action="store_true")
+parser.add_argument("--run", help="Run the Goertzel bank on the ADC (needs the ADC args)", action="store_true")
+
+GoertzelConfigPacket.add_arguments(parser)
+GoertzelRunPacket.add_arguments(parser)
+
+args = parser.parse_args()
+tgt = ArgaliTarget.from_args(args)
+
+def logline(f):
+    payload = f.payload
+    decoded = f'  Log: {payload.decode("iso8859-1")}'
+    l = decoded
+    print(l)
+
+def goertzel_cb(result):
+    for ch, amplitudes in enumerate(result.amplitudes):
+        amps = " ".join(f'{a:8.2f}' for a in amplitudes)
+        print(f'{result.buffer_no:4d} ch{ch}: {amps}')
+
+
+tgt.register_logline_cb(logline)
+tgt.set_goertzel_cb(goertzel_cb)
+
+if not (args.configure or args.run):
+    print("Need --configure and/or --run (with their args)")
+    sys.exit(1)
+
+if args.configure:
+    tgt.queue_packet(GoertzelConfigPacket.from_args(args))
+
+if args.run:
+    pkt = GoertzelRunPacket.from_args(args)
+    tgt.pending_goertzel_buffers = pkt.num_buffers
+    tgt.queue_packet(pkt)
+
+while tgt.pending_frames or tgt.pending_goertzel_buffers > 0:
+    tgt.poll()
+    time.sleep(0.01)
@@ -2,3 +2,5 @@ from .sys_packets import *
 from .echo_packets import *
 from .dac_packets import *
 from .adc_packets import *
+from .goertzel_packets import *
+from .bench_packets import *
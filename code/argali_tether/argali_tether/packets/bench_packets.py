@@ -0,0 +1,66 @@
+from .packet_base import PacketBase, PacketFieldTypes, PacketField
+
+class BenchDTMFPacket(PacketBase):
+    '''Run the on-device DTMF decoder on num_buffers ADC buffers
+
+    The ADC parameters are as in GoertzelRunPacket.  backend is 0 for
+    floating point and 1 for fixed point, and window_len/hop set up
+    streaming mode (0 for one window per buffer).  Nothing comes back
+    from the run itself: send a BenchQueryPacket afterwards to get the
+    timings.
+    '''
+    PACKET_FAMILY = 'B'
+    PACKET_TYPE = 'D'
+
+    @classmethod
+    def fields(cls):
+        return [
+            PacketField("prescaler", PacketFieldTypes.UINT16_T),
+            PacketField("period", PacketFieldTypes.UINT32_T),
+            PacketField("num_points", PacketFieldTypes.UINT16_T),
+            PacketField("sample_width", PacketFieldTypes.UINT8_T),
+            PacketField("sample_time", PacketFieldTypes.UINT16_T),
+            PacketField("num_buffers", PacketFieldTypes.UINT16_T),
+            PacketField("backend", PacketFieldTypes.UINT8_T),
+            PacketField("window_len", PacketFieldTypes.UINT16_T),
+            PacketField("hop", PacketFieldTypes.UINT16_T),
+            PacketField("channels", PacketFieldTypes.UINT8_T,
+                        length=None,
+                        lengthtype=PacketFieldTypes.UINT8_T),
+            ]
+
+
+class BenchQueryPacket(PacketBase):
+    '''Ask for the cycle counts of the ADC callback
+
+    If reset is nonzero, the counts are cleared after being read.
+    The target replies with a BenchStatsPacket.
+    '''
+    PACKET_FAMILY = 'B'
+    PACKET_TYPE = 'Q'
+
+    @classmethod
+    def fields(cls):
+        return [
+            PacketField("reset", PacketFieldTypes.UINT8_T),
+            ]
+
+
+class BenchStatsPacket(PacketBase):
+    '''Cycles spent in the ADC callback, since the last ADC setup or reset'''
+    PACKET_FAMILY = 'B'
+    PACKET_TYPE = 'q'
+
+    @classmethod
+    def fields(cls):
+        return [
+            PacketField("count", PacketFieldTypes.UINT32_T),
+            PacketField("min_cycles", PacketFieldTypes.UINT32_T),
+            PacketField("avg_cycles", PacketFieldTypes.UINT32_T),
+            PacketField("max_cycles", PacketFieldTypes.UINT32_T),
+            PacketField("cpu_hz", PacketFieldTypes.UINT32_T),
+            ]
+
+    def us(self, cycles):
+        '''Convert a cycle count from this packet to microseconds'''
+        return 1e6 * cycles / self.cpu_hz
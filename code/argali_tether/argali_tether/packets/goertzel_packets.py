@@ -0,0 +1,74 @@
+import struct
+
+from .packet_base import PacketBase, PacketFieldTypes, PacketField
+
+class GoertzelConfigPacket(PacketBase):
+    '''Set the frequencies the on-device Goertzel bank watches
+
+    This only stashes the frequencies on the target: the filters
+    themselves get set up when a GoertzelRunPacket comes in, since
+    they depend on the ADC sample rate.
+    '''
+    PACKET_FAMILY = 'G'
+    PACKET_TYPE = 'C'
+
+    @classmethod
+    def fields(cls):
+        return [
+            PacketField("freqs", PacketFieldTypes.FLOAT,
+                        length=None,
+                        lengthtype=PacketFieldTypes.UINT8_T),
+            ]
+
+
+class GoertzelRunPacket(PacketBase):
+    '''Capture num_buffers ADC buffers, and run the Goertzel bank on each
+
+    The ADC parameters are as in ADCConfigPacket, with num_points
+    being the number of samples per channel in each buffer.  The
+    target sends back one GoertzelResultPacket per buffer.
+    '''
+    PACKET_FAMILY = 'G'
+    PACKET_TYPE = 'R'
+
+    @classmethod
+    def fields(cls):
+        return [
+            PacketField("prescaler", PacketFieldTypes.UINT16_T),
+            PacketField("period", PacketFieldTypes.UINT32_T),
+            PacketField("num_points", PacketFieldTypes.UINT16_T),
+            PacketField("sample_width", PacketFieldTypes.UINT8_T),
+            PacketField("sample_time", PacketFieldTypes.UINT16_T),
+            PacketField("num_buffers", PacketFieldTypes.UINT16_T),
+            PacketField("channels", PacketFieldTypes.UINT8_T,
+                        length=None,
+                        lengthtype=PacketFieldTypes.UINT8_T),
+            ]
+
+
+class GoertzelResultPacket(PacketBase):
+    '''The amplitudes from one buffer of a Goertzel run
+
+    amplitudes is a list with one list per channel, each with one
+    amplitude (in ADC counts) per configured frequency.
+    '''
+    PACKET_FAMILY = 'G'
+    PACKET_TYPE = 'r'
+
+    @classmethod
+    def fields(cls):
+        return [
+            PacketField("buffer_no", PacketFieldTypes.UINT16_T),
+            PacketField("n_channels", PacketFieldTypes.UINT8_T),
+            PacketField("n_bins", PacketFieldTypes.UINT8_T),
+            ]
+
+    @classmethod
+    def unpack(cls, buf):
+        '''Unpack a result, whose amplitudes aren't length-prefixed'''
+        buffer_no, n_channels, n_bins = struct.unpack(">HBB", buf[2:6])
+        flat = struct.unpack(f'>{n_channels*n_bins}f', buf[6:6+4*n_channels*n_bins])
+        amplitudes = [list(flat[ch*n_bins:(ch+1)*n_bins]) for ch in range(n_channels)]
+
+        return cls(buffer_no=buffer_no, n_channels=n_channels, n_bins=n_bins,
+                   amplitudes=amplitudes)
@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 
+import struct
 import unittest
 
 from context import packets
@@ -16,5 +17,44 @@ class TestEchoPackets(unittest.TestCase):
         echo_req_parse = packets.EchoRequestPacket.unpack(expected_payload)
         self.assertEqual(echo_req.content, echo_req_parse.content)
 
+class TestGoertzelPackets(unittest.TestCase):
+    def test_config(self):
+        cfg = packets.GoertzelConfigPacket(freqs=[1000.0, 2500.0])
+
+        expected_payload = b'GC\x02' + struct.pack('>ff', 1000.0, 2500.0)
+        self.assertEqual(expected_payload, cfg.pack())
+
+    def test_run(self):
+        run = packets.GoertzelRunPacket(prescaler=104, period=49, num_points=200,
+                                        sample_width=1, sample_time=3,
+                                        num_buffers=10, channels=[0, 1])
+
+        expected_payload = b'GR' + struct.pack('>HLHBHHB2B', 104, 49, 200, 1, 3, 10, 2, 0, 1)
+        self.assertEqual(expected_payload, run.pack())
+
+    def test_result(self):
+        payload = b'Gr' + struct.pack('>HBB6f', 7, 2, 3, 1, 2, 3, 4, 5, 6)
+
+        res = packets.GoertzelResultPacket.unpack(payload)
+        self.assertEqual(7, res.buffer_no)
+        self.assertEqual([[1, 2, 3], [4, 5, 6]], res.amplitudes)
+
+class TestBenchPackets(unittest.TestCase):
+    def test_dtmf(self):
+        run = packets.BenchDTMFPacket(prescaler=104, period=49, num_points=200,
+                                      sample_width=2, sample_time=3, num_buffers=50,
+                                      backend=1, window_len=256, hop=128, channels=[0])
+
+        expected_payload = b'BD' + struct.pack('>HLHBHHBHHB1B', 104, 49, 200, 2, 3, 50, 1, 256, 128, 1, 0)
+        self.assertEqual(expected_payload, run.pack())
+
+    def test_stats(self):
+        payload = b'Bq' + struct.pack('>5L', 50, 1000, 1200, 1500, 100000000)
+
+        stats = packets.BenchStatsPacket.unpack(payload)
+        self.assertEqual(50, stats.count)
+        self.assertEqual(1200, stats.avg_cycles)
+        self.assertAlmostEqual(15.0, stats.us(stats.max_cycles))
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,70 @@
+#
+# A Makefile snippet for tools that run on the host, built against
+# the same application sources as the firmware.  These are for
+# chewing through captures and benchmarking, not for the target.
+#
+# Run as:
+#
+#   make -f host_tools.mk host-tools
+#
+# The binaries land in build_host/.  To benchmark the DTMF decoder
+# against a saved baseline:
+#
+#   make -f host_tools.mk host-bench HOST_BENCH_ARGS="-B baseline.csv"
+#
+# host-bench also runs the packet FCS benchmark once for each of the
+# PACKET_FCS_SLICES settings, so the table sizes can be weighed up
+# against their speed.
+#
+# And to map out detection and false alarm rates for the DTMF decoder
+# over sample rates, block lengths and thresholds:
+#
+#   make -f host_tools.mk host-sweep HOST_SWEEP_ARGS="-n 15 -w 6"
+#
+
+HOST_CC = gcc
+HOST_CFLAGS = -std=gnu99 -O2 -g -Wall -I. -Isrc -Isrc/tests -pthread
+HOST_LDLIBS = -lm -pthread
+
+PATHH = build_host/
+
+PACKET_FCS_BENCHES = $(PATHH)packet_fcs_bench0 $(PATHH)packet_fcs_bench1 $(PATHH)packet_fcs_bench4 $(PATHH)packet_fcs_bench8
+
+HOST_TOOLS = $(PATHH)dtmf_batch $(PATHH)dtmf_bench $(PATHH)dtmf_sweep $(PATHH)sin_gen_bench $(PACKET_FCS_BENCHES)
+
+.PHONY: host-tools host-tools-selftest host-bench host-sweep clean-host-tools
+
+host-tools: $(HOST_TOOLS)
+
+host-tools-selftest: host-tools
+	./$(PATHH)dtmf_batch --selftest
+
+host-bench: host-tools
+	./$(PATHH)dtmf_bench $(HOST_BENCH_ARGS)
+	./$(PATHH)sin_gen_bench
+	for b in $(PACKET_FCS_BENCHES); do ./$$b; done
+
+host-sweep: host-tools
+	./$(PATHH)dtmf_sweep $(HOST_SWEEP_ARGS)
+
+$(PATHH):
+	mkdir -p $(PATHH)
+
+$(PATHH)dtmf_batch: host_tools/dtmf_batch.c src/dtmf.c src/dtmf.h src/goertzel.c src/goertzel.h | $(PATHH)
+	$(HOST_CC) $(HOST_CFLAGS) -o $@ $(filter %.c,$^) $(HOST_LDLIBS)
+
+$(PATHH)dtmf_bench: host_tools/dtmf_bench.c src/dtmf.c src/dtmf.h src/goertzel.c src/goertzel.h | $(PATHH)
+	$(HOST_CC) $(HOST_CFLAGS) -o $@ $(filter %.c,$^) $(HOST_LDLIBS)
+
+$(PATHH)sin_gen_bench: host_tools/sin_gen_bench.c src/sin_gen.c src/sin_gen.h | $(PATHH)
+	$(HOST_CC) $(HOST_CFLAGS) -o $@ $(filter %.c,$^) $(HOST_LDLIBS)
+
+# packet.c has hardware bits outside of TEST_UNITY
+$(PATHH)packet_fcs_bench%: host_tools/packet_fcs_bench.c src/packet.c src/packet.h | $(PATHH)
+	$(HOST_CC) $(HOST_CFLAGS) -DTEST_UNITY -DPACKET_FCS_SLICES=$* -o $@ $(filter %.c,$^) $(HOST_LDLIBS)
+
+$(PATHH)dtmf_sweep: host_tools/dtmf_sweep.c src/dtmf.c src/dtmf.h src/goertzel.c src/goertzel.h src/sin_gen.c src/sin_gen.h | $(PATHH)
+	$(HOST_CC) $(HOST_CFLAGS) -o $@ $(filter %.c,$^) $(HOST_LDLIBS)
+
+clean-host-tools:
+	rm -rf $(PATHH)
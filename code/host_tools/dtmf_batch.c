@@ -0,0 +1,415 @@
+/**
+ * \file dtmf_batch.c
+ * \brief Host tool: decode DTMF out of long captures, on all cores
+ *
+ * \defgroup host_tools Host-side tools
+ * \addtogroup host_tools
+ * \{
+ *
+ * This takes a raw capture of uint8_t ADC samples (as dumped by the
+ * EOL 'A' 'C' command, say) and prints every DTMF symbol in it, with
+ * its start time and duration.
+ *
+ * Big captures are split into segments which are decoded in parallel,
+ * one decoder per segment.  Each segment is padded on both sides with
+ * samples from its neighbors, and only the events which start inside
+ * the segment proper are kept.  Segments and pads are whole numbers of
+ * blocks, so every block is analyzed exactly as it would be in one
+ * long pass.  The leading pad means the decoder knows whether a tone
+ * was already going at the start of the segment.  The trailing pad
+ * lets tones that start near the end run to completion, so it needs
+ * to be longer than the longest tone you expect.
+ *
+ * Run with --selftest to decode a long capture made of the test
+ * fixture repeated over and over.  This checks that the stitched
+ * results match a single pass exactly, and reports the throughput of
+ * both.
+ *
+ * Build with `make -f host_tools.mk host-tools`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "dtmf.h"
+
+#include "fixture_dtmf_tones.c"
+
+/**
+ * Everything needed to decode one segment of a capture
+ */
+typedef struct batch_segment {
+  dtmf_decoder_t dec; //!< The decoder for this segment
+
+  uint32_t core_start; //!< First sample of the segment proper
+  uint32_t core_end; //!< One past the last sample of the segment proper
+  uint32_t range_start; //!< First sample to decode, including the leading pad
+  uint32_t range_end; //!< One past the last sample to decode, including the trailing pad
+
+  dtmf_event_t *events; //!< The events decoded, in range-relative samples
+  uint16_t max_events; //!< How many events fit in events
+  uint16_t n_events; //!< How many events were decoded
+  dtmf_status_t status; //!< What dtmf_decode_buffer() said
+} batch_segment_t;
+
+/**
+ * The whole job, shared between all the worker threads
+ */
+typedef struct batch_job {
+  const uint8_t *buf; //!< The capture
+  uint16_t block_len; //!< Samples per block
+
+  batch_segment_t *segments; //!< All the segments
+  uint32_t n_segments; //!< How many segments there are
+
+  int n_threads; //!< How many worker threads there are
+} batch_job_t;
+
+/**
+ * Arguments for one worker thread
+ */
+typedef struct batch_worker {
+  pthread_t thread; //!< The thread itself
+  batch_job_t *job; //!< The job being done
+  int thread_no; //!< Which thread this is, 0..n_threads-1
+} batch_worker_t;
+
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Worker thread: decode every n_threads'th segment
+ */
+static void *batch_worker_main(void *arg) {
+  batch_worker_t *w = (batch_worker_t *)arg;
+  batch_job_t *job = w->job;
+
+  for (uint32_t k = w->thread_no; k < job->n_segments; k += job->n_threads) {
+    batch_segment_t *seg = &job->segments[k];
+
+    seg->status = dtmf_decode_buffer(&seg->dec, job->buf + seg->range_start,
+                                     seg->range_end - seg->range_start, job->block_len,
+                                     seg->events, seg->max_events, &seg->n_events);
+  }
+
+  return NULL;
+}
+
+/**
+ * Decode a capture in parallel
+ *
+ * \param buf The capture
+ * \param buflen Its length, in samples
+ * \param Fs Its sample rate
+ * \param threshold The decoder threshold
+ * \param backend The decoder backend
+ * \param block_len How many samples each decision is made on
+ * \param seg_len Samples per segment, rounded up to whole blocks
+ * \param pad_len Samples of padding on each side, rounded up to whole blocks
+ * \param n_threads How many threads to use
+ * \param events[out] Where to put the events, in capture-relative samples
+ * \param max_events How many events fit in events
+ *
+ * \returns The number of events found, or -1 on error
+ */
+static long batch_decode(const uint8_t *buf, uint32_t buflen, float Fs, float threshold,
+                         dtmf_backend_t backend, uint16_t block_len,
+                         uint32_t seg_len, uint32_t pad_len, int n_threads,
+                         dtmf_event_t *events, uint32_t max_events) {
+  batch_job_t job = { .buf = buf, .block_len = block_len, .n_threads = n_threads };
+  long n_found = 0;
+
+  seg_len = ((seg_len + block_len - 1) / block_len) * block_len;
+  pad_len = ((pad_len + block_len - 1) / block_len) * block_len;
+  if (pad_len < block_len) pad_len = block_len;
+
+  job.n_segments = (buflen + seg_len - 1) / seg_len;
+  if (0 == job.n_segments) return 0;
+
+  job.segments = calloc(job.n_segments, sizeof(batch_segment_t));
+  if (!job.segments) return -1;
+
+  // Set everything up before starting any threads
+  for (uint32_t k = 0; k < job.n_segments; k++) {
+    batch_segment_t *seg = &job.segments[k];
+
+    seg->core_start = k * seg_len;
+    seg->core_end = (seg->core_start + seg_len < buflen ? seg->core_start + seg_len : buflen);
+    seg->range_start = (seg->core_start > pad_len ? seg->core_start - pad_len : 0);
+    seg->range_end = (seg->core_end + pad_len < buflen ? seg->core_end + pad_len : buflen);
+
+    // Can't have more events than blocks
+    uint32_t max_seg_events = (seg->range_end - seg->range_start) / block_len + 1;
+    seg->max_events = (max_seg_events > UINT16_MAX ? UINT16_MAX : max_seg_events);
+    seg->events = calloc(seg->max_events, sizeof(dtmf_event_t));
+    if (!seg->events) {
+      n_found = -1;
+      goto done;
+    }
+
+    dtmf_decoder_init(&seg->dec, Fs, threshold, NULL, NULL, backend);
+  }
+
+  if (n_threads > (int)job.n_segments) {
+    job.n_threads = n_threads = job.n_segments;
+  }
+
+  batch_worker_t *workers = calloc(n_threads, sizeof(batch_worker_t));
+  if (!workers) {
+    n_found = -1;
+    goto done;
+  }
+
+  for (int i = 0; i < n_threads; i++) {
+    workers[i].job = &job;
+    workers[i].thread_no = i;
+    pthread_create(&workers[i].thread, NULL, batch_worker_main, &workers[i]);
+  }
+  for (int i = 0; i < n_threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  free(workers);
+
+  // Stitch: keep only the events that start in each segment proper
+  for (uint32_t k = 0; k < job.n_segments; k++) {
+    batch_segment_t *seg = &job.segments[k];
+
+    if (DTMF_OKAY != seg->status) {
+      fprintf(stderr, "Segment %u failed to decode: status %d\n", k, seg->status);
+      n_found = -1;
+      goto done;
+    }
+
+    for (int i = 0; i < seg->n_events; i++) {
+      dtmf_event_t ev = seg->events[i];
+      ev.start += seg->range_start;
+
+      if (ev.start < seg->core_start || ev.start >= seg->core_end) continue;
+
+      if ((uint32_t)n_found >= max_events) {
+        fprintf(stderr, "Too many events!\n");
+        n_found = -1;
+        goto done;
+      }
+      events[n_found++] = ev;
+    }
+  }
+
+ done:
+  for (uint32_t k = 0; k < job.n_segments; k++) {
+    free(job.segments[k].events);
+  }
+  free(job.segments);
+
+  return n_found;
+}
+
+/**
+ * Decode the fixture over and over, and make sure the parallel
+ * decoding matches a single pass.
+ */
+static int selftest(int repeats, int n_threads, dtmf_backend_t backend) {
+  const uint16_t block_len = 200;
+  const uint32_t buflen = repeats * FIXTURE_DTMF_BUFLEN;
+  const size_t n_symbols = strlen((const char *)fixture_dtmf_symbols);
+  const uint32_t max_events = repeats * n_symbols + 1;
+  int retval = 0;
+
+  uint8_t *buf = malloc(buflen);
+  dtmf_event_t *single = calloc(max_events, sizeof(dtmf_event_t));
+  dtmf_event_t *parallel = calloc(max_events, sizeof(dtmf_event_t));
+  if (!buf || !single || !parallel) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  for (int i = 0; i < repeats; i++) {
+    memcpy(buf + i*FIXTURE_DTMF_BUFLEN, fixture_dtmf_buffer, FIXTURE_DTMF_BUFLEN);
+  }
+
+  // Single pass, as a reference
+  dtmf_decoder_t dec;
+  uint16_t n_single;
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, backend);
+
+  double t0 = now();
+  dtmf_status_t res = dtmf_decode_buffer(&dec, buf, buflen, block_len,
+                                         single, (max_events > UINT16_MAX ? UINT16_MAX : max_events),
+                                         &n_single);
+  double t_single = now() - t0;
+
+  if (DTMF_OKAY != res) {
+    fprintf(stderr, "Single pass decode failed: %d (try fewer repeats)\n", res);
+    return 1;
+  }
+
+  // And in parallel, with segments that don't line up with the fixture
+  t0 = now();
+  long n_parallel = batch_decode(buf, buflen, FIXTURE_DTMF_FS, 0.5, backend, block_len,
+                                 10 * FIXTURE_DTMF_BUFLEN + 1000, FIXTURE_DTMF_FS,
+                                 n_threads, parallel, max_events);
+  double t_parallel = now() - t0;
+
+  printf("Single pass: %u events in %.3fs, %.1f Msamples/s\n",
+         n_single, t_single, buflen / t_single / 1e6);
+  printf("%2d threads:  %ld events in %.3fs, %.1f Msamples/s\n",
+         n_threads, n_parallel, t_parallel, buflen / t_parallel / 1e6);
+
+  if (n_single != repeats * n_symbols) {
+    printf("FAIL: expected %u events\n", (unsigned)(repeats * n_symbols));
+    retval = 1;
+  }
+
+  for (int i = 0; i < n_single; i++) {
+    if (single[i].symbol != (uint8_t)fixture_dtmf_symbols[i % n_symbols]) {
+      printf("FAIL: event %d is '%c', expected '%c'\n", i, single[i].symbol,
+             fixture_dtmf_symbols[i % n_symbols]);
+      retval = 1;
+      break;
+    }
+  }
+
+  if (n_parallel != n_single) {
+    printf("FAIL: parallel decode found %ld events, single pass %u\n", n_parallel, n_single);
+    retval = 1;
+  } else {
+    for (int i = 0; i < n_single; i++) {
+      if (single[i].symbol != parallel[i].symbol ||
+          single[i].start != parallel[i].start ||
+          single[i].duration != parallel[i].duration) {
+        printf("FAIL: event %d differs: %c@%u+%u vs %c@%u+%u\n", i,
+               single[i].symbol, single[i].start, single[i].duration,
+               parallel[i].symbol, parallel[i].start, parallel[i].duration);
+        retval = 1;
+        break;
+      }
+    }
+  }
+
+  printf("%s\n", retval ? "FAILED" : "PASSED");
+
+  free(buf);
+  free(single);
+  free(parallel);
+  return retval;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [options] capture.raw\n"
+          "       %s --selftest [-r repeats] [-j threads]\n"
+          "\n"
+          "Decodes DTMF out of a capture of raw uint8_t samples.\n"
+          "\n"
+          "  -f Fs          sample rate (default 8000)\n"
+          "  -t threshold   decoder threshold (default 0.2)\n"
+          "  -b block_len   samples per decision (default 200)\n"
+          "  -j threads     worker threads (default: all cores)\n"
+          "  -s seconds     segment length (default 60)\n"
+          "  -p seconds     padding on each side of segments, must exceed the\n"
+          "                 longest tone (default 2)\n"
+          "  -x             use the fixed point backend\n"
+          "  -r repeats     fixture repeats for --selftest (default 300)\n",
+          argv0, argv0);
+}
+
+int main(int argc, char *argv[]) {
+  float Fs = 8000;
+  float threshold = 0.2;
+  int block_len = 200;
+  int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  float seg_seconds = 60;
+  float pad_seconds = 2;
+  dtmf_backend_t backend = DTMF_BACKEND_FLOAT;
+  int repeats = 300;
+  int do_selftest = 0;
+
+  static const struct option long_options[] = {
+    { "selftest", no_argument, NULL, 'S' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 },
+  };
+
+  int c;
+  while ((c = getopt_long(argc, argv, "f:t:b:j:s:p:xr:h", long_options, NULL)) != -1) {
+    switch (c) {
+    case 'f': Fs = atof(optarg); break;
+    case 't': threshold = atof(optarg); break;
+    case 'b': block_len = atoi(optarg); break;
+    case 'j': n_threads = atoi(optarg); break;
+    case 's': seg_seconds = atof(optarg); break;
+    case 'p': pad_seconds = atof(optarg); break;
+    case 'x': backend = DTMF_BACKEND_FIXED; break;
+    case 'r': repeats = atoi(optarg); break;
+    case 'S': do_selftest = 1; break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+
+  if (n_threads < 1) n_threads = 1;
+  if (block_len < 2 || block_len > UINT16_MAX) {
+    fprintf(stderr, "Invalid block length %d\n", block_len);
+    return 1;
+  }
+
+  if (do_selftest) {
+    return selftest(repeats, n_threads, backend);
+  }
+
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Slurp in the capture
+  FILE *f = fopen(argv[optind], "rb");
+  if (!f) {
+    perror(argv[optind]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long buflen = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t *buf = malloc(buflen > 0 ? buflen : 1);
+  if (!buf || fread(buf, 1, buflen, f) != (size_t)buflen) {
+    fprintf(stderr, "Couldn't read %s\n", argv[optind]);
+    return 1;
+  }
+  fclose(f);
+
+  uint32_t max_events = buflen / block_len + 1;
+  dtmf_event_t *events = calloc(max_events, sizeof(dtmf_event_t));
+
+  double t0 = now();
+  long n_events = batch_decode(buf, buflen, Fs, threshold, backend, block_len,
+                               seg_seconds * Fs, pad_seconds * Fs,
+                               n_threads, events, max_events);
+  double elapsed = now() - t0;
+
+  if (n_events < 0) return 1;
+
+  for (long i = 0; i < n_events; i++) {
+    printf("%c %10.4f %8.1f\n", events[i].symbol,
+           events[i].start / Fs, events[i].duration / Fs * 1000);
+  }
+
+  fprintf(stderr, "%ld events in %ld samples (%.1fs), %.3fs on %d threads: %.1f Msamples/s\n",
+          n_events, buflen, buflen / Fs, elapsed, n_threads, buflen / elapsed / 1e6);
+
+  free(events);
+  free(buf);
+  return 0;
+}
+
+/** \} */ // End doxygen group
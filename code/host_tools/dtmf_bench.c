@@ -0,0 +1,271 @@
+/**
+ * \file dtmf_bench.c
+ * \brief Host tool: benchmark the DTMF decoder
+ *
+ * \addtogroup host_tools
+ * \{
+ *
+ * This runs the DTMF decoder over the test fixture with each backend,
+ * both sample widths, and a range of block lengths, and reports what
+ * it costs per sample.  It's the host half of the decoder
+ * benchmarks; the target half is the EOL 'B' commands, which report
+ * the cycles spent in the ADC callback.
+ *
+ * Host timings are noisy, so each case is timed several times over
+ * and only the fastest pass is reported.  The minimum is far more
+ * repeatable than the mean on a machine that's doing other things,
+ * and it's the number that moves when the code gets slower.
+ *
+ * To catch regressions, save the CSV output (-c) of a known-good
+ * build as a baseline, then run later builds with -B baseline.csv.
+ * Any case that's more than the tolerance (-t, in percent) slower
+ * than the baseline is flagged, and the exit status is nonzero.
+ *
+ * Build with `make -f host_tools.mk host-tools`, or just run
+ * `make -f host_tools.mk host-bench`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "dtmf.h"
+
+#include "fixture_dtmf_tones.c"
+
+#define BENCH_MAX_CASES 64 //!< Most cases a single run can have
+
+/**
+ * One benchmark case, and its result
+ */
+typedef struct bench_case {
+  dtmf_backend_t backend; //!< Which arithmetic to use
+  uint8_t sample_width; //!< 1 for 8b samples, 2 for 12b samples
+  uint16_t window_len; //!< Streaming window length, or 0 for block mode
+  uint16_t block_len; //!< Samples handed to the decoder at a time
+
+  double ns_per_sample; //!< The fastest pass, in ns per sample
+} bench_case_t;
+
+static uint16_t fixture16[FIXTURE_DTMF_BUFLEN]; //!< The fixture, widened to 12b
+static int16_t hann[256]; //!< Window for the streaming cases
+
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *backend_name(dtmf_backend_t backend) {
+  return (DTMF_BACKEND_FIXED == backend ? "fixed" : "float");
+}
+
+static const char *mode_name(const bench_case_t *bc) {
+  return (bc->window_len ? "stream" : "block");
+}
+
+/**
+ * Run the fixture through a decoder once, a block at a time
+ */
+static void bench_pass(dtmf_decoder_t *dec, const bench_case_t *bc) {
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i += bc->block_len) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > bc->block_len ? bc->block_len : l);
+
+    if (2 == bc->sample_width) {
+      dtmf_decoder_process16(dec, fixture16+i, l);
+    } else {
+      dtmf_decoder_process(dec, fixture_dtmf_buffer+i, l);
+    }
+  }
+
+  if (2 == bc->sample_width) {
+    dtmf_decoder_process16(dec, NULL, 0);
+  } else {
+    dtmf_decoder_process(dec, NULL, 0);
+  }
+}
+
+/**
+ * Time one case
+ *
+ * \param bc The case to run, which gets its result filled in
+ * \param reps How many timed passes to take the minimum of
+ * \param inner How many times over the fixture each timed pass is
+ */
+static void bench_run(bench_case_t *bc, int reps, int inner) {
+  dtmf_decoder_t dec;
+  double best = -1;
+
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, bc->backend);
+  dtmf_decoder_set_calibration(&dec, 127*16+8, 127*16, false);
+  if (bc->window_len) {
+    dtmf_decoder_set_window(&dec, bc->window_len, bc->window_len/2, hann);
+  }
+
+  // One untimed pass to warm the caches up
+  bench_pass(&dec, bc);
+
+  for (int r = 0; r < reps; r++) {
+    double t0 = now();
+    for (int k = 0; k < inner; k++) {
+      bench_pass(&dec, bc);
+    }
+    double t = now() - t0;
+
+    if (best < 0 || t < best) best = t;
+  }
+
+  bc->ns_per_sample = best * 1e9 / ((double)inner * FIXTURE_DTMF_BUFLEN);
+}
+
+/**
+ * Fill in the list of cases to run
+ *
+ * \returns The number of cases
+ */
+static int bench_cases(bench_case_t *cases) {
+  static const uint16_t block_lens[] = { 50, 100, 200, 400, 1024 };
+  int n = 0;
+
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    for (int width = 1; width <= 2; width++) {
+      for (unsigned i = 0; i < sizeof(block_lens)/sizeof(block_lens[0]); i++) {
+        cases[n++] = (bench_case_t){ .backend = backend, .sample_width = width,
+                                     .window_len = 0, .block_len = block_lens[i] };
+      }
+
+      cases[n++] = (bench_case_t){ .backend = backend, .sample_width = width,
+                                   .window_len = 256, .block_len = 200 };
+    }
+  }
+
+  return n;
+}
+
+/**
+ * Compare results against a baseline CSV from an earlier run
+ *
+ * \returns The number of regressions found, or -1 if the baseline
+ * couldn't be read
+ */
+static int bench_compare(const bench_case_t *cases, int n_cases, const char *path, double tolerance) {
+  FILE *f = fopen(path, "r");
+  char line[128];
+  int n_regressions = 0;
+  int n_matched = 0;
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+    char backend[16], mode[16];
+    int bits, block_len;
+    double ns;
+
+    if (5 != sscanf(line, "%15[^,],%d,%15[^,],%d,%lf", backend, &bits, mode, &block_len, &ns)) {
+      continue; // The header, or junk
+    }
+
+    for (int i = 0; i < n_cases; i++) {
+      const bench_case_t *bc = &cases[i];
+
+      if (strcmp(backend, backend_name(bc->backend)) || bits != 4 + 4*bc->sample_width ||
+          strcmp(mode, mode_name(bc)) || block_len != bc->block_len) {
+        continue;
+      }
+
+      n_matched++;
+      double change = 100 * (bc->ns_per_sample - ns) / ns;
+      if (change > tolerance) {
+        printf("REGRESSION: %s %2db %-6s %4d: %.2f ns/sample, was %.2f (%+.1f%%)\n",
+               backend, bits, mode, block_len, bc->ns_per_sample, ns, change);
+        n_regressions++;
+      }
+    }
+  }
+  fclose(f);
+
+  printf("%d of %d cases compared against %s, %d regressions over %.1f%%\n",
+         n_matched, n_cases, path, n_regressions, tolerance);
+  return n_regressions;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "\n"
+          "Benchmarks the DTMF decoder over the test fixture.\n"
+          "\n"
+          "  -r reps        timed passes per case, fastest is kept (default 15)\n"
+          "  -n inner       fixture runs per timed pass (default 20)\n"
+          "  -c             print results as CSV, for use as a baseline\n"
+          "  -B baseline    compare against a CSV from an earlier run\n"
+          "  -t percent     slowdown to flag as a regression (default 10)\n",
+          argv0);
+}
+
+int main(int argc, char *argv[]) {
+  bench_case_t cases[BENCH_MAX_CASES];
+  int reps = 15;
+  int inner = 20;
+  int csv = 0;
+  const char *baseline = NULL;
+  double tolerance = 10;
+
+  int c;
+  while ((c = getopt(argc, argv, "r:n:cB:t:h")) != -1) {
+    switch (c) {
+    case 'r': reps = atoi(optarg); break;
+    case 'n': inner = atoi(optarg); break;
+    case 'c': csv = 1; break;
+    case 'B': baseline = optarg; break;
+    case 't': tolerance = atof(optarg); break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+
+  if (reps < 1) reps = 1;
+  if (inner < 1) inner = 1;
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i++) {
+    fixture16[i] = fixture_dtmf_buffer[i]*16 + 8;
+  }
+  dtmf_window_hann(hann, 256);
+
+  int n_cases = bench_cases(cases);
+
+  if (csv) {
+    printf("backend,bits,mode,block_len,ns_per_sample\n");
+  } else {
+    printf("backend bits mode   block  ns/sample\n");
+  }
+
+  for (int i = 0; i < n_cases; i++) {
+    bench_case_t *bc = &cases[i];
+    bench_run(bc, reps, inner);
+
+    if (csv) {
+      printf("%s,%d,%s,%d,%.3f\n", backend_name(bc->backend), 4 + 4*bc->sample_width,
+             mode_name(bc), bc->block_len, bc->ns_per_sample);
+    } else {
+      printf("%-7s %4d %-6s %5d %10.2f\n", backend_name(bc->backend), 4 + 4*bc->sample_width,
+             mode_name(bc), bc->block_len, bc->ns_per_sample);
+    }
+  }
+
+  if (baseline) {
+    int n_regressions = bench_compare(cases, n_cases, baseline, tolerance);
+    return (0 == n_regressions ? 0 : 1);
+  }
+
+  return 0;
+}
+
+/** \} */ // End doxygen group
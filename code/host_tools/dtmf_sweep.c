@@ -0,0 +1,472 @@
+/**
+ * \file dtmf_sweep.c
+ * \brief Host tool: map out the DTMF decoder's operating envelope
+ *
+ * \addtogroup host_tools
+ * \{
+ *
+ * This synthesizes long runs of random DTMF symbols with sin_gen,
+ * roughs them up with noise, twist and frequency offsets, and runs
+ * them through the decoder.  It does this for every combination of
+ * sample rate, block length and threshold asked for, spread across
+ * all the cores, and prints a table of how well each one did.
+ *
+ * Each symbol is a tone burst followed by a gap of noise alone.  An
+ * event counts as a detection if it's the right symbol and its
+ * window overlaps that symbol's tone, and it's the first such event
+ * for that symbol.  Everything else is a false alarm: wrong symbols,
+ * events in the gaps, and tones that drop out and get reported twice.
+ * Both rates are per symbol sent.  The latency is from the start of
+ * the tone to the end of the block that first detected it.
+ *
+ * The impairments are chosen at random for each symbol: the
+ * frequency offset goes either way on each of the two tones, and
+ * each tone starts at a random phase.  Each tone also starts a random
+ * number of samples (up to half the gap) into its slot, so its edges
+ * don't line up with the decoder's blocks.  Twist is the column tone's
+ * level relative to the row tone, and the SNR is the row tone's
+ * power against the noise.  The random stream is seeded by the sample
+ * rate alone, so every block length and threshold is scored on the
+ * very same signal, and results don't depend on the thread count.
+ *
+ * With -D and -F, it also prints the shortest block length at each
+ * sample rate that meets those targets, which is the lowest-latency
+ * setup that's good enough.
+ *
+ * Build with `make -f host_tools.mk host-tools`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "dtmf.h"
+#include "sin_gen.h"
+
+#define SWEEP_MAX_VALUES 32 //!< Most values in any one swept list
+
+static const char sweep_symbols[] = "0123456789ABCD*#"; //!< Symbols to pick from
+
+/**
+ * The impairments and run lengths shared by every configuration
+ */
+typedef struct sweep_params {
+  float snr_db; //!< Row tone power over noise power
+  float twist_db; //!< Column tone level over row tone level
+  float offset_pct; //!< Frequency error on each tone, either way
+  float level; //!< Row tone amplitude, as a fraction of full scale
+  float tone_ms; //!< Length of each tone burst
+  float gap_ms; //!< Length of the silence after each tone
+  uint32_t n_symbols; //!< Symbols sent per configuration
+  dtmf_backend_t backend; //!< Which decoder backend to use
+  uint32_t seed; //!< Base random seed
+} sweep_params_t;
+
+/**
+ * One point in the sweep, and its results
+ */
+typedef struct sweep_config {
+  float Fs; //!< Sample rate
+  uint16_t block_len; //!< Samples per decision
+  float threshold; //!< Decoder threshold
+
+  dtmf_decoder_t dec; //!< The decoder for this configuration
+
+  uint32_t n_detected; //!< Symbols detected correctly
+  uint32_t n_false; //!< Events which weren't a correct detection
+  double latency_ms; //!< Mean time to detection, in ms
+  int failed; //!< Set if the configuration couldn't be run
+} sweep_config_t;
+
+/**
+ * The whole job, shared between all the worker threads
+ */
+typedef struct sweep_job {
+  const sweep_params_t *params; //!< The impairments
+  sweep_config_t *configs; //!< All the configurations
+  uint32_t n_configs; //!< How many configurations there are
+  int n_threads; //!< How many worker threads there are
+} sweep_job_t;
+
+/**
+ * Arguments for one worker thread
+ */
+typedef struct sweep_worker {
+  pthread_t thread; //!< The thread itself
+  sweep_job_t *job; //!< The job being done
+  int thread_no; //!< Which thread this is, 0..n_threads-1
+} sweep_worker_t;
+
+
+/**
+ * A small PRNG (xorshift64*), so each configuration gets its own
+ * reproducible stream
+ */
+static uint64_t rng_next(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * A uniform random number in (0, 1]
+ */
+static double rng_uniform(uint64_t *state) {
+  return ((rng_next(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * A standard normal random number, by Box-Muller
+ */
+static double rng_normal(uint64_t *state) {
+  double u1 = rng_uniform(state);
+  double u2 = rng_uniform(state);
+  return sqrt(-2 * log(u1)) * cos(4 * COS_THETA0 * u2);
+}
+
+/**
+ * Add one tone burst to a float buffer, using sin_gen_sin()
+ */
+static void sweep_add_tone(float *buf, uint32_t len, float f, float Fs, float theta0, float amplitude) {
+  const float two_pi = 4 * COS_THETA0;
+  float dtheta = two_pi * f / Fs;
+  float theta = theta0;
+
+  for (uint32_t i = 0; i < len; i++) {
+    buf[i] += amplitude * (sin_gen_sin(theta, 1) - 127);
+    theta += dtheta;
+    if (theta >= two_pi) theta -= two_pi;
+  }
+}
+
+/**
+ * Synthesize the signal for one configuration
+ *
+ * \param buf[out] The samples, n_symbols * slot_len of them
+ * \param sent[out] The symbols sent, one per slot
+ * \param lead[out] Where each tone starts in its slot
+ */
+static void sweep_synthesize(const sweep_params_t *p, float Fs, uint64_t *rng,
+                             uint8_t *buf, uint8_t *sent, uint32_t *lead, float *work,
+                             uint32_t tone_len, uint32_t slot_len) {
+  const float row_amp = p->level;
+  const float col_amp = p->level * powf(10, p->twist_db / 20);
+  const float noise_sigma = p->level * 127 / sqrtf(2) / powf(10, p->snr_db / 20);
+
+  for (uint32_t k = 0; k < p->n_symbols; k++) {
+    float f_row, f_col;
+
+    sent[k] = sweep_symbols[rng_next(rng) % (sizeof(sweep_symbols) - 1)];
+    dtmf_get_tones(sent[k], &f_row, &f_col);
+
+    f_row *= 1 + ((rng_next(rng) & 1) ? 1 : -1) * p->offset_pct / 100;
+    f_col *= 1 + ((rng_next(rng) & 1) ? 1 : -1) * p->offset_pct / 100;
+
+    lead[k] = rng_next(rng) % ((slot_len - tone_len)/2 + 1);
+
+    memset(work, 0, slot_len * sizeof(float));
+    sweep_add_tone(work + lead[k], tone_len, f_row, Fs, 4 * COS_THETA0 * rng_uniform(rng), row_amp);
+    sweep_add_tone(work + lead[k], tone_len, f_col, Fs, 4 * COS_THETA0 * rng_uniform(rng), col_amp);
+
+    for (uint32_t i = 0; i < slot_len; i++) {
+      long v = lroundf(127 + work[i] + noise_sigma * rng_normal(rng));
+      buf[k*slot_len + i] = (v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+  }
+}
+
+/**
+ * Run one configuration: synthesize, decode, and score it
+ */
+static void sweep_run(const sweep_params_t *p, sweep_config_t *cfg) {
+  const uint32_t tone_len = p->tone_ms * cfg->Fs / 1000;
+  const uint32_t slot_len = tone_len + (uint32_t)(p->gap_ms * cfg->Fs / 1000);
+  const uint32_t buflen = p->n_symbols * slot_len;
+  uint32_t max_events = buflen / cfg->block_len + 1;
+  if (max_events > UINT16_MAX) max_events = UINT16_MAX;
+
+  uint64_t rng = ((uint64_t)p->seed << 32) ^ (uint64_t)(cfg->Fs + 1) * 0x9E3779B97F4A7C15ULL;
+  if (0 == rng) rng = 1;
+
+  uint8_t *buf = malloc(buflen);
+  uint8_t *sent = malloc(p->n_symbols);
+  uint8_t *hit = calloc(p->n_symbols, 1);
+  uint32_t *lead = malloc(p->n_symbols * sizeof(uint32_t));
+  float *work = malloc(slot_len * sizeof(float));
+  dtmf_event_t *events = calloc(max_events, sizeof(dtmf_event_t));
+  uint16_t n_events = 0;
+
+  if (!buf || !sent || !hit || !lead || !work || !events) {
+    cfg->failed = 1;
+    goto done;
+  }
+
+  sweep_synthesize(p, cfg->Fs, &rng, buf, sent, lead, work, tone_len, slot_len);
+
+  if (DTMF_OKAY != dtmf_decode_buffer(&cfg->dec, buf, buflen, cfg->block_len,
+                                      events, max_events, &n_events)) {
+    cfg->failed = 1;
+    goto done;
+  }
+
+  double total_latency = 0;
+  for (int i = 0; i < n_events; i++) {
+    // The window may start in the gap before the tone it caught
+    uint32_t decided = events[i].start + cfg->block_len;
+    uint32_t k = decided / slot_len;
+    if (k >= p->n_symbols) k = p->n_symbols - 1;
+    uint32_t tone_start = k * slot_len + lead[k];
+
+    if (events[i].symbol == sent[k] && !hit[k] &&
+        decided > tone_start && events[i].start < tone_start + tone_len) {
+      hit[k] = 1;
+      cfg->n_detected++;
+      total_latency += decided - tone_start;
+    } else {
+      cfg->n_false++;
+    }
+  }
+
+  cfg->latency_ms = (cfg->n_detected ? total_latency / cfg->n_detected * 1000 / cfg->Fs : 0);
+
+ done:
+  free(buf);
+  free(sent);
+  free(hit);
+  free(lead);
+  free(work);
+  free(events);
+}
+
+/**
+ * Worker thread: run every n_threads'th configuration
+ */
+static void *sweep_worker_main(void *arg) {
+  sweep_worker_t *w = (sweep_worker_t *)arg;
+  sweep_job_t *job = w->job;
+
+  for (uint32_t k = w->thread_no; k < job->n_configs; k += job->n_threads) {
+    sweep_run(job->params, &job->configs[k]);
+  }
+
+  return NULL;
+}
+
+/**
+ * Parse a comma-separated list of numbers
+ *
+ * \returns How many were parsed, or -1 on a bad list
+ */
+static int parse_list(const char *s, float *vals, int max_vals) {
+  int n = 0;
+  char *end;
+
+  while (*s) {
+    if (n >= max_vals) return -1;
+    vals[n++] = strtof(s, &end);
+    if (end == s) return -1;
+    s = end;
+    if (',' == *s) s++;
+  }
+
+  return n;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "\n"
+          "Sweeps the DTMF decoder over synthesized, impaired signals.\n"
+          "\n"
+          "Swept (comma-separated lists):\n"
+          "  -f Fs          sample rates (default 8000,16000)\n"
+          "  -b block_len   block lengths (default 64,80,100,128,160,200,256,400)\n"
+          "  -t threshold   thresholds (default 0.1,0.15,0.2,0.3,0.5)\n"
+          "\n"
+          "Impairments:\n"
+          "  -n dB          SNR of the row tone (default 20)\n"
+          "  -w dB          twist, column over row (default 4)\n"
+          "  -o percent     frequency offset on each tone (default 1.5)\n"
+          "  -l level       row tone amplitude, fraction of full scale (default 0.3)\n"
+          "\n"
+          "  -d ms          tone length (default 40)\n"
+          "  -g ms          gap between tones (default 40)\n"
+          "  -s symbols     symbols per configuration (default 500)\n"
+          "  -r seed        random seed (default 1)\n"
+          "  -x             use the fixed point backend\n"
+          "  -j threads     worker threads (default: all cores)\n"
+          "  -c             print results as CSV\n"
+          "  -D percent     detection rate to aim for (default 99)\n"
+          "  -F percent     false alarm rate to stay under (default 1)\n",
+          argv0);
+}
+
+int main(int argc, char *argv[]) {
+  float fs_list[SWEEP_MAX_VALUES] = { 8000, 16000 };
+  float block_list[SWEEP_MAX_VALUES] = { 64, 80, 100, 128, 160, 200, 256, 400 };
+  float th_list[SWEEP_MAX_VALUES] = { 0.1, 0.15, 0.2, 0.3, 0.5 };
+  int n_fs = 2, n_blocks = 8, n_th = 5;
+
+  sweep_params_t params = {
+    .snr_db = 20, .twist_db = 4, .offset_pct = 1.5, .level = 0.3,
+    .tone_ms = 40, .gap_ms = 40, .n_symbols = 500,
+    .backend = DTMF_BACKEND_FLOAT, .seed = 1,
+  };
+  int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int csv = 0;
+  float target_detect = 99;
+  float target_false = 1;
+
+  int c;
+  while ((c = getopt(argc, argv, "f:b:t:n:w:o:l:d:g:s:r:xj:cD:F:h")) != -1) {
+    switch (c) {
+    case 'f': n_fs = parse_list(optarg, fs_list, SWEEP_MAX_VALUES); break;
+    case 'b': n_blocks = parse_list(optarg, block_list, SWEEP_MAX_VALUES); break;
+    case 't': n_th = parse_list(optarg, th_list, SWEEP_MAX_VALUES); break;
+    case 'n': params.snr_db = atof(optarg); break;
+    case 'w': params.twist_db = atof(optarg); break;
+    case 'o': params.offset_pct = atof(optarg); break;
+    case 'l': params.level = atof(optarg); break;
+    case 'd': params.tone_ms = atof(optarg); break;
+    case 'g': params.gap_ms = atof(optarg); break;
+    case 's': params.n_symbols = atoi(optarg); break;
+    case 'r': params.seed = atoi(optarg); break;
+    case 'x': params.backend = DTMF_BACKEND_FIXED; break;
+    case 'j': n_threads = atoi(optarg); break;
+    case 'c': csv = 1; break;
+    case 'D': target_detect = atof(optarg); break;
+    case 'F': target_false = atof(optarg); break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+
+  if (n_fs < 1 || n_blocks < 1 || n_th < 1) {
+    fprintf(stderr, "Invalid list of values to sweep\n");
+    return 1;
+  }
+  for (int i = 0; i < n_blocks; i++) {
+    if (block_list[i] < 2 || block_list[i] > UINT16_MAX) {
+      fprintf(stderr, "Invalid block length %g\n", block_list[i]);
+      return 1;
+    }
+  }
+  if (params.n_symbols < 1 || params.tone_ms <= 0 || params.gap_ms < 0) {
+    fprintf(stderr, "Invalid symbol count or timing\n");
+    return 1;
+  }
+  if (n_threads < 1) n_threads = 1;
+
+  sweep_job_t job = { .params = &params, .n_configs = n_fs * n_blocks * n_th, .n_threads = n_threads };
+  job.configs = calloc(job.n_configs, sizeof(sweep_config_t));
+  if (!job.configs) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  // Set everything up before starting any threads
+  uint32_t k = 0;
+  for (int i = 0; i < n_fs; i++) {
+    for (int j = 0; j < n_blocks; j++) {
+      for (int t = 0; t < n_th; t++) {
+        sweep_config_t *cfg = &job.configs[k++];
+        cfg->Fs = fs_list[i];
+        cfg->block_len = block_list[j];
+        cfg->threshold = th_list[t];
+        dtmf_decoder_init(&cfg->dec, cfg->Fs, cfg->threshold, NULL, NULL, params.backend);
+      }
+    }
+  }
+
+  if (n_threads > (int)job.n_configs) {
+    job.n_threads = n_threads = job.n_configs;
+  }
+
+  sweep_worker_t *workers = calloc(n_threads, sizeof(sweep_worker_t));
+  if (!workers) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  for (int i = 0; i < n_threads; i++) {
+    workers[i].job = &job;
+    workers[i].thread_no = i;
+    pthread_create(&workers[i].thread, NULL, sweep_worker_main, &workers[i]);
+  }
+  for (int i = 0; i < n_threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  free(workers);
+
+  if (csv) {
+    printf("Fs,block_len,block_ms,threshold,detect_pct,false_pct,latency_ms\n");
+  } else {
+    printf("# %u symbols, %.0fms on/%.0fms off, SNR %.1fdB, twist %+.1fdB, offset %.1f%%, %s backend\n",
+           params.n_symbols, params.tone_ms, params.gap_ms, params.snr_db, params.twist_db,
+           params.offset_pct, (DTMF_BACKEND_FIXED == params.backend ? "fixed" : "float"));
+    printf("     Fs block    ms  thresh  detect%%  false%%  latency\n");
+  }
+
+  int retval = 0;
+  for (k = 0; k < job.n_configs; k++) {
+    sweep_config_t *cfg = &job.configs[k];
+    float detect = 100.0 * cfg->n_detected / params.n_symbols;
+    float false_alarm = 100.0 * cfg->n_false / params.n_symbols;
+
+    if (cfg->failed) {
+      fprintf(stderr, "Couldn't run Fs=%g block_len=%u threshold=%g\n",
+              cfg->Fs, cfg->block_len, cfg->threshold);
+      retval = 1;
+      continue;
+    }
+
+    if (csv) {
+      printf("%g,%u,%.2f,%g,%.2f,%.2f,%.2f\n", cfg->Fs, cfg->block_len,
+             1000 * cfg->block_len / cfg->Fs, cfg->threshold, detect, false_alarm, cfg->latency_ms);
+    } else {
+      printf("%7g %5u %5.1f %7.3f %8.2f %7.2f %8.2f\n", cfg->Fs, cfg->block_len,
+             1000 * cfg->block_len / cfg->Fs, cfg->threshold, detect, false_alarm, cfg->latency_ms);
+    }
+  }
+
+  // The shortest block at each sample rate that's good enough, with
+  // the threshold that gets there with the fewest false alarms
+  if (!csv) {
+    printf("\n# Shortest blocks with >= %.1f%% detected and <= %.1f%% false alarms:\n",
+           target_detect, target_false);
+
+    for (int i = 0; i < n_fs; i++) {
+      sweep_config_t *best = NULL;
+
+      for (k = 0; k < job.n_configs; k++) {
+        sweep_config_t *cfg = &job.configs[k];
+        if (cfg->failed || cfg->Fs != fs_list[i]) continue;
+        if (100.0 * cfg->n_detected / params.n_symbols < target_detect) continue;
+        if (100.0 * cfg->n_false / params.n_symbols > target_false) continue;
+
+        if (!best || cfg->block_len < best->block_len ||
+            (cfg->block_len == best->block_len && cfg->n_false < best->n_false)) {
+          best = cfg;
+        }
+      }
+
+      if (best) {
+        printf("#   Fs=%g: block_len=%u (%.1fms), threshold=%g, latency %.2fms\n",
+               best->Fs, best->block_len, 1000 * best->block_len / best->Fs,
+               best->threshold, best->latency_ms);
+      } else {
+        printf("#   Fs=%g: nothing meets the targets\n", fs_list[i]);
+      }
+    }
+  }
+
+  free(job.configs);
+  return retval;
+}
+
+/** \} */ // End doxygen group
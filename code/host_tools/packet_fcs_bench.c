@@ -0,0 +1,160 @@
+/**
+ * \file packet_fcs_bench.c
+ * \brief Host tool: benchmark the packet FCS
+ *
+ * \addtogroup host_tools
+ * \{
+ *
+ * This times packet_fcs() over a 1kB buffer, both in one call (as
+ * packet_frame() does) and a byte at a time (as the parser does), and
+ * reports the throughput of each.  For comparison, it includes a copy
+ * of the old bit at a time FCS.
+ *
+ * Which tables packet_fcs() uses is fixed at build time by
+ * PACKET_FCS_SLICES, so host_tools.mk builds one of these for each
+ * setting: packet_fcs_bench0, packet_fcs_bench1, and so on.
+ *
+ * As with sin_gen_bench, each case is timed several times over and
+ * only the fastest pass is reported.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "packet.h"
+
+#define BENCH_BUFLEN 1024 //!< Bytes per checksum
+
+static uint8_t bench_buf[BENCH_BUFLEN]; //!< What gets checksummed
+static volatile uint16_t bench_crc; //!< Where the results go, so they're kept
+
+/**
+ * The old bit at a time FCS, for comparison
+ */
+static uint16_t legacy_fcs(const uint8_t *buf, uint16_t buflen, uint16_t crc) {
+  for (int i = 0; i < buflen; i++) {
+    uint8_t x = buf[i];
+    for (int j = 0; j < 8; j++) {
+      crc=((crc&1)^(x&1))?(crc>>1)^0x8408:crc>>1;
+      x >>= 1;
+    }
+  }
+  return crc;
+}
+
+static void fcs_legacy(void) {
+  bench_crc = legacy_fcs(bench_buf, BENCH_BUFLEN, PACKET_FCS_INITIAL);
+}
+
+static void fcs_bulk(void) {
+  bench_crc = packet_fcs(bench_buf, BENCH_BUFLEN, PACKET_FCS_INITIAL);
+}
+
+static void fcs_bytewise(void) {
+  uint16_t crc = PACKET_FCS_INITIAL;
+
+  for (int i = 0; i < BENCH_BUFLEN; i++) {
+    crc = packet_fcs(bench_buf + i, 1, crc);
+  }
+  bench_crc = crc;
+}
+
+/**
+ * One benchmark case
+ */
+typedef struct bench_case {
+  const char *name; //!< What to call it
+  void (*run)(void); //!< Checksums bench_buf once
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+  { "legacy bitwise", fcs_legacy },
+  { "packet_fcs() bulk", fcs_bulk },
+  { "packet_fcs() per byte", fcs_bytewise },
+};
+
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Time one case
+ *
+ * \returns The fastest pass, in MB/s
+ */
+static double bench_run(const bench_case_t *bc, int reps, int inner) {
+  double best = -1;
+
+  // One untimed pass to warm the caches up
+  bc->run();
+
+  for (int r = 0; r < reps; r++) {
+    double t0 = now();
+    for (int k = 0; k < inner; k++) {
+      bc->run();
+    }
+    double t = now() - t0;
+
+    if (best < 0 || t < best) best = t;
+  }
+
+  return (double)inner * BENCH_BUFLEN / best / 1e6;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "\n"
+          "Benchmarks the packet FCS over %d-byte buffers.\n"
+          "\n"
+          "  -r reps        timed passes per case, fastest is kept (default 15)\n"
+          "  -n inner       checksums per timed pass (default 2000)\n",
+          argv0, BENCH_BUFLEN);
+}
+
+int main(int argc, char *argv[]) {
+  int reps = 15;
+  int inner = 2000;
+
+  int c;
+  while ((c = getopt(argc, argv, "r:n:h")) != -1) {
+    switch (c) {
+    case 'r': reps = atoi(optarg); break;
+    case 'n': inner = atoi(optarg); break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+
+  if (reps < 1) reps = 1;
+  if (inner < 1) inner = 1;
+
+  for (int i = 0; i < BENCH_BUFLEN; i++) bench_buf[i] = rand();
+
+  if (legacy_fcs(bench_buf, BENCH_BUFLEN, PACKET_FCS_INITIAL) !=
+      packet_fcs(bench_buf, BENCH_BUFLEN, PACKET_FCS_INITIAL)) {
+    fprintf(stderr, "packet_fcs() doesn't match the bitwise FCS!\n");
+    return 1;
+  }
+
+  const int n_cases = sizeof(bench_cases)/sizeof(bench_cases[0]);
+  double legacy = 0;
+
+  printf("PACKET_FCS_SLICES=%d\n", PACKET_FCS_SLICES);
+  printf("%-24s %10s %8s\n", "fcs", "MB/s", "speedup");
+  for (int i = 0; i < n_cases; i++) {
+    double mbps = bench_run(&bench_cases[i], reps, inner);
+    if (0 == i) legacy = mbps;
+
+    printf("%-24s %10.1f %7.1fx\n", bench_cases[i].name, mbps, mbps / legacy);
+  }
+
+  return 0;
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,208 @@
+/**
+ * \file sin_gen_bench.c
+ * \brief Host tool: benchmark the sine generator
+ *
+ * \addtogroup host_tools
+ * \{
+ *
+ * This times 1024-sample waveform fills through each of the ways
+ * sin_gen can make them, and reports what each costs per sample.
+ * For comparison, it includes a copy of the old floating point
+ * sin_gen_sin(), from before it became a wrapper around the binary
+ * angle version.
+ *
+ * As with dtmf_bench, each case is timed several times over and only
+ * the fastest pass is reported.
+ *
+ * Build with `make -f host_tools.mk host-tools`, or just run
+ * `make -f host_tools.mk host-bench`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "sin_gen.h"
+
+#define BENCH_BUFLEN 1024 //!< Samples per fill
+#define BENCH_F_TONE 1209 //!< Tone to generate
+#define BENCH_F_SAMPLE 50000 //!< Sample rate to generate it at
+
+static uint8_t bench_buf[BENCH_BUFLEN]; //!< Where the fills go
+static uint16_t bench_buf12[BENCH_BUFLEN]; //!< Where the 12b fills go
+static uint8_t legacy_table[256]; //!< Quarter wave for legacy_sin_gen_sin()
+
+/**
+ * Pull the quarter wave table back out of the real sin_gen
+ */
+static void legacy_table_init(void) {
+  for (int i = 0; i < 256; i++) {
+    legacy_table[i] = sin_gen_sin_bam32((uint32_t)i << 22, 1) - 127;
+  }
+}
+
+/**
+ * The old sin_gen_sin(), for comparison: float multiply to a table
+ * index, round half up by hand, then fold into the quadrant.
+ */
+static uint8_t legacy_sin_gen_sin(float theta, uint8_t scale) {
+  float cursor_pos_f = theta * 256/COS_THETA0;
+  int ipart = cursor_pos_f;
+  if (cursor_pos_f - ipart > 0.5) ipart++;
+
+  uint16_t cursor_pos = ipart % 1024;
+  uint8_t cursor_quadrant = cursor_pos / 256;
+  uint8_t i = cursor_pos % 256;
+  if (cursor_quadrant & 1) i = 256 - 1 - i;
+
+  if (cursor_quadrant > 1)
+    return 127-legacy_table[i]/scale;
+  return 127+legacy_table[i]/scale;
+}
+
+static void fill_legacy(void) {
+  float theta = 0;
+  float dtheta = 4*COS_THETA0 * BENCH_F_TONE / BENCH_F_SAMPLE;
+
+  for (int i = 0; i < BENCH_BUFLEN; i++) {
+    bench_buf[i] = legacy_sin_gen_sin(theta, 1);
+    theta += dtheta;
+  }
+}
+
+static void fill_float(void) {
+  float theta = 0;
+  float dtheta = 4*COS_THETA0 * BENCH_F_TONE / BENCH_F_SAMPLE;
+
+  for (int i = 0; i < BENCH_BUFLEN; i++) {
+    bench_buf[i] = sin_gen_sin(theta, 1);
+    theta += dtheta;
+  }
+}
+
+static void fill_bam32(void) {
+  uint32_t theta = 0;
+  uint32_t dtheta = sin_gen_nco_tuning_word(BENCH_F_TONE, BENCH_F_SAMPLE);
+
+  for (int i = 0; i < BENCH_BUFLEN; i++) {
+    bench_buf[i] = sin_gen_sin_bam32(theta, 1);
+    theta += dtheta;
+  }
+}
+
+static void fill_generate(void) {
+  sin_gen_request_t req;
+
+  sin_gen_populate(&req, bench_buf, BENCH_BUFLEN, BENCH_F_TONE, BENCH_F_SAMPLE);
+  sin_gen_generate_fill(&req);
+}
+
+static void fill_nco(void) {
+  sin_gen_nco_t nco;
+
+  sin_gen_nco_init(&nco, BENCH_F_TONE, BENCH_F_SAMPLE, SIN_THETA0, 1);
+  sin_gen_nco_fill(&nco, bench_buf, BENCH_BUFLEN);
+}
+
+static void fill_nco12(void) {
+  sin_gen_nco_t nco;
+
+  sin_gen_nco_init(&nco, BENCH_F_TONE, BENCH_F_SAMPLE, SIN_THETA0, 1);
+  sin_gen_nco_fill12(&nco, bench_buf12, BENCH_BUFLEN);
+}
+
+/**
+ * One benchmark case
+ */
+typedef struct bench_case {
+  const char *name; //!< What to call it
+  void (*fill)(void); //!< Does one fill of bench_buf
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+  { "legacy sin_gen_sin()", fill_legacy },
+  { "sin_gen_sin()", fill_float },
+  { "sin_gen_sin_bam32()", fill_bam32 },
+  { "sin_gen_generate_fill()", fill_generate },
+  { "sin_gen_nco_fill()", fill_nco },
+  { "sin_gen_nco_fill12()", fill_nco12 },
+};
+
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Time one case
+ *
+ * \returns The fastest pass, in ns per sample
+ */
+static double bench_run(const bench_case_t *bc, int reps, int inner) {
+  double best = -1;
+
+  // One untimed pass to warm the caches up
+  bc->fill();
+
+  for (int r = 0; r < reps; r++) {
+    double t0 = now();
+    for (int k = 0; k < inner; k++) {
+      bc->fill();
+      __asm__ volatile("" : : "r"(bench_buf), "r"(bench_buf12) : "memory"); // Keep the fills
+    }
+    double t = now() - t0;
+
+    if (best < 0 || t < best) best = t;
+  }
+
+  return best * 1e9 / ((double)inner * BENCH_BUFLEN);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "\n"
+          "Benchmarks %d-sample sine wave fills.\n"
+          "\n"
+          "  -r reps        timed passes per case, fastest is kept (default 15)\n"
+          "  -n inner       fills per timed pass (default 200)\n",
+          argv0, BENCH_BUFLEN);
+}
+
+int main(int argc, char *argv[]) {
+  int reps = 15;
+  int inner = 200;
+
+  int c;
+  while ((c = getopt(argc, argv, "r:n:h")) != -1) {
+    switch (c) {
+    case 'r': reps = atoi(optarg); break;
+    case 'n': inner = atoi(optarg); break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+
+  if (reps < 1) reps = 1;
+  if (inner < 1) inner = 1;
+
+  legacy_table_init();
+
+  const int n_cases = sizeof(bench_cases)/sizeof(bench_cases[0]);
+  double legacy = 0;
+
+  printf("%-24s %10s %8s\n", "fill", "ns/sample", "speedup");
+  for (int i = 0; i < n_cases; i++) {
+    double ns = bench_run(&bench_cases[i], reps, inner);
+    if (0 == i) legacy = ns;
+
+    printf("%-24s %10.2f %7.1fx\n", bench_cases[i].name, ns, legacy / ns);
+  }
+
+  return 0;
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,207 @@
+#include "decimate.h"
+
+#include <string.h>
+
+/**
+ * \file decimate.c
+ * \brief A CIC decimator, to bring fast ADC streams down to DTMF rates
+ *
+ * \defgroup decimate CIC decimator
+ * \addtogroup decimate
+ * \{
+ *
+ * The DTMF decoder wants 8kHz samples, but there's no reason the ADC
+ * has to run that slowly: oversampling and decimating buys some SNR,
+ * and lets a fast multi-channel scan share the ADC with the DTMF
+ * path.  This is the block in between: it takes the ADC's DMA blocks
+ * as they come in, and hands back samples at 1/ratio the rate.
+ *
+ * It's a cascaded integrator-comb (CIC, aka Hogenauer) filter, which
+ * needs no multiplies at all: order integrators run at the input
+ * rate, and order combs run at the output rate.  The integrators are
+ * allowed to wrap around, which is fine in two's complement as long
+ * as the registers are wide enough for the filter's full gain.  See
+ * Hogenauer, "An Economical Class of Digital Filters for Decimation
+ * and Interpolation," IEEE Trans. ASSP 29(2), 1981.
+ *
+ * The output is always DECIMATE_OUT_BITS wide, to suit
+ * dtmf_process16(): the CIC's gain of ratio^order is rounded up to a
+ * power of two and shifted back out, along with any difference
+ * between the input width and DECIMATE_OUT_BITS.  So, with a
+ * power of two ratio, 8b input samples come out as 12b samples with
+ * the same offset and amplitude multiplied by 16.  Otherwise, use
+ * decimate_gain() to find out what to multiply the input offset and
+ * scale by to get those of the output.
+ *
+ * A CIC's passband isn't flat: for a ratio of 6 and an order of 3
+ * (48kHz to 8kHz), the highest DTMF column tone comes out about 1.8dB
+ * below a 697Hz row tone.  That's well inside the twist the decoder
+ * tolerates.  Anything near a multiple of the output rate, which
+ * would alias onto the DTMF band, lands in one of the filter's nulls.
+ */
+
+/**
+ * Set up a decimator
+ *
+ * \param dec The decimator to set up (caller-owned)
+ * \param ratio Input samples per output sample (at least 1)
+ * \param order Number of integrator/comb stages (1 to DECIMATE_MAX_ORDER)
+ * \param sample_width 1 for 8b input samples, 2 for 12b samples in 16b words
+ *
+ * \returns DECIMATE_OKAY on success, DECIMATE_INVALID_INPUTS for a
+ * NULL decimator or out of range arguments, or DECIMATE_OVERFLOW if
+ * the filter's gain would need more than 32b of state.
+ *
+ * Higher orders reject aliases better but droop more in the
+ * passband; 3 is usually right.  With 8b samples, any ratio works
+ * at an order of 3; with 12b samples, the largest is 101.
+ */
+decimate_status_t decimate_init(decimate_t *dec, uint8_t ratio, uint8_t order, uint8_t sample_width) {
+  if (!dec) return DECIMATE_INVALID_INPUTS;
+
+  memset(dec, 0, sizeof(decimate_t));
+
+  if (0 == ratio || 0 == order || order > DECIMATE_MAX_ORDER) return DECIMATE_INVALID_INPUTS;
+  if (1 != sample_width && 2 != sample_width) return DECIMATE_INVALID_INPUTS;
+
+  const int in_bits = (1 == sample_width ? 8 : 12);
+
+  // Number of bits the gain adds, rounded up
+  uint64_t gain = 1;
+  for (int i = 0; i < order; i++) {
+    gain *= ratio;
+  }
+  int gain_bits = 0;
+  while (((uint64_t)1 << gain_bits) < gain) {
+    gain_bits++;
+  }
+
+  if (in_bits + gain_bits > 32) return DECIMATE_OVERFLOW;
+
+  dec->ratio = ratio;
+  dec->order = order;
+  dec->sample_width = sample_width;
+  dec->shift = gain_bits + in_bits - DECIMATE_OUT_BITS;
+
+  return DECIMATE_OKAY;
+}
+
+/**
+ * Reset a decimator's filter state
+ *
+ * \param dec The decimator to reset
+ *
+ * This throws away any partial output sample, and starts the filters
+ * from zero.  The first order output samples after this are ramping
+ * up, as the combs fill.
+ */
+void decimate_reset(decimate_t *dec) {
+  dec->phase = 0;
+  memset(dec->integ, 0, sizeof(dec->integ));
+  memset(dec->comb, 0, sizeof(dec->comb));
+}
+
+/**
+ * Decimate a block of samples
+ *
+ * \param dec The decimator to use, set up by decimate_init()
+ * \param buf The first sample to decimate
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many input samples to process
+ * \param out[out] Where to put the output samples, which must have room
+ * for n_samples/ratio + 1 of them
+ *
+ * \returns The number of output samples written
+ *
+ * This picks up where the last call left off, so blocks can be any
+ * length.  The stride lets you point it straight at one channel of
+ * an interleaved multi-channel ADC buffer: for channel k of n, pass
+ * in buf + k*sample_width and a stride of n, and use one decimator
+ * per channel.
+ *
+ * This is meant to run in the ADC callback, so the filter state is
+ * kept in locals for the duration, to keep the stores to out from
+ * forcing it back out to memory on every sample.
+ */
+uint16_t decimate_run(decimate_t *dec, const uint8_t *buf, uint8_t stride, uint16_t n_samples,
+                      uint16_t *out) {
+  const uint8_t ratio = dec->ratio;
+  const uint8_t order = dec->order;
+  const int8_t shift = dec->shift;
+  const uint16_t *buf16 = (const uint16_t *)buf;
+  const bool wide = (2 == dec->sample_width);
+
+  uint8_t phase = dec->phase;
+  uint32_t integ[DECIMATE_MAX_ORDER];
+  uint32_t comb[DECIMATE_MAX_ORDER];
+  memcpy(integ, dec->integ, sizeof(integ));
+  memcpy(comb, dec->comb, sizeof(comb));
+
+  uint16_t n_out = 0;
+
+  for (uint32_t i = 0; i < n_samples; i++) {
+    uint32_t x = (wide ? buf16[i*stride] : buf[i*stride]);
+
+    for (int k = 0; k < order; k++) {
+      integ[k] += x;
+      x = integ[k];
+    }
+
+    if (++phase < ratio) continue;
+    phase = 0;
+
+    for (int k = 0; k < order; k++) {
+      uint32_t y = x - comb[k];
+      comb[k] = x;
+      x = y;
+    }
+
+    out[n_out++] = (shift >= 0 ? x >> shift : x << -shift);
+  }
+
+  dec->phase = phase;
+  memcpy(dec->integ, integ, sizeof(integ));
+  memcpy(dec->comb, comb, sizeof(comb));
+
+  return n_out;
+}
+
+/**
+ * Get the DC gain of a decimator, from input counts to output counts
+ *
+ * \param dec The decimator, set up by decimate_init()
+ *
+ * \returns What a constant input comes out multiplied by
+ *
+ * Multiply the input's offset and scale by this to get what to pass
+ * to dtmf_decoder_set_calibration() for the output.
+ */
+float decimate_gain(const decimate_t *dec) {
+  float gain = 1;
+  for (int i = 0; i < dec->order; i++) {
+    gain *= dec->ratio;
+  }
+
+  for (int i = 0; i < dec->shift; i++) gain /= 2;
+  for (int i = 0; i > dec->shift; i--) gain *= 2;
+
+  return gain;
+}
+
+/**
+ * Get a printable name for a decimate_status_t
+ *
+ * \param status The status to look up
+ *
+ * \returns A constant string, or NULL for unknown values
+ */
+const char *decimate_status_name(decimate_status_t status) {
+  switch(status) {
+  case DECIMATE_OKAY: return "OKAY";
+  case DECIMATE_INVALID_INPUTS: return "INVALID_INPUTS";
+  case DECIMATE_OVERFLOW: return "OVERFLOW";
+  default: return NULL;
+  }
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+/**
+ * \file decimate.h
+ * \brief Header for the CIC decimator
+ *
+ * \addtogroup decimate
+ * \{
+ */
+
+#define DECIMATE_MAX_ORDER 4 //!< Most integrator/comb stages a decimator can have
+#define DECIMATE_OUT_BITS 12 //!< Width of the output samples, regardless of input width
+
+/**
+ * Status codes for setting up a decimator
+ */
+typedef enum decimate_status {
+			      DECIMATE_OKAY = 0, //!< The decimator is ready to use
+			      DECIMATE_INVALID_INPUTS, //!< NULL pointer, bad ratio/order, or bad sample width
+			      DECIMATE_OVERFLOW, //!< The ratio and order need more than 32b of state
+} decimate_status_t;
+
+/**
+ * A CIC decimator for one channel
+ *
+ * These are caller-owned: set one up with decimate_init(), then feed
+ * it with decimate_run().  All the filter state is carried across
+ * calls, so blocks don't have to be a multiple of the ratio.
+ */
+typedef struct decimate {
+  uint8_t ratio; //!< Input samples per output sample
+  uint8_t order; //!< Number of integrator and comb stages
+  uint8_t sample_width; //!< 1 for 8b input samples, 2 for 12b samples in 16b words
+  int8_t shift; //!< Right shift to bring the CIC output down to DECIMATE_OUT_BITS
+
+  uint8_t phase; //!< Input samples into the current output sample
+  uint32_t integ[DECIMATE_MAX_ORDER]; //!< Integrator states
+  uint32_t comb[DECIMATE_MAX_ORDER]; //!< Comb delay lines (one sample each)
+} decimate_t;
+
+decimate_status_t decimate_init(decimate_t *, uint8_t, uint8_t, uint8_t);
+void decimate_reset(decimate_t *);
+uint16_t decimate_run(decimate_t *, const uint8_t *, uint8_t, uint16_t, uint16_t *);
+float decimate_gain(const decimate_t *);
+const char *decimate_status_name(decimate_status_t);
+
+/** \} */ // End doxygen group
@@ -4,7 +4,7 @@
 
 #ifndef M_PI
 #include "sin_gen.h"
-#define M_PI 2*COS_THETA0
+#define M_PI (2*COS_THETA0)
 #endif
 
 /**
@@ -28,8 +28,12 @@
  *
  * You can find a much longer explanation than DT0089 in
  * code/notebooks/dtmf_filter_design.ipynb , where we re-derive some
- * key bits, and test out a python version of the implementation found
- * below.
+ * key bits, and test out a python version of the implementation.
+ *
+ * The filters themselves live in goertzel.c: each decoder keeps an
+ * eight-bin goertzel_bank_t for the DTMF tones, and this file takes
+ * care of normalization, windowing, and turning magnitudes into
+ * symbols.
  */
 
 
@@ -44,8 +48,7 @@ static const float dtmf_tones[8] = { 697,770, 852, 941,  // rows
  */
 static const uint8_t dtmf_symbols[] = "123A456B789C*0#D";
 
-static dtmf_decoder_config_t dtmf_config; //!< Our configuration
-static dtmf_decoder_state_t dtmf_state; //!< The current decoder state
+static dtmf_decoder_t dtmf_default_decoder; //!< The decoder behind the dtmf_init()/dtmf_process() API
 
 /**
  * Fill in the given float pointers with the tones for the given symbol
@@ -75,17 +78,28 @@ dtmf_status_t dtmf_get_tones(uint8_t symbol, float *row_tone, float *col_tone) {
 
 
 
+static void dtmf_stream_restart(dtmf_decoder_t *dec);
+static void dtmf_process_channels(dtmf_decoder_t *decoders, uint8_t n_channels,
+                                  const uint8_t *buf, uint8_t sample_width, uint16_t buflen);
+
 /**
- * \brief Reset the internal state of the DTMF decoder
+ * \brief Reset the symbol tracking state of a DTMF decoder
+ *
+ * \param dec The decoder to reset
  *
- * Note that this resets all the cos/sin tables to zero, along with
- * the historic z values and the cur_symbol_dt.  It also sets
- * cur_symbol to DTMF_SYMBOL_NONE, to indicate that nothing has been
- * decoded.
+ * This sets cur_symbol to DTMF_SYMBOL_NONE, to indicate that nothing
+ * has been decoded, and zeroes cur_symbol_dt and the sample counter
+ * used for event timestamps.  In streaming mode, any partially
+ * accumulated windows are thrown away as well.  The filter
+ * tables and configuration are left alone, so the decoder can be used
+ * again straight away.  No callbacks are made, even if a symbol was
+ * down.
  */
-static void dtmf_reset_internals(void) {
-  memset(&dtmf_state, 0, sizeof(dtmf_decoder_state_t));
-  dtmf_state.cur_symbol = DTMF_SYMBOL_NONE;
+void dtmf_decoder_reset(dtmf_decoder_t *dec) {
+  dec->state.cur_symbol = DTMF_SYMBOL_NONE;
+  dec->state.cur_symbol_dt = 0;
+  dec->state.samples = 0;
+  dtmf_stream_restart(dec);
 }
 
 
@@ -102,38 +116,86 @@ static void dtmf_reset_internals(void) {
  * dtmf_process() with every time.  When in doubt, 0.2 is probably
  * safe.  For a lot (and I do mean a lot) more detail, see the
  * notebook for this file, code/notebooks/dtmf_filter_design.ipynb .
- * All of the math is worked out in there.
+ * All of the math is worked out in there.  To see how a given block
+ * length and threshold hold up against noise, twist and off-frequency
+ * tones, run the host sweep tool, host_tools/dtmf_sweep.c .
  *
  * The code in the callbacks should be treated with care.  You may
  * call them from inside an ISR, so be thoughtful about how much work
  * you do in them.
+ *
+ * This uses the floating point backend; see dtmf_init_backend() if
+ * you want to pick a different one.
  */
 void dtmf_init(float Fs, float threshold, dtmf_down_callback down_callback, dtmf_up_callback up_callback) {
-  dtmf_reset_internals();
+  dtmf_init_backend(Fs, threshold, down_callback, up_callback, DTMF_BACKEND_FLOAT);
+}
 
-  memset(&dtmf_config, 0, sizeof(dtmf_decoder_config_t));
-  dtmf_config.Fs = Fs;
-  dtmf_config.threshold = threshold;
-  dtmf_config.down_cb = down_callback;
-  dtmf_config.up_cb = up_callback;
+/**
+ * Initialize for DTMF decoding, selecting the filter arithmetic
+ *
+ * \param Fs The sampling rate, in samples per second ("Hz")
+ * \param threshold The threshold to consider a tone a "hit"
+ * \param down_cb The callback when a new tone is detected (button down)
+ * \param up_cb The callback when a tone ends (button up)
+ * \param backend Which arithmetic to run the Goertzel filters in
+ *
+ * See dtmf_init() for the details on the first four parameters.
+ *
+ * DTMF_BACKEND_FLOAT runs the filters in single precision float on
+ * normalized samples.  DTMF_BACKEND_FIXED runs them as integer
+ * recurrences directly on the raw samples, with Q14 coefficients and
+ * the threshold rescaled into raw sample units, so the only floating
+ * point left per buffer is the magnitude passed to down_cb.  The two
+ * make the same decisions to within rounding of the coefficients.
+ */
+void dtmf_init_backend(float Fs, float threshold,
+                       dtmf_down_callback down_callback, dtmf_up_callback up_callback,
+                       dtmf_backend_t backend) {
+  dtmf_decoder_init(&dtmf_default_decoder, Fs, threshold, down_callback, up_callback, backend);
+}
 
-  // Populate our sine/cos tables
-  for (int tone_no = 0; tone_no < 8; tone_no++) {
-    float w = 2 * M_PI * dtmf_tones[tone_no]/dtmf_config.Fs;
-    dtmf_state.cos_w_table[tone_no] = cosf(w);
-    dtmf_state.sin_w_table[tone_no] = sinf(w);
-
-    /*
-    printf("DTMF populate: tone %d / %d Hz Fs=%d: w=%d cos_w=%d sin_w=%d\n",
-           tone_no,
-           (int)(dtmf_tones[tone_no]),
-           (int)Fs,
-           (int)(1000*w),
-           (int)(1000*dtmf_state.cos_w_table[tone_no]),
-           (int)(1000*dtmf_state.sin_w_table[tone_no])
-           );
-    */
-  }
+/**
+ * Initialize a DTMF decoder context
+ *
+ * \param dec The decoder to set up (caller-owned)
+ * \param Fs The sampling rate, in samples per second ("Hz")
+ * \param threshold The threshold to consider a tone a "hit"
+ * \param down_cb The callback when a new tone is detected (button down)
+ * \param up_cb The callback when a tone ends (button up)
+ * \param backend Which arithmetic to run the Goertzel filters in
+ *
+ * This is the reentrant version of dtmf_init_backend(), which just
+ * calls this on a file-static decoder.  Each decoder carries its own
+ * configuration, filter tables, and symbol state, so you can run as
+ * many of them as you have audio streams.
+ */
+void dtmf_decoder_init(dtmf_decoder_t *dec, float Fs, float threshold,
+                       dtmf_down_callback down_callback, dtmf_up_callback up_callback,
+                       dtmf_backend_t backend) {
+  memset(dec, 0, sizeof(dtmf_decoder_t));
+  dtmf_decoder_reset(dec);
+
+  dec->config.Fs = Fs;
+  dec->config.threshold = threshold;
+  dec->config.backend = backend;
+  dec->config.down_cb = down_callback;
+  dec->config.up_cb = up_callback;
+  dec->state.window_gain2 = 1.0;
+
+  // Fixed point threshold: the float path compares mags against
+  // threshold^2 after dividing out 127^2 (normalization) and N/2, so
+  // we fold the 127^2 and our sample shift in here, and the N/2 in at
+  // comparison time.
+  dec->state.threshold_q = (uint64_t)(threshold * threshold * 127 * 127 * (1 << (2*DTMF_SAMPLE_SHIFT)));
+
+  // And the same for 12b samples, which start out assuming a
+  // mid-scale bias until told otherwise.
+  dtmf_decoder_set_calibration(dec, DTMF_OFFSET16_DEFAULT, DTMF_SCALE16_DEFAULT, false);
+
+  // Set up the filter bank; if Fs is too low for the upper tones,
+  // the bank comes back empty, and nothing will ever be detected.
+  goertzel_bank_init(&dec->state.bank, Fs, dtmf_tones, 8);
 }
 
 /**
@@ -157,31 +219,531 @@ static uint8_t decode_symbol(uint8_t row, uint8_t col) {
  *
  * Doing it this way centralizes a lot of logic that is otherwise
  * duplicated all over the place.
+ *
+ * The start is the sample number (counted from the last reset) of
+ * the first sample in the window that produced this decision, which
+ * is used to timestamp events if the decoder has an event log
+ * attached.  Either callback may be NULL.
  */
-static void dtmf_sym_decoded(uint8_t new_symbol, float best_row_mag, float best_col_mag, float dt) {
+static void dtmf_sym_decoded(dtmf_decoder_t *dec, uint8_t new_symbol,
+                             float best_row_mag, float best_col_mag, float dt,
+                             uint32_t start) {
   // If symbol matches what we have, just increment dt and return
-  if (new_symbol == dtmf_state.cur_symbol) {
-    dtmf_state.cur_symbol_dt += dt;
+  if (new_symbol == dec->state.cur_symbol) {
+    dec->state.cur_symbol_dt += dt;
     return;
   }
 
   // Otherwise, if we have a valid symbol, do an up state
-  if (DTMF_SYMBOL_NONE != dtmf_state.cur_symbol) {
-    dtmf_config.up_cb(dtmf_state.cur_symbol, dtmf_state.cur_symbol_dt);
+  if (DTMF_SYMBOL_NONE != dec->state.cur_symbol) {
+    if (dec->state.events && !dec->state.events_overflow && dec->state.n_events > 0) {
+      dtmf_event_t *ev = &dec->state.events[dec->state.n_events-1];
+      ev->duration = start - ev->start;
+    }
+
+    if (dec->config.up_cb) {
+      dec->config.up_cb(dec->state.cur_symbol, dec->state.cur_symbol_dt);
+    }
   }
 
   // Then set our new state
-  dtmf_state.cur_symbol = new_symbol;
-  dtmf_state.cur_symbol_dt = dt;
+  dec->state.cur_symbol = new_symbol;
+  dec->state.cur_symbol_dt = dt;
 
   // And if it's a valid symbol, do a down_cb
   if (DTMF_SYMBOL_NONE != new_symbol) {
-    dtmf_config.down_cb(new_symbol, (best_col_mag < best_row_mag ? best_col_mag : best_row_mag));
+    float power = (best_col_mag < best_row_mag ? best_col_mag : best_row_mag);
+
+    if (dec->state.events) {
+      if (dec->state.n_events < dec->state.max_events) {
+        dtmf_event_t *ev = &dec->state.events[dec->state.n_events];
+        ev->symbol = new_symbol;
+        ev->start = start;
+        ev->duration = 0;
+        ev->power = power;
+        dec->state.n_events++;
+      } else {
+        dec->state.events_overflow = true;
+      }
+    }
+
+    if (dec->config.down_cb) {
+      dec->config.down_cb(new_symbol, power);
+    }
   }
   return;
 }
 
 
+/**
+ * Run the bank of Goertzel filters over a buffer
+ *
+ * \param buf A buffer of uint8_t samples from the ADC
+ * \param buflen The length of the buffer (must be at least 2)
+ * \param mags[out] The magnitude-squared of each tone, coindexed with dtmf_tones
+ *
+ * This runs the floating point filters with the tables set up by the
+ * last dtmf_init(), without making any decisions about symbols.
+ */
+void dtmf_goertzel(const uint8_t *buf, uint16_t buflen, float *mags) {
+  const goertzel_bank_t *bank = &dtmf_default_decoder.state.bank;
+  float z1[8] = { 0 };
+  float z2[8] = { 0 };
+
+  memset(mags, 0, 8 * sizeof(float));
+  goertzel_feed_float(bank, z1, z2, buf, 1, 1, buflen, NULL, 127, 1/127.0f);
+  goertzel_mags_float(bank, z1, z2, mags);
+
+  for (int tone_no = 0; tone_no < 8; tone_no++) {
+    mags[tone_no] /= (buflen/2);  // Apply correction factor
+  }
+}
+
+/**
+ * Run the bank of Goertzel filters over a buffer in integer arithmetic
+ *
+ * \param buf A buffer of uint8_t samples from the ADC
+ * \param buflen The length of the buffer
+ * \param mags[out] The raw magnitude-squared of each tone, coindexed with dtmf_tones
+ *
+ * This is the fixed point twin of dtmf_goertzel().  The magnitudes
+ * are not normalized: to compare them with the output of
+ * dtmf_goertzel(), divide by (127 << DTMF_SAMPLE_SHIFT)^2 * (buflen/2).
+ */
+void dtmf_goertzel_fixed(const uint8_t *buf, uint16_t buflen, int64_t *mags) {
+  const goertzel_bank_t *bank = &dtmf_default_decoder.state.bank;
+  int32_t z1[8] = { 0 };
+  int32_t z2[8] = { 0 };
+
+  memset(mags, 0, 8 * sizeof(int64_t));
+  goertzel_feed_fixed(bank, z1, z2, buf, 1, 1, buflen, NULL,
+                      127 << DTMF_SAMPLE_SHIFT, DTMF_SAMPLE_SHIFT);
+  goertzel_mags_fixed(bank, z1, z2, mags);
+}
+
+
+/**
+ * (Internal) Decide on a symbol given floating point magnitudes
+ *
+ * \param dec The decoder the magnitudes came from
+ * \param mags The normalized magnitude-squared of each tone
+ * \param gain2 The square of the window's coherent gain (1 for no window)
+ * \param dt How much time these magnitudes represent
+ * \param start The sample number the window started at
+ */
+static void dtmf_decide_float(dtmf_decoder_t *dec, const float *mags, float gain2, float dt,
+                              uint32_t start) {
+  uint8_t best_row = 0xFF;
+  float best_row_mag = 0;
+
+  uint8_t best_col = 0xFF;
+  float best_col_mag = 0;
+
+  for (int tone_no = 0; tone_no < 4; tone_no++) {
+    if (mags[tone_no] > best_row_mag) {
+      best_row_mag = mags[tone_no];
+      best_row = tone_no;
+    }
+  }
+
+  for (int tone_no = 4; tone_no < 8; tone_no++) {
+    if (mags[tone_no] > best_col_mag) {
+      best_col_mag = mags[tone_no];
+      best_col = tone_no;
+    }
+  }
+
+  // Undo any windowing loss before comparing
+  best_row_mag /= gain2;
+  best_col_mag /= gain2;
+
+  // Fix up threshold to use mag-squared and avoid sqrt
+  float th = dec->config.threshold * dec->config.threshold;
+
+  // If neither is good enough, send a NONE (decoded will de-dupe)
+  if ((best_row_mag < th) || (best_col_mag < th)) {
+    dtmf_sym_decoded(dec, DTMF_SYMBOL_NONE, best_row_mag, best_col_mag, dt, start);
+    return;
+  }
+
+  dtmf_sym_decoded(dec, decode_symbol(best_row, best_col-4), best_row_mag, best_col_mag, dt, start);
+}
+
+/**
+ * (Internal) Decide on a symbol given raw integer magnitudes
+ *
+ * \param dec The decoder the magnitudes came from
+ * \param mags The raw magnitude-squared of each tone
+ * \param th_q The threshold, in the same raw units as mags
+ * \param norm What to divide mags by to normalize them for the callbacks
+ * \param dt How much time these magnitudes represent
+ * \param start The sample number the window started at
+ */
+static void dtmf_decide_fixed(dtmf_decoder_t *dec, const int64_t *mags,
+                              uint64_t th_q, float norm, float dt, uint32_t start) {
+  uint8_t best_row = 0xFF;
+  int64_t best_row_mag_q = 0;
+
+  uint8_t best_col = 0xFF;
+  int64_t best_col_mag_q = 0;
+
+  for (int tone_no = 0; tone_no < 4; tone_no++) {
+    if (mags[tone_no] > best_row_mag_q) {
+      best_row_mag_q = mags[tone_no];
+      best_row = tone_no;
+    }
+  }
+
+  for (int tone_no = 4; tone_no < 8; tone_no++) {
+    if (mags[tone_no] > best_col_mag_q) {
+      best_col_mag_q = mags[tone_no];
+      best_col = tone_no;
+    }
+  }
+
+  bool hit = ((uint64_t)best_row_mag_q >= th_q) && ((uint64_t)best_col_mag_q >= th_q);
+
+  // And only go to float for the benefit of the callbacks
+  float best_row_mag = best_row_mag_q / norm;
+  float best_col_mag = best_col_mag_q / norm;
+
+  // If neither is good enough, send a NONE (decoded will de-dupe)
+  if (!hit) {
+    dtmf_sym_decoded(dec, DTMF_SYMBOL_NONE, best_row_mag, best_col_mag, dt, start);
+    return;
+  }
+
+  dtmf_sym_decoded(dec, decode_symbol(best_row, best_col-4), best_row_mag, best_col_mag, dt, start);
+}
+
+
+/**
+ * (Internal) Push samples of either width through a decoder's filters
+ *
+ * \param dec The decoder for this channel
+ * \param tables The decoder state to take filter coefficients from
+ * \param acc The filter states to update
+ * \param buf The first sample to process
+ * \param sample_width 1 for 8b samples, 2 for 12b samples in 16b words
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many samples to process
+ * \param window Q15 window weights for these samples, or NULL for none
+ *
+ * \returns The sum of the raw samples
+ */
+static uint32_t dtmf_feed(const dtmf_decoder_t *dec, const dtmf_decoder_state_t *tables,
+                          dtmf_accumulator_t *acc, const uint8_t *buf, uint8_t sample_width,
+                          uint8_t stride, uint16_t n_samples, const int16_t *window) {
+  const goertzel_bank_t *bank = &tables->bank;
+
+  if (DTMF_BACKEND_FIXED == dec->config.backend) {
+    if (2 == sample_width) {
+      return goertzel_feed_fixed(bank, acc->z1_q, acc->z2_q, buf, 2, stride, n_samples, window,
+                                 dec->state.offset16_q, DTMF_SAMPLE_SHIFT16);
+    }
+    return goertzel_feed_fixed(bank, acc->z1_q, acc->z2_q, buf, 1, stride, n_samples, window,
+                               127 << DTMF_SAMPLE_SHIFT, DTMF_SAMPLE_SHIFT);
+  }
+
+  if (2 == sample_width) {
+    return goertzel_feed_float(bank, acc->z1, acc->z2, buf, 2, stride, n_samples, window,
+                               dec->state.offset16, dec->state.inv_scale16);
+  }
+  return goertzel_feed_float(bank, acc->z1, acc->z2, buf, 1, stride, n_samples, window,
+                             127, 1/127.0f);
+}
+
+/**
+ * (Internal) Decide on a symbol from a full window of filter states
+ *
+ * \param dec The decoder for this channel
+ * \param tables The decoder state to take filter coefficients from
+ * \param acc The filter states at the end of the window
+ * \param sample_width 1 for 8b samples, 2 for 12b samples in 16b words
+ * \param n_samples How many samples went into the window
+ * \param gain2 The square of the window's coherent gain (1 for no window)
+ * \param dt How much time this decision represents
+ * \param start The sample number the window started at
+ */
+static void dtmf_decide(dtmf_decoder_t *dec, const dtmf_decoder_state_t *tables,
+                        const dtmf_accumulator_t *acc, uint8_t sample_width, uint16_t n_samples,
+                        float gain2, float dt, uint32_t start) {
+  if (DTMF_BACKEND_FIXED == dec->config.backend) {
+    int64_t mags[8] = { 0 };
+    goertzel_mags_fixed(&tables->bank, acc->z1_q, acc->z2_q, mags);
+
+    // Compare against the threshold in raw units, see dtmf_decoder_init()
+    float full_scale = 127 << DTMF_SAMPLE_SHIFT;
+    uint64_t th_q = dec->state.threshold_q;
+
+    if (2 == sample_width) {
+      full_scale = dec->state.scale16 * (1 << DTMF_SAMPLE_SHIFT16);
+      th_q = dec->state.threshold16_q;
+    }
+
+    th_q *= n_samples/2;
+    if (1.0f != gain2) {
+      th_q = (uint64_t)(th_q * gain2);
+    }
+    float norm = full_scale * full_scale * (n_samples/2) * gain2;
+
+    dtmf_decide_fixed(dec, mags, th_q, norm, dt, start);
+  } else {
+    float mags[8] = { 0 };
+    goertzel_mags_float(&tables->bank, acc->z1, acc->z2, mags);
+
+    for (int tone_no = 0; tone_no < 8; tone_no++) {
+      mags[tone_no] /= (n_samples/2);  // Apply correction factor
+    }
+
+    dtmf_decide_float(dec, mags, gain2, dt, start);
+  }
+}
+
+/**
+ * (Internal) Set the 12b DC offset of a decoder
+ */
+static void dtmf_set_offset16(dtmf_decoder_t *dec, float offset) {
+  dec->state.offset16 = offset;
+  dec->state.offset16_q = lroundf(offset * (1 << DTMF_SAMPLE_SHIFT16));
+}
+
+/**
+ * (Internal) Nudge the 12b DC offset towards the mean of a buffer
+ *
+ * \param dec The decoder to update
+ * \param sum The sum of the raw samples in the buffer
+ * \param n_samples How many samples were in the buffer
+ *
+ * This is a first order lowpass on the per-buffer means, with a time
+ * constant of 2^DTMF_OFFSET_TRACK_SHIFT buffers.  It only does
+ * anything if the decoder's track_offset is set.
+ */
+static void dtmf_track_offset16(dtmf_decoder_t *dec, uint32_t sum, uint16_t n_samples) {
+  if (!dec->config.track_offset || 0 == n_samples) return;
+
+  float mean = (float)sum / n_samples;
+  float offset = dec->state.offset16;
+
+  dtmf_set_offset16(dec, offset + (mean - offset) / (1 << DTMF_OFFSET_TRACK_SHIFT));
+}
+
+/**
+ * (Internal) Filter one channel's worth of samples, and act on the result
+ *
+ * \param dec The decoder for this channel
+ * \param tables The decoder state to take filter coefficients from
+ * \param buf The first sample for this channel
+ * \param sample_width 1 for 8b samples, 2 for 12b samples in 16b words
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many samples this channel has in the buffer
+ *
+ * This is the non-streaming mode, where the whole buffer is one
+ * window.  See dtmf_process() for what this does with the results.
+ */
+static void dtmf_decoder_run(dtmf_decoder_t *dec, const dtmf_decoder_state_t *tables,
+                             const uint8_t *buf, uint8_t sample_width,
+                             uint8_t stride, uint16_t n_samples) {
+  float dt = n_samples/dec->config.Fs;
+  uint32_t start = dec->state.samples;
+  dtmf_accumulator_t acc;
+
+  dec->state.samples += n_samples;
+
+  memset(&acc, 0, sizeof(acc));
+  uint32_t sum = dtmf_feed(dec, tables, &acc, buf, sample_width, stride, n_samples, NULL);
+
+  dtmf_decide(dec, tables, &acc, sample_width, n_samples, 1.0, dt, start);
+
+  if (2 == sample_width) {
+    dtmf_track_offset16(dec, sum, n_samples);
+  }
+}
+
+/**
+ * (Internal) Restart the streaming accumulators of a decoder
+ *
+ * \param dec The decoder to restart
+ *
+ * This throws away any partial windows, and staggers the
+ * accumulators by one hop each, so that once they are all running, one
+ * of them completes a window on every hop boundary.
+ */
+static void dtmf_stream_restart(dtmf_decoder_t *dec) {
+  memset(dec->state.acc, 0, sizeof(dec->state.acc));
+  dec->state.hop_pos = 0;
+
+  if (0 == dec->config.window_len) return;
+
+  for (int j = 0; j < dec->config.window_len / dec->config.hop; j++) {
+    dec->state.acc[j].n = -j * dec->config.hop;
+  }
+}
+
+/**
+ * (Internal) Feed one channel's worth of samples to the streaming accumulators
+ *
+ * \param dec The decoder for this channel
+ * \param tables The decoder state to take filter coefficients from
+ * \param buf The first sample for this channel
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many samples this channel has in the buffer
+ *
+ * The samples are taken a hop at a time (or less, at the ends of the
+ * buffer).  Because the accumulators are staggered by whole hops,
+ * at most one of them can complete a window in any given hop, and it
+ * does so at the end of it; that one is evaluated and restarted
+ * before moving on, so decisions come out in time order.
+ */
+static void dtmf_decoder_stream(dtmf_decoder_t *dec, const dtmf_decoder_state_t *tables,
+                                const uint8_t *buf, uint8_t sample_width,
+                                uint8_t stride, uint16_t n_samples) {
+  const uint16_t window_len = dec->config.window_len;
+  const uint16_t hop = dec->config.hop;
+  const int n_acc = window_len / hop;
+  const float dt = hop/dec->config.Fs;
+  const uint16_t n_total = n_samples;
+  uint32_t sum = 0;
+
+  while (n_samples > 0) {
+    uint16_t chunk = hop - dec->state.hop_pos;
+    chunk = (chunk > n_samples ? n_samples : chunk);
+
+    for (int j = 0; j < n_acc; j++) {
+      dtmf_accumulator_t *acc = &dec->state.acc[j];
+
+      if (acc->n < 0) { // Still waiting for our stagger to come up
+        acc->n += chunk;
+        continue;
+      }
+
+      const int16_t *window = dec->config.window ? dec->config.window + acc->n : NULL;
+
+      // acc[0] is never waiting, so it sees every sample exactly once
+      uint32_t acc_sum = dtmf_feed(dec, tables, acc, buf, sample_width, stride, chunk, window);
+      if (0 == j) sum += acc_sum;
+
+      acc->n += chunk;
+    }
+
+    buf += chunk * stride * sample_width;
+    n_samples -= chunk;
+    dec->state.hop_pos += chunk;
+    dec->state.samples += chunk;
+
+    if (dec->state.hop_pos < hop) continue;
+    dec->state.hop_pos = 0;
+
+    for (int j = 0; j < n_acc; j++) {
+      dtmf_accumulator_t *acc = &dec->state.acc[j];
+
+      if (acc->n != window_len) continue;
+
+      dtmf_decide(dec, tables, acc, sample_width, window_len, dec->state.window_gain2, dt,
+                  dec->state.samples - window_len);
+
+      memset(acc, 0, sizeof(dtmf_accumulator_t));
+    }
+  }
+
+  if (2 == sample_width) {
+    dtmf_track_offset16(dec, sum, n_total);
+  }
+}
+
+
+/**
+ * Set up a decoder to analyze fixed-length windows with a fixed hop
+ *
+ * \param dec The decoder to configure (after dtmf_decoder_init())
+ * \param window_len The analysis window length, in samples (0 to turn streaming off)
+ * \param hop How far apart successive windows start, in samples
+ * \param window Q15 weights for each sample of the window, or NULL for a rectangular window
+ *
+ * \returns DTMF_OKAY if things worked, or DTMF_INVALID_INPUTS if
+ * window_len isn't a multiple of hop, needs more than
+ * DTMF_MAX_OVERLAP windows in flight at once, or the window is all
+ * zeros.
+ *
+ * By default, the decoder treats each buffer it's handed as one
+ * window, which ties the detection latency and time resolution to
+ * however the DMA happens to be set up.  Once this is called,
+ * samples are accumulated across buffers instead, and a decision is
+ * made every hop samples on the most recent window_len of them, no
+ * matter how the buffers line up.  So, window_len=256 and hop=128
+ * gives 50% overlapped windows of 32ms at 8kHz, with a decision every
+ * 16ms, whether the ADC callback delivers 64 samples or 1024.  The
+ * dt passed to the up callback is then counted in hops.
+ *
+ * The window array is not copied, so it must outlive the decoder.
+ * dtmf_window_hann() will fill one in for you.  The magnitudes are
+ * corrected for the window's coherent gain, so the threshold means
+ * the same thing with or without one.  As always, the threshold
+ * should be set for the window length, not the buffer length.
+ *
+ * This resets the decoder's symbol state.
+ */
+dtmf_status_t dtmf_decoder_set_window(dtmf_decoder_t *dec, uint16_t window_len, uint16_t hop,
+                                      const int16_t *window) {
+  if (0 != window_len) {
+    if (hop == 0 || window_len < 2 || window_len % hop != 0 || window_len / hop > DTMF_MAX_OVERLAP) {
+      return DTMF_INVALID_INPUTS;
+    }
+  }
+
+  float gain2 = 1.0;
+  if (NULL != window && 0 != window_len) {
+    int32_t sum = 0;
+    for (int i = 0; i < window_len; i++) {
+      sum += window[i];
+    }
+    if (sum <= 0) return DTMF_INVALID_INPUTS;
+
+    float gain = sum / (32768.0f * window_len);
+    gain2 = gain * gain;
+  }
+
+  dec->config.window_len = window_len;
+  dec->config.hop = (0 == window_len ? 0 : hop);
+  dec->config.window = (0 == window_len ? NULL : window);
+
+  dec->state.window_gain2 = gain2;
+
+  dtmf_decoder_reset(dec);
+  return DTMF_OKAY;
+}
+
+/**
+ * Set the analysis window of the default decoder
+ *
+ * \param window_len The analysis window length, in samples (0 to turn streaming off)
+ * \param hop How far apart successive windows start, in samples
+ * \param window Q15 weights for each sample of the window, or NULL for a rectangular window
+ *
+ * \returns The result of dtmf_decoder_set_window(), which see.
+ *
+ * Call this after dtmf_init(), which turns streaming back off.
+ */
+dtmf_status_t dtmf_set_window(uint16_t window_len, uint16_t hop, const int16_t *window) {
+  return dtmf_decoder_set_window(&dtmf_default_decoder, window_len, hop, window);
+}
+
+/**
+ * Fill in a Hann window for use with dtmf_decoder_set_window()
+ *
+ * \param window[out] Where to put the window weights, in Q15
+ * \param len The length of the window, in samples
+ *
+ * This is the periodic form, so 50% overlapped windows sum to a
+ * constant.
+ */
+void dtmf_window_hann(int16_t *window, uint16_t len) {
+  for (int i = 0; i < len; i++) {
+    window[i] = lroundf(32767 * 0.5f * (1 - cosf(2 * M_PI * i / len)));
+  }
+}
+
+
 /**
  * Process a single buffer that continues the previous state
  *
@@ -199,7 +761,8 @@ static void dtmf_sym_decoded(uint8_t new_symbol, float best_row_mag, float best_
  * the length of a single valid button-down event in your system or
  * about the same length as the minimum button-up time between symbols
  * (DTMF specification is 45ms down, with 10ms between them, so 10ms
- * buffers can work).
+ * buffers can work).  If your buffers can't be made that small (or
+ * that big), see dtmf_set_window() to decouple the two.
  *
  * This will process the buffer through the IIR filter, then check its
  * thresholds at the end.  If it believes a button has been pushed
@@ -221,92 +784,302 @@ static void dtmf_sym_decoded(uint8_t new_symbol, float best_row_mag, float best_
  * * If a valid symbol is in dtmf_state.cur_symbol, calls up_callback()
  *
  * * Resets dtmf_state.cur_symbol to DTMF_SYMBOL_NONE
+ *
+ * In streaming mode, all of the above happens once per hop rather
+ * than once per buffer, and a zero length buffer also throws away any
+ * partially filled windows.
  */
 void dtmf_process(const uint8_t *buf, uint16_t buflen) {
-  float dt;
+  dtmf_decoder_process(&dtmf_default_decoder, buf, buflen);
+}
 
-  // If buflen == 0 and valid cur_symbol, call up_callback() and reset
-  if (buflen == 0) {
-    dtmf_sym_decoded(DTMF_SYMBOL_NONE, 0, 0, 0);
-    return;
-  }
+/**
+ * Process a single buffer through the given decoder
+ *
+ * \param dec The decoder to use
+ * \param buf A buffer of uint8_t samples from the ADC
+ * \param buflen The length of the buffer (0 to indicate end of data)
+ *
+ * This is the reentrant version of dtmf_process(); see there for
+ * the details.
+ */
+void dtmf_decoder_process(dtmf_decoder_t *dec, const uint8_t *buf, uint16_t buflen) {
+  dtmf_decoder_process_strided(dec, 1, buf, buflen);
+}
 
-  ////////////////////////////////////////////////////////////
-  // Run the filter to find the strongest row and column tone
+/**
+ * Process an interleaved multi-channel buffer through a set of decoders
+ *
+ * \param decoders An array of n_channels decoders, one per channel
+ * \param n_channels How many channels are interleaved in buf
+ * \param buf The interleaved samples, as the ADC DMA gives them to us
+ * \param buflen The length of the buffer, in samples across all channels (0 for end of data)
+ *
+ * This is meant to be called straight from an ADC callback that is
+ * scanning n_channels channels, with each decoder looking at its own
+ * channel directly in the DMA buffer: channel k's samples are
+ * buf[k], buf[k+n_channels], buf[k+2*n_channels], etc.  No copies are
+ * made to deinterleave the data.
+ *
+ * All the decoders must have been set up with the same sample rate
+ * and backend.  The filter coefficients are only read out of the
+ * first decoder, so the per-channel cost is just the filtering and
+ * decision for that channel.  Each channel still makes its own
+ * callbacks, so give each decoder callbacks that know which channel
+ * they belong to.
+ *
+ * If buflen isn't a multiple of n_channels, the trailing partial
+ * scan is ignored.
+ */
+void dtmf_decoder_process_strided(dtmf_decoder_t *decoders, uint8_t n_channels,
+                                  const uint8_t *buf, uint16_t buflen) {
+  dtmf_process_channels(decoders, n_channels, buf, 1, buflen);
+}
 
-  uint8_t best_row = 0xFF;
-  float best_row_mag = 0;
+/**
+ * Process a buffer of 12b samples through the given decoder
+ *
+ * \param dec The decoder to use
+ * \param buf A buffer of right-aligned 12b samples from the ADC
+ * \param buflen The length of the buffer, in samples (0 to indicate end of data)
+ *
+ * This is dtmf_decoder_process() for an ADC running with a
+ * sample_width of 2.  The samples are filtered straight out of the
+ * buffer, with no narrowing copy, so you keep the extra four bits of
+ * dynamic range for free.  Rather than assuming a bias point, the
+ * samples are normalized with the decoder's calibrated offset and
+ * scale; see dtmf_decoder_set_calibration() and
+ * dtmf_decoder_calibrate16().
+ */
+void dtmf_decoder_process16(dtmf_decoder_t *dec, const uint16_t *buf, uint16_t buflen) {
+  dtmf_decoder_process16_strided(dec, 1, buf, buflen);
+}
 
-  uint8_t best_col = 0xFF;
-  float best_col_mag = 0;
+/**
+ * Process an interleaved buffer of 12b samples through a set of decoders
+ *
+ * \param decoders An array of n_channels decoders, one per channel
+ * \param n_channels How many channels are interleaved in buf
+ * \param buf The interleaved 12b samples, as the ADC DMA gives them to us
+ * \param buflen The length of the buffer, in samples across all channels (0 for end of data)
+ *
+ * This is dtmf_decoder_process_strided() for 12b samples.  Each
+ * decoder uses its own offset and scale, so channels with different
+ * bias points are fine.
+ */
+void dtmf_decoder_process16_strided(dtmf_decoder_t *decoders, uint8_t n_channels,
+                                    const uint16_t *buf, uint16_t buflen) {
+  dtmf_process_channels(decoders, n_channels, (const uint8_t *)buf, 2, buflen);
+}
 
-  for (int tone_no = 0; tone_no < 8; tone_no++) {
-    float z2 = 0;
-    float z1 = 0;
+/**
+ * Process a buffer of 12b samples through the default decoder
+ *
+ * \param buf A buffer of right-aligned 12b samples from the ADC
+ * \param buflen The length of the buffer, in samples (0 to indicate end of data)
+ *
+ * See dtmf_process() and dtmf_decoder_process16() for the details.
+ */
+void dtmf_process16(const uint16_t *buf, uint16_t buflen) {
+  dtmf_decoder_process16(&dtmf_default_decoder, buf, buflen);
+}
+
+/**
+ * Process a 12b ADC DMA buffer through the default decoder
+ *
+ * \param buf The buffer, as handed to an adc_buffer_cb
+ * \param buflen The length of the buffer, in bytes
+ *
+ * This has the signature of an ADC callback, so you can hook it up
+ * directly in an adc_config_t with a sample_width of 2, just like
+ * dtmf_process() for 8b samples.
+ */
+void dtmf_process_adc16(const uint8_t *buf, uint16_t buflen) {
+  dtmf_process16((const uint16_t *)buf, buflen/2);
+}
+
+/**
+ * Set the offset and scale used to normalize 12b samples
+ *
+ * \param dec The decoder to configure (after dtmf_decoder_init())
+ * \param offset The DC offset of the samples, in ADC counts
+ * \param scale The amplitude of a full scale tone, in ADC counts
+ * \param track_offset Whether to follow drift in the offset as samples come in
+ *
+ * \returns DTMF_OKAY if things worked, or DTMF_INVALID_INPUTS for a
+ * NULL decoder or a non-positive scale.
+ *
+ * The scale sets what the threshold is relative to: a sine wave of
+ * amplitude scale reads as 1.  dtmf_decoder_init() starts off with
+ * DTMF_OFFSET16_DEFAULT and DTMF_SCALE16_DEFAULT, which is what
+ * you'd get from a rail-to-rail signal centered on mid-scale.
+ *
+ * With track_offset set, the offset is nudged towards the mean of
+ * each buffer after it's been processed, so it follows slow drift in
+ * the analog front end's bias.  This costs one add per sample in the
+ * filter loop, and none of the samples are visited twice.
+ *
+ * This only affects 12b processing; 8b samples are still assumed to
+ * be centered on 127.
+ */
+dtmf_status_t dtmf_decoder_set_calibration(dtmf_decoder_t *dec, float offset, float scale,
+                                           bool track_offset) {
+  if (!dec || scale <= 0) return DTMF_INVALID_INPUTS;
+
+  dec->config.track_offset = track_offset;
+
+  dec->state.scale16 = scale;
+  dec->state.inv_scale16 = 1.0f / scale;
+  dtmf_set_offset16(dec, offset);
 
-    float cos_w = dtmf_state.cos_w_table[tone_no];
-    float sin_w = dtmf_state.sin_w_table[tone_no];
+  // As for threshold_q in dtmf_decoder_init(), but in 12b units
+  float full_scale = scale * (1 << DTMF_SAMPLE_SHIFT16);
+  float th = dec->config.threshold;
+  dec->state.threshold16_q = (uint64_t)(th * th * full_scale * full_scale);
+
+  return DTMF_OKAY;
+}
 
-    float res_i, res_q; // result values
-    float mag; // magnitude
+/**
+ * Measure the DC offset of 12b samples from a buffer
+ *
+ * \param dec The decoder to calibrate (after dtmf_decoder_init())
+ * \param buf A buffer of right-aligned 12b samples
+ * \param buflen The length of the buffer, in samples
+ *
+ * \returns DTMF_OKAY if things worked, or DTMF_INVALID_INPUTS for
+ * NULL pointers or an empty buffer.
+ *
+ * This sets the decoder's offset to the mean of the buffer, and
+ * leaves the scale alone.  Run it on a buffer of an idle line at
+ * startup, before handing the decoder any real samples.
+ */
+dtmf_status_t dtmf_decoder_calibrate16(dtmf_decoder_t *dec, const uint16_t *buf, uint16_t buflen) {
+  if (!dec || !buf || 0 == buflen) return DTMF_INVALID_INPUTS;
 
-    for (int i = 0; i < buflen; i++) {
-      //! \todo Remove this hard-coded offset and amplitude
-      float x = (buf[i] - 127.0)/127.0; // Current sample
-      float z0 = x + (2*cos_w * z1) - z2;
-      z2 = z1;
-      z1 = z0;
+  uint32_t sum = 0;
+  for (int i = 0; i < buflen; i++) {
+    sum += buf[i];
+  }
+
+  dtmf_set_offset16(dec, (float)sum / buflen);
+  return DTMF_OKAY;
+}
+
+/**
+ * Set the 12b offset and scale of the default decoder
+ *
+ * \param offset The DC offset of the samples, in ADC counts
+ * \param scale The amplitude of a full scale tone, in ADC counts
+ * \param track_offset Whether to follow drift in the offset
+ *
+ * \returns The result of dtmf_decoder_set_calibration(), which see.
+ *
+ * Call this after dtmf_init(), which puts the defaults back.
+ */
+dtmf_status_t dtmf_set_calibration(float offset, float scale, bool track_offset) {
+  return dtmf_decoder_set_calibration(&dtmf_default_decoder, offset, scale, track_offset);
+}
+
+/**
+ * (Internal) Process interleaved samples of either width through a set of decoders
+ *
+ * \param decoders An array of n_channels decoders, one per channel
+ * \param n_channels How many channels are interleaved in buf
+ * \param buf The interleaved samples
+ * \param sample_width 1 for 8b samples, 2 for 12b samples in 16b words
+ * \param buflen The length of the buffer, in samples across all channels (0 for end of data)
+ */
+static void dtmf_process_channels(dtmf_decoder_t *decoders, uint8_t n_channels,
+                                  const uint8_t *buf, uint8_t sample_width, uint16_t buflen) {
+  if (!decoders || 0 == n_channels) return;
+
+  // If buflen == 0 and valid cur_symbol, call up_callback() and reset
+  if (buflen == 0) {
+    for (int ch = 0; ch < n_channels; ch++) {
+      dtmf_sym_decoded(&decoders[ch], DTMF_SYMBOL_NONE, 0, 0, 0, decoders[ch].state.samples);
+      dtmf_stream_restart(&decoders[ch]);
     }
+    return;
+  }
 
-    //////////////////////////////
-    // Get magnitude
-    res_i = z1 * cos_w - z2;
-    res_q = z1 * sin_w;
-
-    mag = res_i*res_i + res_q*res_q;
-    mag /= buflen/2;  // Apply correction factor
-
-    // printf("dtmf_process tone %d: %d\n", tone_no, (int)(1000*mag));
-    //////////////////////////////
-    // See if it's a winner
-    if (tone_no < 4) {
-      // Running a row tone
-      if (mag > best_row_mag) {
-	best_row_mag = mag;
-	best_row = tone_no;
-      }
+  uint16_t n_samples = buflen / n_channels;
+  const dtmf_decoder_state_t *tables = &decoders[0].state;
+
+  for (int ch = 0; ch < n_channels; ch++) {
+    const uint8_t *chbuf = buf + ch*sample_width;
+
+    if (decoders[ch].config.window_len) {
+      dtmf_decoder_stream(&decoders[ch], tables, chbuf, sample_width, n_channels, n_samples);
     } else {
-      // Running a column tone
-      if (mag > best_col_mag) {
-	best_col_mag = mag;
-	best_col = tone_no;
-      }
+      dtmf_decoder_run(&decoders[ch], tables, chbuf, sample_width, n_channels, n_samples);
     }
   }
+}
 
+/**
+ * Decode a whole recording in one go, returning a list of events
+ *
+ * \param dec The decoder to use, already set up with dtmf_decoder_init()
+ * \param buf The recording, as uint8_t samples
+ * \param buflen The length of the recording, in samples
+ * \param block_len How many samples to hand the decoder at a time
+ * \param events[out] Where to put the decoded events
+ * \param max_events How many events fit in the events array
+ * \param n_events[out] How many events were decoded
+ *
+ * \returns DTMF_OKAY if it worked, DTMF_INVALID_INPUTS for NULL
+ * pointers or a zero block_len, or DTMF_EVENTS_OVERFLOW if there were
+ * more than max_events events.  In the overflow case, the first
+ * max_events events are still in the array.
+ *
+ * This is for re-decoding archived captures, where you want a list of
+ * what happened rather than callbacks.  It resets the decoder, feeds
+ * it the recording block_len samples at a time (just as the ADC
+ * callback would), and then flushes it.  If the decoder is in
+ * non-streaming mode, block_len is the analysis window, so pick it as
+ * you would the ADC buffer size; in streaming mode, it doesn't matter.
+ *
+ * Each event is timestamped in samples from the start of buf, at the
+ * start of the first window that saw the symbol, and lasts until the
+ * start of the first window that didn't.  The last block may be
+ * shorter than block_len.
+ *
+ * The decoder's callbacks are still called, if it has any, but they
+ * needn't be: decoders with NULL callbacks are fine here.  Since
+ * everything lives in the decoder, any number of recordings can be
+ * decoded in parallel with separate decoders, once they've all been
+ * through dtmf_decoder_init().
+ */
+dtmf_status_t dtmf_decode_buffer(dtmf_decoder_t *dec, const uint8_t *buf, uint32_t buflen,
+                                 uint16_t block_len,
+                                 dtmf_event_t *events, uint16_t max_events, uint16_t *n_events) {
+  if (!dec || (!buf && buflen) || 0 == block_len || !events || !n_events) {
+    return DTMF_INVALID_INPUTS;
+  }
 
-  ////////////////////////////////////////////////////////////
-  // Execute the appropriate transitions
+  dtmf_decoder_reset(dec);
 
-  dt = buflen/dtmf_config.Fs; // First get our time elapsed, though.
+  dec->state.events = events;
+  dec->state.max_events = max_events;
+  dec->state.n_events = 0;
+  dec->state.events_overflow = false;
 
-  // Fix up threshold to use mag-squared and avoid sqrt
-  float th = dtmf_config.threshold * dtmf_config.threshold;
+  for (uint32_t i = 0; i < buflen; i += block_len) {
+    uint32_t l = buflen - i;
+    l = (l > block_len ? block_len : l);
 
-  // If neither is good enough, send a NONE (decoded will de-dupe)
-  if ((best_row_mag < th) || (best_col_mag < th)) {
-    dtmf_sym_decoded(DTMF_SYMBOL_NONE, best_row_mag, best_col_mag, dt);
-    return;
+    dtmf_decoder_process(dec, buf+i, l);
   }
+  dtmf_decoder_process(dec, NULL, 0);
 
-  ////////////////////////////////////////////////////////////
-  // Decode the symbol
-  uint8_t symbol_found = decode_symbol(best_row, best_col-4);
+  *n_events = dec->state.n_events;
+  bool overflow = dec->state.events_overflow;
 
-  ////////////////////////////////////////////////////////////
-  // Do state transitions
-  dtmf_sym_decoded(symbol_found, best_row_mag, best_col_mag, dt);
-  return;
+  dec->state.events = NULL;
+  dec->state.max_events = 0;
+
+  return (overflow ? DTMF_EVENTS_OVERFLOW : DTMF_OKAY);
 }
 
 /** \} */ // End doxygen group
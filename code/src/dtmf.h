@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+
+#include "goertzel.h"
 /**
  * \file dtmf.h
  * \brief Header for DTMF modem
@@ -15,12 +17,36 @@
 typedef void (*dtmf_down_callback)(uint8_t, float); //!< callback when a tone is first hit
 typedef void (*dtmf_up_callback)(uint8_t, float); //!< callback when a tone stops
 
+/**
+ * The arithmetic used to run the Goertzel filters
+ */
+typedef enum dtmf_backend {
+			   DTMF_BACKEND_FLOAT = 0, //!< Single precision floating point
+			   DTMF_BACKEND_FIXED, //!< Integer recurrences on raw samples, Q14 coefficients
+} dtmf_backend_t;
+
+#define DTMF_COEF_Q GOERTZEL_COEF_Q //!< Number of fractional bits in the fixed point coefficients
+#define DTMF_SAMPLE_SHIFT GOERTZEL_SAMPLE_SHIFT //!< Headroom shift applied to samples in the fixed point backend
+#define DTMF_MAX_OVERLAP 4 //!< Most analysis windows in flight at once (window_len/hop) when streaming
+
+#define DTMF_SAMPLE_SHIFT16 GOERTZEL_SAMPLE_SHIFT16 //!< Headroom shift applied to 12b samples in the fixed point backend
+#define DTMF_OFFSET16_DEFAULT 2048 //!< Default DC offset of 12b samples (mid-scale)
+#define DTMF_SCALE16_DEFAULT 2047 //!< Default full scale amplitude of 12b samples
+#define DTMF_OFFSET_TRACK_SHIFT 4 //!< Offset tracking time constant, as a power of two in buffers
+
 /**
  * The user-configurable bits of the DTMF Decoder
  */
 typedef struct dtmf_decoder_config {
   float Fs; //!< Sample rate
   float threshold; //!< Minimum amplitude to consider a "hit"
+  dtmf_backend_t backend; //!< Which arithmetic to run the filters in
+
+  uint16_t window_len; //!< Analysis window length in samples, or 0 to use each buffer as a window
+  uint16_t hop; //!< Samples between the starts of successive windows
+  const int16_t *window; //!< Q15 window weights, window_len long, or NULL for rectangular
+
+  bool track_offset; //!< Follow drift in the DC offset of 12b samples
 
   dtmf_down_callback down_cb; //!< callback when a tone is first hit
   dtmf_up_callback up_cb; //!< callback when a tone stops
@@ -28,21 +54,76 @@ typedef struct dtmf_decoder_config {
 
 #define DTMF_SYMBOL_NONE 0xff //!< Used to indicate there is no current symbol
 
+/**
+ * A single decoded button press, see dtmf_decode_buffer()
+ *
+ * Times are in samples, counted from the last reset of the decoder.
+ */
+typedef struct dtmf_event {
+  uint8_t symbol; //!< The symbol decoded
+  uint32_t start; //!< The sample at which the button went down
+  uint32_t duration; //!< How long it was down, in samples (0 if it never came up)
+  float power; //!< The power passed to the down callback
+} dtmf_event_t;
+
+/**
+ * One in-flight analysis window, for streaming mode
+ *
+ * Only one of the float and integer filter states is used, depending
+ * on the decoder's backend.
+ */
+typedef struct dtmf_accumulator {
+  int32_t n; //!< Samples accumulated so far, negative while waiting for its turn to start
+  float z1[8]; //!< z^-1 filter states, for the floating point backend
+  float z2[8]; //!< z^-2 filter states, for the floating point backend
+  int32_t z1_q[8]; //!< z^-1 filter states, for the fixed point backend
+  int32_t z2_q[8]; //!< z^-2 filter states, for the fixed point backend
+} dtmf_accumulator_t;
+
 /**
  * The internal state of the DTMF decoder
  *
- * Note that most of these are 8-long arrays: these are coindexed with
- * the dtmf_tones array found in dtmf.c.  The first four correspond to
- * row tones, and the second four to the column tones.
+ * The filter bank's bins are coindexed with the dtmf_tones array found
+ * in dtmf.c.  The first four correspond to row tones, and the second
+ * four to the column tones.
  */
 typedef struct dtmf_decoder_state {
-  float cos_w_table[8]; //!< The cos(w) used in the filter, for each tone
-  float sin_w_table[8]; //!< The sin(w) used in the filter, for each tone
+  goertzel_bank_t bank; //!< The Goertzel filters, one bin per tone
+
+  uint64_t threshold_q; //!< threshold^2 scaled to raw (shifted) sample units
+
+  float offset16; //!< DC offset of 12b samples, in ADC counts
+  float scale16; //!< Full scale amplitude of 12b samples, in ADC counts
+  float inv_scale16; //!< 1/scale16, for the floating point backend
+  int32_t offset16_q; //!< offset16 shifted up by DTMF_SAMPLE_SHIFT16, for the fixed point backend
+  uint64_t threshold16_q; //!< threshold^2 scaled to raw (shifted) 12b sample units
+
+  dtmf_accumulator_t acc[DTMF_MAX_OVERLAP]; //!< Staggered windows, for streaming mode
+  uint16_t hop_pos; //!< Samples into the current hop, for streaming mode
+  float window_gain2; //!< Square of the window's coherent gain
 
   uint8_t cur_symbol; //!< Symbol we are currently in dtmf_down for
   float cur_symbol_dt; //!< How long we've been in that state
+  uint32_t samples; //!< Samples processed since the last reset
+
+  dtmf_event_t *events; //!< Where to log events, or NULL for none
+  uint16_t max_events; //!< How many events fit in the log
+  uint16_t n_events; //!< How many events have been logged
+  bool events_overflow; //!< Set if an event didn't fit in the log
 } dtmf_decoder_state_t;
 
+/**
+ * A single DTMF decoder: everything needed to decode one audio stream
+ *
+ * These are caller-owned; set one up with dtmf_decoder_init(), then
+ * feed it with dtmf_decoder_process() or, for several channels
+ * interleaved in one buffer, dtmf_decoder_process_strided().
+ */
+typedef struct dtmf_decoder {
+  dtmf_decoder_config_t config; //!< The configuration for this decoder
+  dtmf_decoder_state_t state; //!< The filter tables and symbol state
+} dtmf_decoder_t;
+
 
 /**
  * Status codes used in DTMF tone fetching
@@ -51,10 +132,34 @@ typedef enum dtmf_status {
 			  DTMF_OKAY = 0,  //!< The symbol was found
 			  DTMF_SYMBOL_NOT_FOUND, //!< The symbol was not in our table
 			  DTMF_INVALID_INPUTS, //!< A NULL pointer was passed in
+			  DTMF_EVENTS_OVERFLOW, //!< There were more events than space for them
 } dtmf_status_t;
 
 void dtmf_init(float, float, dtmf_down_callback, dtmf_up_callback);
+void dtmf_init_backend(float, float, dtmf_down_callback, dtmf_up_callback, dtmf_backend_t);
 void dtmf_process(const uint8_t *, uint16_t); // Process a buffer
+void dtmf_process16(const uint16_t *, uint16_t); // Process a buffer of 12b samples
+void dtmf_process_adc16(const uint8_t *, uint16_t); // Process a 12b ADC DMA buffer, length in bytes
+void dtmf_goertzel(const uint8_t *, uint16_t, float *); // Get tone magnitudes for a buffer
+void dtmf_goertzel_fixed(const uint8_t *, uint16_t, int64_t *); // Get raw tone magnitudes, in integer
+
+void dtmf_decoder_init(dtmf_decoder_t *, float, float, dtmf_down_callback, dtmf_up_callback, dtmf_backend_t);
+void dtmf_decoder_reset(dtmf_decoder_t *);
+void dtmf_decoder_process(dtmf_decoder_t *, const uint8_t *, uint16_t);
+void dtmf_decoder_process_strided(dtmf_decoder_t *, uint8_t, const uint8_t *, uint16_t); // Process interleaved channels
+void dtmf_decoder_process16(dtmf_decoder_t *, const uint16_t *, uint16_t);
+void dtmf_decoder_process16_strided(dtmf_decoder_t *, uint8_t, const uint16_t *, uint16_t);
+
+dtmf_status_t dtmf_decoder_set_calibration(dtmf_decoder_t *, float, float, bool);
+dtmf_status_t dtmf_decoder_calibrate16(dtmf_decoder_t *, const uint16_t *, uint16_t);
+dtmf_status_t dtmf_set_calibration(float, float, bool);
+
+dtmf_status_t dtmf_decoder_set_window(dtmf_decoder_t *, uint16_t, uint16_t, const int16_t *);
+dtmf_status_t dtmf_set_window(uint16_t, uint16_t, const int16_t *);
+void dtmf_window_hann(int16_t *, uint16_t);
+
+dtmf_status_t dtmf_decode_buffer(dtmf_decoder_t *, const uint8_t *, uint32_t, uint16_t,
+                                 dtmf_event_t *, uint16_t, uint16_t *);
 
 
 dtmf_status_t dtmf_get_tones(uint8_t, float *, float *);
@@ -6,6 +6,7 @@
 #include "console.h"
 #include "sin_gen.h"
 #include "dtmf.h"
+#include "goertzel.h"
 #include "packet.h"
 
 #ifndef TEST_UNITY
@@ -55,9 +56,13 @@
  *
  * - ADC run: run the ADC input, and dump results after one buffer, then stop ADC
  *
- * - Goertzel setup: num of filters, coefficients for each filter
+ * - x Goertzel setup: num of filters, frequency for each filter
  *
- * - Goertzel run: N (With a set up ADC and Goertzel, run N buffers and dump results)
+ * - x Goertzel run: N (With a set up ADC and Goertzel, run N buffers and dump results)
+ *
+ * - x Benchmark DTMF: run the DTMF decoder on N ADC buffers, for timing
+ *
+ * - x Benchmark query: report the cycles spent in the ADC callback
 
  *
  * Command format:
@@ -70,7 +75,13 @@
 ////////////////////////////////////////////////////////////
 // State variables
 
-static uint8_t eol_dac_buf[1024];
+#define EOL_DAC_BUF_LEN 1024 //!< Size of each DAC waveform buffer
+
+static uint8_t eol_dac_buf[2][EOL_DAC_BUF_LEN]; //!< Two, so one can be rewritten while the other plays
+static uint8_t eol_dac_cur = 0; //!< Which eol_dac_buf the DAC was last pointed at
+static uint16_t eol_dac_prescaler = 0; //!< Prescaler of the last DAC Configure
+static uint32_t eol_dac_period = 0; //!< Period of the last DAC Configure
+static bool eol_dac_taken = false; //!< Set when a DAC command touches the DAC, see eol_dac_reclaim()
 
 static const uint16_t eol_adc_buf_len = 2048;
 static uint8_t eol_adc_buf[2048];
@@ -79,6 +90,27 @@ static uint8_t eol_adc_buf[2048];
 #define XMITBUFLEN 1024
 static uint8_t xmitbuf[XMITBUFLEN];
 
+static goertzel_bank_t eol_goertzel_bank;
+static float eol_goertzel_freqs[GOERTZEL_MAX_BINS];
+static uint8_t eol_goertzel_n_bins = 0;
+
+static uint16_t eol_goertzel_buffers_left = 0; //!< How many more buffers to run
+static uint16_t eol_goertzel_buffer_no = 0; //!< Sequence number of the next result
+static uint8_t eol_goertzel_n_channels = 0;
+static uint8_t eol_goertzel_sample_width = 0;
+
+static uint8_t eol_goertzel_result[XMITBUFLEN-2];
+
+#define EOL_GOERTZEL_MAX_CHANNELS 16 //!< Size of adc_config_t's channel list
+#define EOL_GOERTZEL_RUN_HEADER 16 //!< Bytes of a Goertzel Run ahead of its channel list
+
+#define EOL_BENCH_MAX_CHANNELS 4 //!< Most channels a DTMF benchmark run can decode
+#define EOL_BENCH_DTMF_HEADER 21 //!< Bytes of a Benchmark DTMF ahead of its channel list
+static dtmf_decoder_t eol_bench_decoders[EOL_BENCH_MAX_CHANNELS];
+static uint16_t eol_bench_buffers_left = 0; //!< How many more buffers to decode
+static uint8_t eol_bench_n_channels = 0;
+static uint8_t eol_bench_sample_width = 0;
+
 
 ////////////////////////////////////////////////////////////
 // Utility functions
@@ -93,6 +125,34 @@ static uint16_t get16(uint8_t *c) {
 
 }
 
+static void put32(uint8_t *c, uint32_t v) {
+  *c = v >> 24;
+  *(c+1) = (v >> 16) & 0xFF;
+  *(c+2) = (v >> 8) & 0xFF;
+  *(c+3) = v & 0xFF;
+}
+
+static float getf(uint8_t *c) {
+  uint32_t u = get32(c);
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static void put16(uint8_t *c, uint16_t v) {
+  *c = v >> 8;
+  *(c+1) = v & 0xFF;
+}
+
+static void putf(uint8_t *c, float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  *c = u >> 24;
+  *(c+1) = (u >> 16) & 0xFF;
+  *(c+2) = (u >> 8) & 0xFF;
+  *(c+3) = u & 0xFF;
+}
+
 
 static void xmit_ack(uint8_t family, uint8_t subtype, char *fmt, ...) {
   return;
@@ -132,11 +192,12 @@ static void xmit_error(uint8_t family, uint8_t subtype, char *fmt, ...) {
   packet_send(xmitbuf, buflen+3, 'E', '!');
 }
 
-static void xmit_buf(uint8_t family, uint8_t subtype, const uint8_t *buf, uint16_t buflen) {
+static void xmit_buf(uint8_t family, uint8_t subtype, const uint8_t *buf, uint16_t buflen,
+                     tx_queue_prio_t prio) {
   xmitbuf[0] = family;
   xmitbuf[1] = subtype;
   memcpy(xmitbuf+2, buf, buflen);
-  packet_send(xmitbuf, buflen+2, 'E', 'B');
+  packet_send_prio(xmitbuf, buflen+2, 'E', 'B', prio);
 }
 
 static void xmit_unk(uint8_t family, uint8_t subtype) {
@@ -160,8 +221,83 @@ static void eol_adc_callback(const uint8_t *buf, uint16_t buflen) {
     len_to_send = stride;
     if (buflen - (c-buf) < stride)
       len_to_send = buflen - (c-buf);
-    xmit_buf('A', 'C', c, len_to_send);
+    xmit_buf('A', 'C', c, len_to_send, TX_PRIO_DATA);
+
+  }
+}
+
+/**
+ * ADC callback for Goertzel runs: analyze the buffer, send only the results
+ *
+ * The result packet is:
+ *
+ * - uint16_t buffer_no: sequence number of this buffer within the run
+ * - uint8_t n_channels
+ * - uint8_t n_bins
+ * - float amplitudes[n_channels][n_bins]: in ADC counts, channel-major
+ *
+ * This runs inside the ADC ISR, as does eol_adc_callback().
+ */
+static void eol_goertzel_callback(const uint8_t *buf, uint16_t buflen) {
+  const uint8_t n_channels = eol_goertzel_n_channels;
+  const uint8_t sample_width = eol_goertzel_sample_width;
+  const uint8_t n_bins = eol_goertzel_bank.n_bins;
+  const uint16_t n_samples = buflen / (n_channels * sample_width);
+
+  if (0 == eol_goertzel_buffers_left) {
+    // A straggler after the stop; nothing to do.
+    return;
+  }
+
+  eol_goertzel_buffers_left--;
+  if (0 == eol_goertzel_buffers_left) {
+    adc_stop();
+  }
+
+  uint8_t *cursor = eol_goertzel_result;
+  put16(cursor, eol_goertzel_buffer_no); cursor += 2;
+  *cursor = n_channels; cursor++;
+  *cursor = n_bins; cursor++;
+
+  for (int ch = 0; ch < n_channels; ch++) {
+    float amplitudes[GOERTZEL_MAX_BINS];
+
+    goertzel_bank_run(&eol_goertzel_bank, buf + ch*sample_width,
+                      sample_width, n_channels, n_samples, amplitudes);
+
+    for (int bin = 0; bin < n_bins; bin++) {
+      putf(cursor, amplitudes[bin]); cursor += 4;
+    }
+  }
+
+  eol_goertzel_buffer_no++;
+  xmit_buf('G', 'r', eol_goertzel_result, cursor - eol_goertzel_result, TX_PRIO_DATA);
+}
+
+
+/**
+ * ADC callback for DTMF benchmark runs: decode the buffer, and nothing else
+ *
+ * The ADC driver times every call to this, so a 'B' 'Q' after the run
+ * reports what the decoder costs inside the ISR.  The decoders have
+ * no callbacks of their own, so nothing is sent from in here.
+ */
+static void eol_bench_dtmf_callback(const uint8_t *buf, uint16_t buflen) {
+  if (0 == eol_bench_buffers_left) {
+    // A straggler after the stop; nothing to do.
+    return;
+  }
+
+  if (2 == eol_bench_sample_width) {
+    dtmf_decoder_process16_strided(eol_bench_decoders, eol_bench_n_channels,
+                                   (const uint16_t *)buf, buflen/2);
+  } else {
+    dtmf_decoder_process_strided(eol_bench_decoders, eol_bench_n_channels, buf, buflen);
+  }
 
+  eol_bench_buffers_left--;
+  if (0 == eol_bench_buffers_left) {
+    adc_stop();
   }
 }
 
@@ -194,11 +330,12 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
 
     if ('T' == subtype) { // full byte table request
       // This is available to sanity check the link and its encoding.
-      eol_dac_buf[0] = 0;
+      uint8_t table[256];
+      table[0] = 0;
       for (uint8_t i = 1; i != 0; i++) {
-        eol_dac_buf[i] = i;
+        table[i] = i;
       }
-      xmit_buf('E', 'U', eol_dac_buf, 256);
+      xmit_buf('E', 'U', table, sizeof(table), TX_PRIO_CONTROL);
       return;
     }
 
@@ -223,6 +360,9 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
     return; // But to make linters happy
 
   case 'D': //////////////////////////////////////// // DAC
+    // Whatever the main loop had the DAC doing, it's ours now
+    eol_dac_taken = true;
+
     if ('C' == subtype) {
       // DAC Configure:
       // uint16_t prescaler: as in dac_setup()
@@ -231,6 +371,10 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
       // uint16_t points_per_wave: Number of points in each sine wave
       // uint8_t num_waves: Number of waves to generate in the buffer
       // uint8_t theta0_u8: Offset of theta0, in 1/256 of a wave steps
+      //
+      // If the DAC is already looping a waveform of the same length at
+      // the same rate, the new one is swapped in at the end of the
+      // current cycle, without stopping the output; see dac_queue().
       uint16_t prescaler =       get16(cursor); cursor += 2;
       uint32_t period =          get32(cursor); cursor += 4;
       uint8_t scale =                  *cursor; cursor++;
@@ -245,6 +389,18 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
 
       console_dumps("DC %d %d %d %d %d %d\n", prescaler, period, scale, points_per_wave, num_waves, theta0_u8);
 
+      if (npts > EOL_DAC_BUF_LEN) {
+        xmit_error(family, subtype, "Buffer truncation! %d points available, %d requested", EOL_DAC_BUF_LEN, npts);
+        return;
+      }
+
+      // If the last swap hasn't happened yet, the DMA may still be
+      // playing the buffer we're about to fill, so stop it first.
+      if (dac_queue_pending()) {
+        dac_stop();
+      }
+      uint8_t *dac_buf = eol_dac_buf[eol_dac_cur ^ 1];
+
       //////////////////////////////////////////////////
       // Fill our sine buffer
       //
@@ -255,7 +411,7 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
       // the sin_gen_generate_fill(), which blindly stuffs as much as
       // it can into the buffer.  We just happen to have set things up
       // such that it can do its job perfectly.
-      res = sin_gen_populate(&req, eol_dac_buf, npts, 1, points_per_wave);
+      res = sin_gen_populate(&req, dac_buf, npts, 1, points_per_wave);
       if (SIN_GEN_OKAY != res) {
         xmit_error(family, subtype,
                    "Failed to populate sin_gen request, bailing on DAC setup: %s!",
@@ -274,9 +430,19 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
       }
 
       ////////////////////////////////////////
-      // Set up DAC DMA at this buffer
+      // Point the DAC DMA at this buffer
+      eol_dac_cur ^= 1;
+
+      if (prescaler == eol_dac_prescaler && period == eol_dac_period &&
+          dac_queue(dac_buf, npts)) {
+        xmit_ack(family, 'c', "DAC waveform queued: %dHz", (int)dac_get_sample_rate(prescaler, period));
+        return;
+      }
+
       dac_stop();
-      dac_setup(prescaler, period, eol_dac_buf, npts);
+      dac_setup(prescaler, period, dac_buf, npts);
+      eol_dac_prescaler = prescaler;
+      eol_dac_period = period;
       xmit_ack(family, 'c', "DAC configured: %dHz", (int)dac_get_sample_rate(prescaler, period));
       return;
     } // DAC Configure
@@ -363,6 +529,278 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
     // No ACK here, the ADC data packets will cover that for us
     return;
 
+  case 'G': //////////////////////////////////////// // Goertzel
+    if ('C' == subtype) {
+      // Goertzel Configure
+      // uint8_t n_bins: number of frequencies to watch
+      // float[] freqs: n_bins frequencies, in Hz
+      //
+      // This just stashes the frequencies: the coefficients depend on
+      // the sample rate, which we don't know until the run request.
+      if (payload_len < 3) {
+        xmit_error(family, subtype, "Short packet: need 3 bytes, got %d", payload_len);
+        return;
+      }
+
+      uint8_t n_bins = *cursor; cursor++;
+
+      if (n_bins > GOERTZEL_MAX_BINS) {
+        xmit_error(family, subtype, "Too many bins: %d requested, %d max", n_bins, GOERTZEL_MAX_BINS);
+        return;
+      }
+      if (payload_len < 3 + 4*n_bins) {
+        xmit_error(family, subtype, "Short packet: %d bins need %d bytes, got %d", n_bins, 3+4*n_bins, payload_len);
+        return;
+      }
+
+      for (int i = 0; i < n_bins; i++) {
+        eol_goertzel_freqs[i] = getf(cursor); cursor += 4;
+      }
+      eol_goertzel_n_bins = n_bins;
+
+      xmit_ack(family, 'c', "%d bins", n_bins);
+      return;
+    }
+
+    if ('R' == subtype) {
+      // Goertzel Run
+      // uint16_t prescaler: as in the ADC Capture request
+      // uint32_t period: as in the ADC Capture request
+      // uint16_t num_points: Number of samples per channel in each buffer
+      // uint8_t sample_width: 1 for 8b, 2 for 16b samples
+      // uint16_t sample_time: as in the ADC Capture request
+      // uint16_t num_buffers: how many buffers to analyze before stopping
+      // uint8_t num_channels: number of channels to capture
+      // uint8_t[] channels: list of channels to capture
+      //
+      // This sets up the ADC just as an ADC Capture does, but in
+      // double-buffered mode, and runs the configured Goertzel bank
+      // over each channel of each buffer as it comes in.  Only the
+      // amplitudes are sent back, one 'G' 'r' packet per buffer; see
+      // eol_goertzel_callback() for its layout.
+      if (payload_len < EOL_GOERTZEL_RUN_HEADER) {
+        xmit_error(family, subtype, "Short packet: need %d bytes, got %d", EOL_GOERTZEL_RUN_HEADER, payload_len);
+        return;
+      }
+
+      uint16_t prescaler =       get16(cursor); cursor += 2;
+      uint32_t period =          get32(cursor); cursor += 4;
+      uint16_t num_points =      get16(cursor); cursor += 2;
+      uint8_t sample_width =           *cursor; cursor++;
+      uint16_t sample_time =     get16(cursor); cursor += 2;
+      uint16_t num_buffers =     get16(cursor); cursor += 2;
+      uint8_t num_channels =           *cursor; cursor++;
+
+      // Two halves for double buffering
+      uint32_t buflen = 2 * num_points * sample_width * num_channels;
+
+      if (0 == eol_goertzel_n_bins) {
+        xmit_error(family, subtype, "No Goertzel bins configured");
+        return;
+      }
+      if (0 == num_channels || 0 == num_buffers || num_points < 2) {
+        xmit_error(family, subtype, "Nothing to do: %d channels, %d buffers, %d points", num_channels, num_buffers, num_points);
+        return;
+      }
+      if (num_channels > EOL_GOERTZEL_MAX_CHANNELS) {
+        xmit_error(family, subtype, "Too many channels: %d requested, %d max", num_channels, EOL_GOERTZEL_MAX_CHANNELS);
+        return;
+      }
+      if (1 != sample_width && 2 != sample_width) {
+        xmit_error(family, subtype, "Bad sample width: %d", sample_width);
+        return;
+      }
+      if (payload_len < EOL_GOERTZEL_RUN_HEADER + num_channels) {
+        xmit_error(family, subtype, "Short packet: %d channels need %d bytes, got %d",
+                   num_channels, EOL_GOERTZEL_RUN_HEADER + num_channels, payload_len);
+        return;
+      }
+      if (buflen > eol_adc_buf_len) {
+        xmit_error(family, subtype, "Buffer truncation! %d bytes available, %d requested", eol_adc_buf_len, buflen);
+        return;
+      }
+      if (4 + 4 * num_channels * eol_goertzel_n_bins > (int)sizeof(eol_goertzel_result)) {
+        xmit_error(family, subtype, "Too many results: %d channels of %d bins", num_channels, eol_goertzel_n_bins);
+        return;
+      }
+
+      adc_config_t adc_config = {
+                                 .prescaler = prescaler,
+                                 .period = period,
+                                 .buf = eol_adc_buf,
+                                 .buflen = buflen,
+                                 .double_buffer = 1,
+                                 .n_channels = num_channels,
+                                 .sample_width = sample_width,
+                                 .adcclk_prescaler = 2,
+                                 .adc_sample_time = sample_time,
+                                 .cb = eol_goertzel_callback,
+      };
+
+      for (int i = 0; i < num_channels; i++) {
+        adc_config.channels[i] = *cursor; cursor++;
+      }
+
+      // Explicitly stop the ADC and reset its state
+      adc_stop();
+
+      float Fs = adc_setup(&adc_config);
+
+      goertzel_status_t res = goertzel_bank_init(&eol_goertzel_bank, Fs, eol_goertzel_freqs, eol_goertzel_n_bins);
+      if (GOERTZEL_OKAY != res) {
+        xmit_error(family, subtype, "Failed to set up Goertzel bank at %dHz: %s",
+                   (int)Fs, goertzel_status_name(res));
+        return;
+      }
+
+      eol_goertzel_n_channels = num_channels;
+      eol_goertzel_sample_width = sample_width;
+      eol_goertzel_buffer_no = 0;
+      eol_goertzel_buffers_left = num_buffers;
+
+      adc_start();
+      // No ACK here, the result packets will cover that for us
+      return;
+    }
+
+    xmit_unk(family, subtype);
+    return;
+
+  case 'B': //////////////////////////////////////// // Benchmarks
+    if ('D' == subtype) {
+      // Benchmark DTMF
+      // uint16_t prescaler: as in the ADC Capture request
+      // uint32_t period: as in the ADC Capture request
+      // uint16_t num_points: Number of samples per channel in each buffer
+      // uint8_t sample_width: 1 for 8b, 2 for 16b samples
+      // uint16_t sample_time: as in the ADC Capture request
+      // uint16_t num_buffers: how many buffers to decode before stopping
+      // uint8_t backend: 0 for floating point, 1 for fixed point
+      // uint16_t window_len: streaming window length, 0 for one window per buffer
+      // uint16_t hop: streaming hop length
+      // uint8_t num_channels: number of channels to capture
+      // uint8_t[] channels: list of channels to capture
+      //
+      // This runs the ADC double-buffered, with one DTMF decoder per
+      // channel decoding every buffer as it comes in, and then stops.
+      // Nothing is sent back: use a Benchmark Query afterwards to get
+      // the timings.
+      if (payload_len < EOL_BENCH_DTMF_HEADER) {
+        xmit_error(family, subtype, "Short packet: need %d bytes, got %d", EOL_BENCH_DTMF_HEADER, payload_len);
+        return;
+      }
+
+      uint16_t prescaler =       get16(cursor); cursor += 2;
+      uint32_t period =          get32(cursor); cursor += 4;
+      uint16_t num_points =      get16(cursor); cursor += 2;
+      uint8_t sample_width =           *cursor; cursor++;
+      uint16_t sample_time =     get16(cursor); cursor += 2;
+      uint16_t num_buffers =     get16(cursor); cursor += 2;
+      uint8_t backend =                *cursor; cursor++;
+      uint16_t window_len =      get16(cursor); cursor += 2;
+      uint16_t hop =             get16(cursor); cursor += 2;
+      uint8_t num_channels =           *cursor; cursor++;
+
+      // Two halves for double buffering
+      uint32_t buflen = 2 * num_points * sample_width * num_channels;
+
+      if (0 == num_channels || num_channels > EOL_BENCH_MAX_CHANNELS ||
+          0 == num_buffers || num_points < 2) {
+        xmit_error(family, subtype, "Nothing to do: %d channels (max %d), %d buffers, %d points",
+                   num_channels, EOL_BENCH_MAX_CHANNELS, num_buffers, num_points);
+        return;
+      }
+      if (1 != sample_width && 2 != sample_width) {
+        xmit_error(family, subtype, "Bad sample width: %d", sample_width);
+        return;
+      }
+      if (DTMF_BACKEND_FLOAT != backend && DTMF_BACKEND_FIXED != backend) {
+        xmit_error(family, subtype, "Bad backend: %d", backend);
+        return;
+      }
+      if (payload_len < EOL_BENCH_DTMF_HEADER + num_channels) {
+        xmit_error(family, subtype, "Short packet: %d channels need %d bytes, got %d",
+                   num_channels, EOL_BENCH_DTMF_HEADER + num_channels, payload_len);
+        return;
+      }
+      if (buflen > eol_adc_buf_len) {
+        xmit_error(family, subtype, "Buffer truncation! %d bytes available, %d requested", eol_adc_buf_len, buflen);
+        return;
+      }
+
+      adc_config_t adc_config = {
+                                 .prescaler = prescaler,
+                                 .period = period,
+                                 .buf = eol_adc_buf,
+                                 .buflen = buflen,
+                                 .double_buffer = 1,
+                                 .n_channels = num_channels,
+                                 .sample_width = sample_width,
+                                 .adcclk_prescaler = 2,
+                                 .adc_sample_time = sample_time,
+                                 .cb = eol_bench_dtmf_callback,
+      };
+
+      for (int i = 0; i < num_channels; i++) {
+        adc_config.channels[i] = *cursor; cursor++;
+      }
+
+      // Explicitly stop the ADC and reset its state
+      adc_stop();
+
+      float Fs = adc_setup(&adc_config);
+
+      for (int ch = 0; ch < num_channels; ch++) {
+        dtmf_decoder_init(&eol_bench_decoders[ch], Fs, 0.2, NULL, NULL, backend);
+        if (DTMF_OKAY != dtmf_decoder_set_window(&eol_bench_decoders[ch], window_len, hop, NULL)) {
+          xmit_error(family, subtype, "Bad window: %d samples, hop %d", window_len, hop);
+          return;
+        }
+      }
+
+      eol_bench_n_channels = num_channels;
+      eol_bench_sample_width = sample_width;
+      eol_bench_buffers_left = num_buffers;
+
+      adc_start();
+      xmit_ack(family, 'd', "%d buffers at %dHz", num_buffers, (int)Fs);
+      return;
+    }
+
+    if ('Q' == subtype) {
+      // Benchmark Query
+      // uint8_t reset: nonzero to clear the statistics after reading them (optional)
+      //
+      // Replies with a 'B' 'q' packet of uint32_t values:
+      // count, min_cycles, avg_cycles, max_cycles, cpu_hz
+      //
+      // These cover every ADC callback since the last ADC setup (or
+      // reset), whatever it was doing.
+      // A bare query doesn't reset anything
+      uint8_t reset = (payload_len > 2) ? *cursor : 0;
+      adc_cb_stats_t stats;
+      uint8_t reply[20];
+
+      adc_get_cb_stats(&stats);
+      if (reset) {
+        adc_reset_cb_stats();
+      }
+
+      uint32_t avg = (stats.count ? stats.total_cycles / stats.count : 0);
+
+      put32(reply, stats.count);
+      put32(reply+4, stats.count ? stats.min_cycles : 0);
+      put32(reply+8, avg);
+      put32(reply+12, stats.max_cycles);
+      put32(reply+16, rcc_ahb_frequency);
+
+      xmit_buf(family, 'q', reply, sizeof(reply), TX_PRIO_CONTROL);
+      return;
+    }
+
+    xmit_unk(family, subtype);
+    return;
+
   default:
     xmit_unk(family, subtype);
     return;
@@ -371,5 +809,20 @@ void eol_command_handle(uint8_t *payload, uint16_t payload_len,
 
 // buf,buflen -> actions
 
+/**
+ * Find out if the DAC commands have taken over the DAC
+ *
+ * \returns true if any DAC command has run since the last call
+ *
+ * The main loop streams its DTMF digits out of the DAC, and uses this
+ * to find out when it has to set that stream up again.  It must be
+ * called from the same context as eol_command_handle().
+ */
+bool eol_dac_reclaim(void) {
+  bool taken = eol_dac_taken;
+  eol_dac_taken = false;
+  return taken;
+}
+
 
 /** \} */ // End doxygen group
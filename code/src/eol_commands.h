@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * \file eol_commands.h
@@ -14,6 +15,7 @@
  */
 
 void eol_command_handle(uint8_t *, uint16_t, uint8_t, uint8_t, uint8_t);
+bool eol_dac_reclaim(void);
 
 
 /** \} */ // End doxygen group
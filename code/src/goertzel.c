@@ -0,0 +1,420 @@
+#include "goertzel.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#include "sin_gen.h"
+#define M_PI (2*COS_THETA0)
+#endif
+
+/**
+ * \file goertzel.c
+ * \brief A bank of Goertzel filters for arbitrary frequencies
+ *
+ * \defgroup goertzel Goertzel tone bank
+ * \addtogroup goertzel
+ * \{
+ *
+ * This is the generalized cousin of the filters inside the DTMF
+ * decoder: instead of the eight DTMF tones, you give it a list of up
+ * to GOERTZEL_MAX_BINS frequencies, and it tells you how much of each
+ * one is in a buffer of samples.  It's meant for checking tones on
+ * the EOL stand without having to ship whole ADC buffers back over
+ * the serial link.
+ *
+ * Like the DTMF decoder, the frequencies don't have to land on DFT
+ * bin centers: the coefficients are computed for the exact frequency
+ * requested, as in ST's DT0089.
+ *
+ * To use it, set up a goertzel_bank_t with goertzel_bank_init(), then
+ * hand buffers to goertzel_bank_run() (or goertzel_bank_run_fixed(),
+ * for integer arithmetic).  The bank itself is never modified by
+ * running it, so one bank can be shared between any number of
+ * channels.  These remove the mean of each buffer before filtering,
+ * so the results don't depend on the ADC's bias point.
+ *
+ * The filters themselves are the goertzel_feed_*() and
+ * goertzel_mags_*() kernels, which the DTMF decoder runs on its own
+ * eight-bin bank.  They push each sample through every bin in one
+ * pass, with the filter states held as a structure of arrays, and
+ * leave normalization, windowing and offset tracking to the caller.
+ */
+
+/**
+ * Set up a Goertzel bank
+ *
+ * \param bank The bank to set up (caller-owned)
+ * \param Fs The sampling rate, in samples per second ("Hz")
+ * \param freqs The frequencies to watch, in Hz
+ * \param n_bins How many entries there are in freqs
+ *
+ * \returns GOERTZEL_OKAY on success, otherwise
+ * GOERTZEL_INVALID_INPUTS for NULL pointers, n_bins of 0, a
+ * non-positive Fs, or a negative frequency;
+ * GOERTZEL_TOO_MANY_BINS if n_bins is over GOERTZEL_MAX_BINS; or
+ * GOERTZEL_UNDERSAMPLED if any frequency is at or above Fs/2.
+ *
+ * On error, the bank is left with no bins.
+ */
+goertzel_status_t goertzel_bank_init(goertzel_bank_t *bank, float Fs, const float *freqs, uint8_t n_bins) {
+  if (!bank) return GOERTZEL_INVALID_INPUTS;
+
+  memset(bank, 0, sizeof(goertzel_bank_t));
+
+  if (!freqs || 0 == n_bins || Fs <= 0) return GOERTZEL_INVALID_INPUTS;
+  if (n_bins > GOERTZEL_MAX_BINS) return GOERTZEL_TOO_MANY_BINS;
+
+  for (int i = 0; i < n_bins; i++) {
+    if (freqs[i] < 0) return GOERTZEL_INVALID_INPUTS;
+    if (freqs[i] >= Fs/2) return GOERTZEL_UNDERSAMPLED;
+  }
+
+  bank->Fs = Fs;
+
+  for (int i = 0; i < n_bins; i++) {
+    float w = 2 * M_PI * freqs[i]/Fs;
+
+    bank->freqs[i] = freqs[i];
+    bank->cos_w[i] = cosf(w);
+    bank->sin_w[i] = sinf(w);
+    bank->coef[i] = 2*bank->cos_w[i];
+
+    bank->cos_w_q[i] = lroundf(bank->cos_w[i] * (1 << GOERTZEL_COEF_Q));
+    bank->sin_w_q[i] = lroundf(bank->sin_w[i] * (1 << GOERTZEL_COEF_Q));
+    bank->coef_q[i] = 2*bank->cos_w_q[i];
+  }
+
+  // Only publish the bins once they're all good
+  bank->n_bins = n_bins;
+
+  return GOERTZEL_OKAY;
+}
+
+/**
+ * (Internal) Fetch one sample out of a raw ADC buffer
+ *
+ * \param buf The buffer
+ * \param sample_width 1 for 8b samples, 2 for native endian 16b samples
+ * \param i Which sample to get, counted in samples
+ */
+static inline uint16_t goertzel_sample(const uint8_t *buf, uint8_t sample_width, uint32_t i) {
+  if (1 == sample_width) return buf[i];
+
+  // memcpy keeps this legal for unaligned buffers, and still comes
+  // out as a single halfword load on the Cortex-M
+  uint16_t sample;
+  memcpy(&sample, buf + 2*i, sizeof(sample));
+  return sample;
+}
+
+/**
+ * (Internal) Push one sample through every floating point filter
+ */
+static inline void goertzel_step_float(const float *coef, float *z1, float *z2, uint8_t n_bins, float x) {
+  for (int bin = 0; bin < n_bins; bin++) {
+    float z0 = x + (coef[bin] * z1[bin]) - z2[bin];
+    z2[bin] = z1[bin];
+    z1[bin] = z0;
+  }
+}
+
+/**
+ * (Internal) Push one sample through every integer filter
+ */
+static inline void goertzel_step_fixed(const int32_t *coef, int32_t *z1, int32_t *z2, uint8_t n_bins, int32_t x) {
+  for (int bin = 0; bin < n_bins; bin++) {
+    int32_t z0 = x + (int32_t)(((int64_t)coef[bin] * z1[bin]) >> GOERTZEL_COEF_Q) - z2[bin];
+    z2[bin] = z1[bin];
+    z1[bin] = z0;
+  }
+}
+
+/**
+ * (Internal) The body of goertzel_feed_float()
+ *
+ * This is inlined into goertzel_feed_float() with constant n_bins
+ * and sample_width for the common cases.  The states are copied into
+ * locals for the duration: otherwise the sample loads could alias
+ * them, and the compiler would have to go back to memory for every
+ * bin of every sample.
+ */
+static inline uint32_t feed_float(const float *coef, uint8_t n_bins, float *z1_io, float *z2_io,
+                                  const uint8_t *buf, uint8_t sample_width, uint8_t stride,
+                                  uint16_t n_samples, const int16_t *window, float offset, float scale) {
+  float z1[GOERTZEL_MAX_BINS];
+  float z2[GOERTZEL_MAX_BINS];
+  uint32_t sum = 0;
+
+  memcpy(z1, z1_io, n_bins * sizeof(float));
+  memcpy(z2, z2_io, n_bins * sizeof(float));
+
+  if (NULL == window) {
+    for (uint32_t i = 0; i < n_samples; i++) {
+      const uint16_t raw = goertzel_sample(buf, sample_width, i*stride);
+      sum += raw;
+      goertzel_step_float(coef, z1, z2, n_bins, (raw - offset) * scale);
+    }
+  } else {
+    for (uint32_t i = 0; i < n_samples; i++) {
+      const uint16_t raw = goertzel_sample(buf, sample_width, i*stride);
+      sum += raw;
+      goertzel_step_float(coef, z1, z2, n_bins, (raw - offset) * scale * (window[i] * (1.0f/32768)));
+    }
+  }
+
+  memcpy(z1_io, z1, n_bins * sizeof(float));
+  memcpy(z2_io, z2, n_bins * sizeof(float));
+
+  return sum;
+}
+
+/**
+ * (Internal) The body of goertzel_feed_fixed(), see feed_float()
+ */
+static inline uint32_t feed_fixed(const int32_t *coef, uint8_t n_bins, int32_t *z1_io, int32_t *z2_io,
+                                  const uint8_t *buf, uint8_t sample_width, uint8_t stride,
+                                  uint16_t n_samples, const int16_t *window, int32_t offset_q,
+                                  uint8_t shift) {
+  int32_t z1[GOERTZEL_MAX_BINS];
+  int32_t z2[GOERTZEL_MAX_BINS];
+  uint32_t sum = 0;
+
+  memcpy(z1, z1_io, n_bins * sizeof(int32_t));
+  memcpy(z2, z2_io, n_bins * sizeof(int32_t));
+
+  for (uint32_t i = 0; i < n_samples; i++) {
+    const uint16_t raw = goertzel_sample(buf, sample_width, i*stride);
+    sum += raw;
+
+    int32_t x = ((int32_t)raw << shift) - offset_q; // Current sample
+    if (NULL != window) {
+      x = (x * window[i]) >> 15;
+    }
+
+    goertzel_step_fixed(coef, z1, z2, n_bins, x);
+  }
+
+  memcpy(z1_io, z1, n_bins * sizeof(int32_t));
+  memcpy(z2_io, z2, n_bins * sizeof(int32_t));
+
+  return sum;
+}
+
+/**
+ * Push strided samples through a bank's floating point filters
+ *
+ * \param bank The bank to take coefficients from
+ * \param z1[inout] The z^-1 filter states, one per bin
+ * \param z2[inout] The z^-2 filter states, one per bin
+ * \param buf The first sample to process
+ * \param sample_width 1 for 8b samples, 2 for 16b words
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many samples to process
+ * \param window Q15 window weights for these samples, or NULL for none
+ * \param offset The DC offset to remove from each sample, in ADC counts
+ * \param scale What to multiply each sample by after removing the offset
+ *
+ * \returns The sum of the raw samples, for offset tracking
+ *
+ * The states carry over between calls, so a window can be fed in as
+ * many pieces as you like.  Start them at zero.
+ */
+uint32_t goertzel_feed_float(const goertzel_bank_t *bank, float *z1, float *z2,
+                             const uint8_t *buf, uint8_t sample_width, uint8_t stride,
+                             uint16_t n_samples, const int16_t *window, float offset, float scale) {
+  // Spell out the DTMF decoder's eight bins, so they can live in registers
+  if (8 == bank->n_bins) {
+    if (1 == sample_width) {
+      return feed_float(bank->coef, 8, z1, z2, buf, 1, stride, n_samples, window, offset, scale);
+    }
+    return feed_float(bank->coef, 8, z1, z2, buf, 2, stride, n_samples, window, offset, scale);
+  }
+
+  return feed_float(bank->coef, bank->n_bins, z1, z2, buf, sample_width, stride, n_samples,
+                    window, offset, scale);
+}
+
+/**
+ * Push strided samples through a bank's integer filters
+ *
+ * \param bank The bank to take coefficients from
+ * \param z1[inout] The z^-1 filter states, one per bin
+ * \param z2[inout] The z^-2 filter states, one per bin
+ * \param buf The first sample to process
+ * \param sample_width 1 for 8b samples, 2 for 16b words
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many samples to process
+ * \param window Q15 window weights for these samples, or NULL for none
+ * \param offset_q The DC offset to remove, already shifted up by shift
+ * \param shift How far to shift each sample up, for fractional bits
+ *
+ * \returns The sum of the raw samples, for offset tracking
+ *
+ * This is the fixed point twin of goertzel_feed_float().  The
+ * recurrence runs on the shifted raw samples, with the coefficients
+ * in Q(GOERTZEL_COEF_Q).  The products are taken in 64 bits, which
+ * is a single SMULL on the Cortex-M4/M7.
+ *
+ * The states are 32b, so the shifted full scale times the number of
+ * samples in a window needs to stay well clear of 2^31.
+ */
+uint32_t goertzel_feed_fixed(const goertzel_bank_t *bank, int32_t *z1, int32_t *z2,
+                             const uint8_t *buf, uint8_t sample_width, uint8_t stride,
+                             uint16_t n_samples, const int16_t *window, int32_t offset_q,
+                             uint8_t shift) {
+  if (8 == bank->n_bins) {
+    if (1 == sample_width) {
+      return feed_fixed(bank->coef_q, 8, z1, z2, buf, 1, stride, n_samples, window, offset_q, shift);
+    }
+    return feed_fixed(bank->coef_q, 8, z1, z2, buf, 2, stride, n_samples, window, offset_q, shift);
+  }
+
+  return feed_fixed(bank->coef_q, bank->n_bins, z1, z2, buf, sample_width, stride, n_samples,
+                    window, offset_q, shift);
+}
+
+/**
+ * Get the magnitudes out of floating point filter states
+ *
+ * \param bank The bank the states came from
+ * \param z1 The z^-1 filter states, one per bin
+ * \param z2 The z^-2 filter states, one per bin
+ * \param mags[out] The magnitude-squared of each bin
+ *
+ * These aren't normalized: for N samples of a sine of amplitude A,
+ * the bin reads about (A*N/2)^2.
+ */
+void goertzel_mags_float(const goertzel_bank_t *bank, const float *z1, const float *z2, float *mags) {
+  for (int bin = 0; bin < bank->n_bins; bin++) {
+    float res_i = z1[bin] * bank->cos_w[bin] - z2[bin];
+    float res_q = z1[bin] * bank->sin_w[bin];
+
+    mags[bin] = res_i*res_i + res_q*res_q;
+  }
+}
+
+/**
+ * Get the magnitudes out of integer filter states
+ *
+ * \param bank The bank the states came from
+ * \param z1 The z^-1 filter states, one per bin
+ * \param z2 The z^-2 filter states, one per bin
+ * \param mags[out] The magnitude-squared of each bin, in shifted sample units
+ */
+void goertzel_mags_fixed(const goertzel_bank_t *bank, const int32_t *z1, const int32_t *z2, int64_t *mags) {
+  for (int bin = 0; bin < bank->n_bins; bin++) {
+    int64_t res_i = (((int64_t)z1[bin] * bank->cos_w_q[bin]) >> GOERTZEL_COEF_Q) - z2[bin];
+    int64_t res_q = ((int64_t)z1[bin] * bank->sin_w_q[bin]) >> GOERTZEL_COEF_Q;
+
+    mags[bin] = res_i*res_i + res_q*res_q;
+  }
+}
+
+/**
+ * (Internal) Sum up strided samples, to find their mean
+ */
+static uint32_t goertzel_sum(const uint8_t *buf, uint8_t sample_width, uint8_t stride, uint16_t n_samples) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n_samples; i++) {
+    sum += goertzel_sample(buf, sample_width, i*stride);
+  }
+  return sum;
+}
+
+/**
+ * Run a Goertzel bank over a buffer of samples
+ *
+ * \param bank The bank to use, set up by goertzel_bank_init()
+ * \param buf The first sample to look at
+ * \param sample_width 1 for 8b samples, 2 for 16b samples, as in adc_config_t
+ * \param stride Distance between successive samples, in samples
+ * \param n_samples How many samples to process
+ * \param amplitudes[out] The amplitude of each bin, coindexed with bank->freqs
+ *
+ * The amplitudes come out in ADC counts: a full scale sine wave on an
+ * 8b ADC reads as about 127.5 in its bin.  (Modulo the leakage you
+ * get from a frequency that doesn't complete a whole number of cycles
+ * in the buffer, which is more pronounced the shorter the buffer.)
+ *
+ * The stride lets you point this straight at one channel of an
+ * interleaved multi-channel ADC buffer: for channel k of n, pass in
+ * buf + k*sample_width and a stride of n.
+ *
+ * If n_samples is zero, all the amplitudes are zero.
+ */
+void goertzel_bank_run(const goertzel_bank_t *bank, const uint8_t *buf,
+                       uint8_t sample_width, uint8_t stride, uint16_t n_samples,
+                       float *amplitudes) {
+  float z1[GOERTZEL_MAX_BINS] = { 0 };
+  float z2[GOERTZEL_MAX_BINS] = { 0 };
+  float mags[GOERTZEL_MAX_BINS];
+
+  if (0 == n_samples) {
+    memset(amplitudes, 0, bank->n_bins * sizeof(float));
+    return;
+  }
+
+  // First pass: find the DC offset; second pass: run the filters
+  const float mean = (float)goertzel_sum(buf, sample_width, stride, n_samples) / n_samples;
+  goertzel_feed_float(bank, z1, z2, buf, sample_width, stride, n_samples, NULL, mean, 1.0f);
+  goertzel_mags_float(bank, z1, z2, mags);
+
+  for (int bin = 0; bin < bank->n_bins; bin++) {
+    amplitudes[bin] = 2 * sqrtf(mags[bin]) / n_samples;
+  }
+}
+
+/**
+ * Run a Goertzel bank over a buffer of samples in integer arithmetic
+ *
+ * This takes the same arguments and gives the same results as
+ * goertzel_bank_run(), but runs the filters with the fixed point
+ * kernel, which is much faster on cores without a double precision
+ * FPU (and than the single precision one on some).  The mean is
+ * rounded to 1/2^GOERTZEL_SAMPLE_SHIFT of a count.
+ *
+ * See goertzel_feed_fixed() for the limits on n_samples.
+ */
+void goertzel_bank_run_fixed(const goertzel_bank_t *bank, const uint8_t *buf,
+                             uint8_t sample_width, uint8_t stride, uint16_t n_samples,
+                             float *amplitudes) {
+  int32_t z1[GOERTZEL_MAX_BINS] = { 0 };
+  int32_t z2[GOERTZEL_MAX_BINS] = { 0 };
+  int64_t mags[GOERTZEL_MAX_BINS];
+
+  if (0 == n_samples) {
+    memset(amplitudes, 0, bank->n_bins * sizeof(float));
+    return;
+  }
+
+  const uint8_t shift = (1 == sample_width) ? GOERTZEL_SAMPLE_SHIFT : GOERTZEL_SAMPLE_SHIFT16;
+  const uint64_t sum = goertzel_sum(buf, sample_width, stride, n_samples);
+  const int32_t offset_q = ((sum << shift) + n_samples/2) / n_samples;
+
+  goertzel_feed_fixed(bank, z1, z2, buf, sample_width, stride, n_samples, NULL, offset_q, shift);
+  goertzel_mags_fixed(bank, z1, z2, mags);
+
+  for (int bin = 0; bin < bank->n_bins; bin++) {
+    amplitudes[bin] = 2 * sqrtf((float)mags[bin]) / ((1 << shift) * n_samples);
+  }
+}
+
+/**
+ * Get a printable name for a goertzel_status_t
+ *
+ * \param status The status to look up
+ *
+ * \returns A constant string, or NULL for unknown values
+ */
+const char *goertzel_status_name(goertzel_status_t status) {
+  switch(status) {
+  case GOERTZEL_OKAY: return "OKAY";
+  case GOERTZEL_INVALID_INPUTS: return "INVALID_INPUTS";
+  case GOERTZEL_TOO_MANY_BINS: return "TOO_MANY_BINS";
+  case GOERTZEL_UNDERSAMPLED: return "UNDERSAMPLED";
+  default: return NULL;
+  }
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+/**
+ * \file goertzel.h
+ * \brief Header for the Goertzel tone bank
+ *
+ * \addtogroup goertzel
+ * \{
+ */
+
+#define GOERTZEL_MAX_BINS 16 //!< The most frequencies a single bank can watch
+
+#define GOERTZEL_COEF_Q 14 //!< Number of fractional bits in the fixed point coefficients
+#define GOERTZEL_SAMPLE_SHIFT 4 //!< Headroom shift applied to 8b samples in fixed point
+#define GOERTZEL_SAMPLE_SHIFT16 2 //!< Headroom shift applied to 12b samples in fixed point
+
+/**
+ * Status codes for setting up a Goertzel bank
+ */
+typedef enum goertzel_status {
+			      GOERTZEL_OKAY = 0, //!< The bank is ready to use
+			      GOERTZEL_INVALID_INPUTS, //!< NULL pointers, no bins, or a bad sample rate
+			      GOERTZEL_TOO_MANY_BINS, //!< More than GOERTZEL_MAX_BINS requested
+			      GOERTZEL_UNDERSAMPLED, //!< A frequency is at or above Nyquist
+} goertzel_status_t;
+
+/**
+ * A bank of Goertzel filters, each watching one frequency
+ *
+ * The arrays are all coindexed with freqs.
+ */
+typedef struct goertzel_bank {
+  float Fs; //!< The sample rate the coefficients were computed for
+  uint8_t n_bins; //!< How many of the entries below are in use
+
+  float freqs[GOERTZEL_MAX_BINS]; //!< The frequency of each bin, in Hz
+  float cos_w[GOERTZEL_MAX_BINS]; //!< cos(w) for each bin
+  float sin_w[GOERTZEL_MAX_BINS]; //!< sin(w) for each bin
+  float coef[GOERTZEL_MAX_BINS]; //!< The 2*cos(w) feedback term for each bin
+
+  int32_t cos_w_q[GOERTZEL_MAX_BINS]; //!< cos(w) in Q(GOERTZEL_COEF_Q), for fixed point
+  int32_t sin_w_q[GOERTZEL_MAX_BINS]; //!< sin(w) in Q(GOERTZEL_COEF_Q), for fixed point
+  int32_t coef_q[GOERTZEL_MAX_BINS]; //!< 2*cos(w) in Q(GOERTZEL_COEF_Q), for fixed point
+} goertzel_bank_t;
+
+goertzel_status_t goertzel_bank_init(goertzel_bank_t *, float, const float *, uint8_t);
+void goertzel_bank_run(const goertzel_bank_t *, const uint8_t *, uint8_t, uint8_t, uint16_t, float *);
+void goertzel_bank_run_fixed(const goertzel_bank_t *, const uint8_t *, uint8_t, uint8_t, uint16_t, float *);
+
+uint32_t goertzel_feed_float(const goertzel_bank_t *, float *, float *,
+                             const uint8_t *, uint8_t, uint8_t, uint16_t,
+                             const int16_t *, float, float);
+uint32_t goertzel_feed_fixed(const goertzel_bank_t *, int32_t *, int32_t *,
+                             const uint8_t *, uint8_t, uint8_t, uint16_t,
+                             const int16_t *, int32_t, uint8_t);
+void goertzel_mags_float(const goertzel_bank_t *, const float *, const float *, float *);
+void goertzel_mags_fixed(const goertzel_bank_t *, const int32_t *, const int32_t *, int64_t *);
+const char *goertzel_status_name(goertzel_status_t);
+
+/** \} */ // End doxygen group
@@ -65,16 +65,21 @@ static uint8_t log_level_to_cmd(log_level_t loglevel) {
  *
  */
 void logline(log_level_t loglevel, const char *fmt, ...) {
-  char buf[1024];
-  uint16_t buflen;
+  char buf[PACKET_MAX_PAYLOAD_LENGTH];
+  int buflen;
 
   va_list argp;
   va_start(argp, fmt);
-  buflen = vsprintf(buf, fmt, argp);
+  buflen = vsnprintf(buf, sizeof(buf), fmt, argp);
   va_end(argp);
 
-  packet_send((const uint8_t*)buf, buflen, 'L',
-              log_level_to_cmd(loglevel));
+  if (buflen < 0) return;
+  if (buflen >= (int)sizeof(buf)) buflen = sizeof(buf) - 1; // Truncated
+
+  // This is framed on the fly into the console's TX queue, behind
+  // any control replies and data
+  packet_send_prio((const uint8_t*)buf, buflen, 'L',
+                   log_level_to_cmd(loglevel), TX_PRIO_LOG);
 
   //printf("[%s] %s\n", log_level_to_str(loglevel), buf);
 }
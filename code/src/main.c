@@ -24,6 +24,9 @@
 #include "sin_gen.h"
 #include "pi_reciter.h"
 #include "dtmf.h"
+#include "decimate.h"
+#include "wave_cache.h"
+#include "tone_seq.h"
 #include "packet.h"
 
 
@@ -48,16 +51,17 @@
  * States for our DTMF modem state machine
  *
  * The DTMF state machine controls both the modulation and the
- * demodulation.  When it "hears" a digit, it stops the DAC, and
- * prepares to go to the next digit once it's clear.  However, there
- * are race conditions, where a tone_start callback for the same
- * symbol can happen after the DAC was stopped.
+ * demodulation.  The digits go out back to back as fixed-length tone
+ * bursts from the tone sequencer, a few ahead of the decoder, and
+ * each one is confirmed as it's "heard".  However, there are race
+ * conditions, where a tone_start callback for the same symbol can
+ * happen after the tone has ended.
  *
  * We therefore need a buffer state to handle that case.
  */
 typedef enum tone_modem_state {
                                MODEM_IDLE = 0, //!< Not currently doing DTMF
-                               MODEM_WAITING_SEND, //!< Triggered for send to start
+                               MODEM_WAITING_SEND, //!< Waiting for the sequencer to drain before starting
                                MODEM_SENDING, //!< Modulating a symbol
                                MODEM_WAITING_STOP, //!< Tone detected, waiting for complete stop
                                MODEM_DONE, //!< Modem completed symbol
@@ -67,21 +71,55 @@ typedef enum tone_modem_state {
 ////////////////////////////////////////////////////////////
 // Globals
 
-#define DAC_WAVEFORM_LEN 1024
-static uint8_t dac_buf[DAC_WAVEFORM_LEN]; //!< The waveform to emit when bored
+#define DAC_WAVEFORM_LEN 1024 //!< Longest waveform for any one DTMF symbol
+static uint16_t dac_pool[WAVE_CACHE_N_SYMBOLS*DAC_WAVEFORM_LEN]; //!< Backing memory for dac_waves
+static wave_cache_t dac_waves; //!< The waveforms to emit when bored, one per symbol
+static const uint16_t *dac_buf; //!< The waveform currently being emitted (12b)
+static uint16_t dac_buf_len; //!< How long dac_buf is
 static float dac_sample_rate; //!< The sampling rate of the DAC
 
-#define ADC_NUM_SAMPLES 2048 //!< Number of samples to capture, Double-buffer means this gets halved
+#define DAC_STREAM_LEN 512 //!< Streaming DAC buffer, both halves
+#define TONE_SEQ_ENTRIES 8 //!< Size of the tone sequencer's ring
+#define TONE_ON_MS 45 //!< How long to send each digit for
+#define TONE_OFF_MS 10 //!< How long to pause after each digit
+#define TONE_REPEAT_OFF_MS 50 //!< Pause before a repeated digit: two DTMF blocks, so the decoder sees it
+#define TONE_QUEUE_AHEAD 4 //!< Digits to keep queued ahead of the decoder (must be below TONE_SEQ_ENTRIES)
+static uint16_t dac_stream[DAC_STREAM_LEN]; //!< Where tone_seq renders to
+static tone_seq_entry_t tone_seq_entries[TONE_SEQ_ENTRIES]; //!< Backing memory for tone_seq
+static tone_seq_t tone_seq; //!< Times the digits out to the DAC
+static bool dac_taken; //!< The EOL commands have had the DAC since we last set up the stream
+
+#define ADC_DECIMATION 6 //!< ADC samples per DTMF sample (48kHz down to 8kHz)
+#define ADC_CIC_ORDER 3 //!< Order of the decimating filter
+#define DTMF_BLOCK_LEN 200 //!< DTMF samples per half of the ADC buffer
+
+#define ADC_NUM_SAMPLES (2*ADC_DECIMATION*DTMF_BLOCK_LEN) //!< Number of samples to capture, Double-buffer means this gets halved
 static uint8_t adc_buf[ADC_NUM_SAMPLES];
 static float adc_sample_rate; //!< The sampling rate of the ADC
 
+static decimate_t adc_decimator; //!< Brings the ADC stream down to the DTMF rate
+static uint16_t dtmf_buf[DTMF_BLOCK_LEN+1]; //!< Decimated samples, for the DTMF decoder
+
 static uint8_t modem_state;
+static uint8_t modem_unheard_ticks; //!< Main loop ticks we've been sending with nothing queued
+static uint16_t modem_sent; //!< Digits of pi queued since the last reset (main loop only)
+static volatile uint16_t modem_heard; //!< Digits of pi heard back since the last reset (written by the ADC ISR)
 
 static uint32_t console_callbacks_count;
 
+static packet_parser_data_t eol_parser; //!< Deframes the EOL control link
+
+/**
+ * ADC callback: decimate a half-buffer, and hand it to the DTMF decoder
+ */
+static void adc_decimate_cb(const uint8_t *buf, uint16_t buflen) {
+  uint16_t n = decimate_run(&adc_decimator, buf, 1, buflen, dtmf_buf);
+  dtmf_process16(dtmf_buf, n);
+}
+
 static  adc_config_t adc_config = {
-                                   .prescaler = ADC_PRESCALER_8KHZ,
-                                   .period = ADC_PERIOD_8KHZ,
+                                   .prescaler = ADC_PRESCALER_48KHZ,
+                                   .period = ADC_PERIOD_48KHZ,
                                    .buf = adc_buf,
                                    .buflen = ADC_NUM_SAMPLES,
                                    .double_buffer = 1,
@@ -91,7 +129,7 @@ static  adc_config_t adc_config = {
                                    .sample_width = 1,
                                    .adcclk_prescaler = 2,
                                    .adc_sample_time = 112,
-                                   .cb = dtmf_process,
+                                   .cb = adc_decimate_cb,
 };
 
 
@@ -99,111 +137,141 @@ static  adc_config_t adc_config = {
 // Misc functions
 
 /**
- * Fill a buffer with a DTMF waveform, using the less-pleasant
- * sin_gen_generate_fill()
+ * Point dac_buf at the cached waveform for a DTMF symbol
+ *
+ * This (re)builds the cache first, which is free unless the DAC's
+ * sample rate has changed since last time.
+ *
+ * \returns WAVE_CACHE_OKAY, or the failure (in which case dac_buf is
+ * cleared)
  */
-static void fill_dtmf_waveform_buf(float f0, float f1) {
-  sin_gen_result_t res;
-  sin_gen_request_t req;
-
-  uint8_t working_buf[DAC_WAVEFORM_LEN];
-
-  //  logline(LEVEL_DEBUG, "filling DTMF buffer: %d / %d  (%d Sps)", (int)f0, (int)f1, (int)dac_sample_rate);
-
-  //////////////////////////////
-  // Generate tone f0 at full amplitude in our working buffer
-  res = sin_gen_populate(&req, working_buf, DAC_WAVEFORM_LEN, f0, dac_sample_rate);
-  if (SIN_GEN_OKAY != res) {
-    logline(LEVEL_ERROR, "Failed to populate sin_gen request, bailing on DAC setup: %s!",
-	    sin_gen_result_name(res));
-    return;
+static wave_cache_status_t select_dtmf_waveform(uint8_t symbol) {
+  wave_cache_status_t res;
+
+  res = wave_cache_build(&dac_waves, dac_sample_rate);
+  if (WAVE_CACHE_OKAY != res) {
+    logline(LEVEL_ERROR, "Failed to build DTMF waveforms at %d Sps: %s!",
+	    (int)dac_sample_rate, wave_cache_status_name(res));
+    dac_buf = NULL;
+    dac_buf_len = 0;
+    return res;
   }
-  req.scale = 2; // Turn it down a little
 
-  res = sin_gen_generate_fill(&req);
-  if (SIN_GEN_OKAY != res) {
-    logline(LEVEL_ERROR, "Failed to generate sine tone of %ld Hz, bailing on DAC setup: %s!",
-	    f0, sin_gen_result_name(res));
-    return;
+  res = wave_cache_get(&dac_waves, symbol, &dac_buf, &dac_buf_len);
+  if (WAVE_CACHE_OKAY != res) {
+    logline(LEVEL_ERROR, "No DTMF waveform for '%c', bailing on DAC setup: %s!",
+	    symbol, wave_cache_status_name(res));
+    dac_buf = NULL;
+    dac_buf_len = 0;
+    return res;
   }
 
+  return WAVE_CACHE_OKAY;
+}
 
-  //////////////////////////////
-  // Generate tone f1 at full amplitude in our dac buffer
-  res = sin_gen_populate(&req, dac_buf, DAC_WAVEFORM_LEN, f1, dac_sample_rate);
-  if (SIN_GEN_OKAY != res) {
-    logline(LEVEL_ERROR, "Failed to populate sin_gen request, bailing on DAC setup: %s!",
-	    sin_gen_result_name(res));
-    return;
-  }
-  req.scale = 2; // Turn it down a little
-
-  res = sin_gen_generate_fill(&req);
-  if (SIN_GEN_OKAY != res) {
-    logline(LEVEL_ERROR, "Failed to generate sine tone of %ld Hz, bailing on DAC setup: %s!",
-	    f1, sin_gen_result_name(res));
-    return;
-  }
-
-  //////////////////////////////
-  // And combine the two
-  for (int i = 0; i < DAC_WAVEFORM_LEN; i++) {
-    int16_t j = dac_buf[i] + working_buf[i];
-    dac_buf[i] = j/2;
-  }
+/**
+ * DAC streaming producer: render the next stretch of the tone sequence
+ */
+static void dac_tone_seq_fill(uint16_t *buf, uint16_t n) {
+  tone_seq_fill(&tone_seq, buf, n);
 }
 
 /**
- * \brief Set up the DAC waveform to emit when bored
+ * \brief Set up the DAC to stream from the tone sequencer
+ *
+ * This must not be called with the DAC running, as it renders the
+ * first buffer's worth of samples itself.  Once started, the stream
+ * is left running: the sequencer idles the output when there's
+ * nothing queued, and digits can be pushed at any time.
  */
-static void dac_waveform_setup(void) {
+static void dac_tone_seq_setup(void) {
   uint16_t prescaler = 24;
   uint32_t period = 49;
 
   dac_sample_rate = dac_get_sample_rate(prescaler, period);
 
-  dac_setup(prescaler, period, dac_buf, DAC_WAVEFORM_LEN);
-  logline(LEVEL_INFO, "DAC sampling rate: %ld", (int)dac_sample_rate);
+  dac_setup_stream(prescaler, period, dac_stream, DAC_STREAM_LEN, dac_tone_seq_fill);
+  logline(LEVEL_INFO, "DAC sampling rate: %d", (int)dac_sample_rate);
 }
 
+/**
+ * \brief Queue up a DTMF symbol on the tone sequencer
+ *
+ * \param symbol The symbol to send
+ * \param off_ms How long to pause after it
+ *
+ * \returns Whether it was queued
+ */
+static bool dac_send_symbol(uint8_t symbol, float off_ms) {
+  if (WAVE_CACHE_OKAY != select_dtmf_waveform(symbol)) return false;
+
+  tone_seq_status_t res = tone_seq_push(&tone_seq, dac_buf, dac_buf_len,
+                                        tone_seq_ms_to_samples(TONE_ON_MS, dac_sample_rate),
+                                        tone_seq_ms_to_samples(off_ms, dac_sample_rate));
+  if (TONE_SEQ_OKAY != res) {
+    logline(LEVEL_ERROR, "Couldn't queue DTMF symbol '%c': %s", symbol, tone_seq_status_name(res));
+    return false;
+  }
+  return true;
+}
 
-static void tone_start_next_digit(void) {
-  float f_row, f_col;
-  uint8_t next_digit;
-  dtmf_status_t dtmf_stat;
 
-  if (modem_state == MODEM_RESTART) {
-    pi_reciter_reset();
-  }
+/**
+ * \brief Keep TONE_QUEUE_AHEAD digits queued on the sequencer
+ *
+ * The sequencer plays them back to back, so the tones and gaps are
+ * timed by the DAC clock; all the main loop has to do is stay ahead.
+ */
+static void tone_queue_digits(void) {
+  while ((uint16_t)(modem_sent - modem_heard) < TONE_QUEUE_AHEAD) {
+    uint8_t digit = pi_reciter_digit(modem_sent);
 
-  next_digit = pi_reciter_next_digit();
+    // The decoder can only tell a repeated digit from one long tone
+    // if it gets a whole block of silence in between.
+    float off_ms = (pi_reciter_digit(modem_sent+1) == digit) ? TONE_REPEAT_OFF_MS : TONE_OFF_MS;
 
-  dtmf_stat = dtmf_get_tones(next_digit, &f_row, &f_col);
+    if (!dac_send_symbol(digit, off_ms)) return;
+    modem_sent++;
+  }
+}
 
-  logline(LEVEL_DEBUG_NOISY, "tone_start_next_digit: %d: Next digit will be: %c: %d/%d",
-          modem_state, next_digit, (int)f_row, (int)f_col);
-  if (DTMF_OKAY != dtmf_stat) {
-    logline(LEVEL_ERROR, "tone_start_next_digit: Couldn't populate tones for symbol '%c' ", next_digit);
-    //!< \todo Decode DTMF errors
-    pi_reciter_reset();
-    next_digit = pi_reciter_next_digit();
+/**
+ * \brief Start sending from the first digit that hasn't been heard
+ *
+ * This only sets up the DAC stream again if the EOL commands have
+ * taken it over; otherwise the stream is already running, and the
+ * sequencer has drained (see MODEM_WAITING_SEND).
+ */
+static void tone_start(void) {
+  logline(LEVEL_DEBUG_NOISY, "tone_start: %d: starting from digit %d: %c",
+          modem_state, modem_heard, pi_reciter_digit(modem_heard));
+
+  if (dac_taken) {
+    dac_stop();
+    tone_seq_clear(&tone_seq);
+    dac_tone_seq_setup();
+    dac_start();
+    dac_taken = false;
   }
 
   modem_state = MODEM_SENDING;
+  modem_unheard_ticks = 0;
+  modem_sent = modem_heard;
+  tone_queue_digits();
 
-  // Just blast over the existing buffer while it's on, the glitches
-  // don't matter to us here.
-  fill_dtmf_waveform_buf(f_row,f_col);
-  // Reinitialize DAC DMA buffer, in case it's been reset by the EOL code
-  dac_waveform_setup();
-  dac_start();
+  decimate_reset(&adc_decimator);
   adc_setup(&adc_config);
   adc_start();
 }
 
+/**
+ * \brief Stop listening for digits
+ *
+ * Anything already queued is left to play out; the DAC stream keeps
+ * running, and idles once it's done.
+ */
 static void tone_stop(void) {
   modem_state = MODEM_IDLE;
-  dac_stop();
   adc_stop();
 }
 
@@ -282,7 +350,8 @@ static void dtmf_tone_stop_cb(uint8_t sym, float ms) {
   //logline(LEVEL_INFO, "\t\tTone stop (%d): %c / %d ms expect %c",
   //       modem_state, sym, (int)(1000*ms), expected);
 
-  if ((modem_state != MODEM_SENDING) && (modem_state != MODEM_WAITING_STOP)) {
+  if ((modem_state != MODEM_SENDING) && (modem_state != MODEM_WAITING_STOP) &&
+      (modem_state != MODEM_DONE)) {
     return;
   }
 
@@ -295,6 +364,7 @@ static void dtmf_tone_stop_cb(uint8_t sym, float ms) {
     modem_state = MODEM_RESTART;
   } else {
     logline(LEVEL_INFO, "Pi: %c okay, will advance", sym);
+    modem_heard++;
     modem_state = MODEM_DONE;
   }
 
@@ -311,13 +381,11 @@ static void dtmf_tone_start_cb(uint8_t sym, float val) {
 
   if (modem_state == MODEM_IDLE) return; // Ignore spurious callbacks when idle
 
-  if (modem_state != MODEM_SENDING) return; // short-circuit races
+  // The next digit can start before the main loop sees the last one finish
+  if ((modem_state != MODEM_SENDING) && (modem_state != MODEM_DONE)) return; // short-circuit races
 
+  // No need to stop the DAC: the sequencer ends the tone on its own
   modem_state = MODEM_WAITING_STOP;
-
-  // Stop sending digits so we can move on
-  //logline(LEVEL_DEBUG, "Turning off tone now");
-  dac_stop();
 }
 
 
@@ -353,9 +421,9 @@ int main(void) {
   memset(console_rx_buffer, 0, 1024);
   console_setup(&console_line_handler, console_rx_buffer, 8);
   log_forced("TamoDevBoard startup, version " xstr(ARGALI_VERSION) " Compiled " __TIMESTAMP__);
-  parser_setup(eol_command_handle, packet_rx_buf, 1024);
-  parser_register_too_long_cb(&packet_too_long);
-  parser_register_pkt_interrupted_cb(&packet_interrupted);
+  packet_parser_init(&eol_parser, eol_command_handle, packet_rx_buf, 1024);
+  packet_parser_register_too_long_cb(&eol_parser, &packet_too_long);
+  packet_parser_register_pkt_interrupted_cb(&eol_parser, &packet_interrupted);
 
   //
   // End critical init section /////////////////////
@@ -367,7 +435,11 @@ int main(void) {
   button_setup();
 
   // DAC
-  dac_waveform_setup();
+  wave_cache_init(&dac_waves, dac_pool, WAVE_CACHE_N_SYMBOLS*DAC_WAVEFORM_LEN, DAC_WAVEFORM_LEN, 0.25, true);
+  tone_seq_init(&tone_seq, tone_seq_entries, TONE_SEQ_ENTRIES, 2048);
+  dac_tone_seq_setup();
+  dac_start();
+  dac_taken = false;
 
   // ADC
   adc_sample_rate = adc_setup(&adc_config);
@@ -385,7 +457,9 @@ int main(void) {
 
   // And then set up DTMF decoding
   modem_state = MODEM_IDLE;
-  dtmf_init(adc_sample_rate, dtmf_threshold, dtmf_tone_start_cb, dtmf_tone_stop_cb);
+  decimate_init(&adc_decimator, ADC_DECIMATION, ADC_CIC_ORDER, adc_config.sample_width);
+  dtmf_init(adc_sample_rate/ADC_DECIMATION, dtmf_threshold, dtmf_tone_start_cb, dtmf_tone_stop_cb);
+  dtmf_set_calibration(127*decimate_gain(&adc_decimator), 127*decimate_gain(&adc_decimator), true);
 
 
   console_dumps("\n\nSTARTUP\n\n");
@@ -397,23 +471,49 @@ int main(void) {
     // Run this loop at about 10Hz, and poll for inputs.  (Huge antipattern!)
     for (int j = 0; j < 10; j++) {
 
-      for ( ; serbuf_head < serbuf_tail; serbuf_head++) {
-        packet_rx_byte(*serbuf_head);
+      uint8_t *rx_tail = serbuf_tail;
+      if (serbuf_head < rx_tail) {
+        packet_parser_rx_buffer(&eol_parser, serbuf_head, rx_tail - serbuf_head);
+        serbuf_head = rx_tail;
       }
 
       bool user_present = button_poll();
 
-      if ((modem_state == MODEM_RESTART) || (modem_state == MODEM_DONE)) {
-
-        if (modem_state == MODEM_RESTART) {
-          logline(LEVEL_DEBUG, "Reseting pi reciter");
-          tone_stop();
-          pi_reciter_reset();
-        }
+      // The EOL commands may have reconfigured the DAC out from under us
+      if (eol_dac_reclaim()) {
+        dac_taken = true;
+      }
 
-        logline(LEVEL_DEBUG, "Main loop: Advancing digit");
+      if (modem_state == MODEM_RESTART) {
+        logline(LEVEL_DEBUG, "Reseting pi reciter");
+        tone_stop();
+        pi_reciter_reset();
+        modem_heard = 0;
         modem_state = MODEM_WAITING_SEND;
-        tone_start_next_digit();
+      }
+
+      // Don't start over until the stale digits have played out, lest
+      // the decoder hear them against the new ones
+      if ((modem_state == MODEM_WAITING_SEND) &&
+          (dac_taken || (0 == tone_seq_pending(&tone_seq)))) {
+        tone_start();
+      }
+
+      if ((modem_state == MODEM_SENDING) || (modem_state == MODEM_WAITING_STOP) ||
+          (modem_state == MODEM_DONE)) {
+        tone_queue_digits();
+
+        // If the queue ran dry without the decoder hearing it all, start
+        // again from the first digit it missed
+        if (dac_taken || (0 == tone_seq_pending(&tone_seq))) {
+          if (++modem_unheard_ticks > 1) {
+            logline(LEVEL_DEBUG, "Main loop: Digit went unheard, resending");
+            modem_state = MODEM_WAITING_SEND;
+            tone_start();
+          }
+        } else {
+          modem_unheard_ticks = 0;
+        }
       }
 
       if (user_present) {
@@ -433,7 +533,6 @@ int main(void) {
             // Start on button press for now
             modem_state = MODEM_WAITING_SEND;
             logline(LEVEL_DEBUG, "Main loop: Starting modem");
-            tone_start_next_digit();
           } else {
             logline(LEVEL_DEBUG, "Main loop: Modem state: %d", modem_state);
           }
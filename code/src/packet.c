@@ -25,6 +25,10 @@
  * necessarily fully correct.  That said, we have an implementation in
  * C and python, which suffices.
  *
+ * The parser state lives in caller-owned packet_parser_data_t
+ * instances, one per link, so several links can be deframed at once.
+ * The older parser_setup()/packet_rx_byte() calls are kept as
+ * wrappers around a single built-in instance.
  */
 
 /**
@@ -68,25 +72,50 @@
 #ifndef TEST_UNITY
 
 /**
- * \brief Sends a single packet out over serial
+ * \brief Queues a single packet to go out over serial
+ *
+ * \param buf The payload
+ * \param buflen Length of the payload
+ * \param address The packet's address field
+ * \param command The packet's command field
+ * \param prio Which of the console's transmit classes to queue it in
+ *
+ * \returns TX_QUEUE_OKAY, or the reason the packet was dropped
+ *
+ * This frames the packet on the fly straight into the console's
+ * transmit queue, so sending costs about a copy of the packet, and
+ * the console's DMA does the actual sending.  See
+ * console_tx_begin() for what happens when the queue is full.
  */
-void packet_send(const uint8_t *buf, uint16_t buflen, uint8_t address, uint8_t command) {
-  uint8_t pktbuf[1024];
-  uint16_t pktlen;
+tx_queue_status_t packet_send_prio(const uint8_t *buf, uint16_t buflen, uint8_t address, uint8_t command,
+                                   tx_queue_prio_t prio) {
+  static const uint8_t preamble[4] = { '~', '~', '~', '~' };
+  packet_framer_t framer;
 
-  pktlen = packet_frame(pktbuf, (uint8_t*)buf, buflen, address, command);  
+  const uint16_t escaped_len = packet_escaped_len(buf, buflen);
 
-  int i;
-  for (i = 0; i < 4; i++) {
-    console_send_blocking('~');
-  }
+  // Two flags, plus six header and FCS bytes which might each be escaped
+  tx_queue_status_t res = console_tx_begin(prio, escaped_len + 2*sizeof(preamble) + 2 + 2*6);
+  if (TX_QUEUE_OKAY != res) return res;
 
-  for (i = 0; i < pktlen; i++) {
-    console_send_blocking(pktbuf[i]);
-  }
-  for (i = 0; i < 4; i++) {
-    console_send_blocking('~');
-  }
+  console_tx_write(preamble, sizeof(preamble));
+
+  packet_framer_begin(&framer, console_tx_write, address, command, escaped_len);
+  packet_framer_append(&framer, buf, buflen);
+  packet_framer_end(&framer);
+
+  console_tx_write(preamble, sizeof(preamble));
+
+  return console_tx_end();
+}
+
+/**
+ * \brief Queues a single control packet to go out over serial
+ *
+ * This is packet_send_prio() in TX_PRIO_CONTROL.
+ */
+void packet_send(const uint8_t *buf, uint16_t buflen, uint8_t address, uint8_t command) {
+  packet_send_prio(buf, buflen, address, command, TX_PRIO_CONTROL);
 }
 #endif
 
@@ -146,6 +175,317 @@ uint16_t packet_frame(uint8_t *dst, const uint8_t *buf, uint16_t buflen, uint8_t
 }
 
 
+/**
+ * \subsection FCS lookup tables
+ *
+ * The FCS is a reflected CRC16 (polynomial 0x8408), and used to be
+ * computed a bit at a time: eight shift-and-xor steps per byte, on
+ * every byte received and every byte framed.  Instead, we look it up
+ * a byte at a time in a table, with fcs_table[0][n] being the CRC of
+ * the byte n from a zero state.
+ *
+ * For bulk buffers, packet_fcs() can go further and take several
+ * bytes per step ("slicing").  fcs_table[k][n] is the CRC of n
+ * followed by k zero bytes, so the CRC of a run of bytes is the xor of
+ * each byte's entry in the table for its distance from the end.  Only
+ * the first two bytes of each run pick up the running CRC.
+ *
+ * Each table is 512 bytes of flash, so PACKET_FCS_SLICES picks how
+ * many to build in:
+ *
+ * - 0: no tables, bit at a time as before
+ * - 1: byte at a time (512 bytes)
+ * - 4: bulk buffers four bytes at a time (2kB)
+ * - 8: bulk buffers eight bytes at a time (4kB)
+ *
+ * All of these give the same answers as Framer.fcs() in argali_tether.
+ */
+
+#if PACKET_FCS_SLICES != 0 && PACKET_FCS_SLICES != 1 && PACKET_FCS_SLICES != 4 && PACKET_FCS_SLICES != 8
+#error "PACKET_FCS_SLICES must be 0, 1, 4, or 8"
+#endif
+
+#if PACKET_FCS_SLICES > 0
+static const uint16_t fcs_table[PACKET_FCS_SLICES][256] = {
+  {
+    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+    0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+    0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+    0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+    0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+    0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+    0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+    0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+    0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+    0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+    0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+    0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+    0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+    0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+    0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+    0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+    0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+    0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+    0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+    0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+    0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+    0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+    0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+    0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+    0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+    0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+    0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+    0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+  },
+#if PACKET_FCS_SLICES > 1
+  {
+    0x0000, 0x19d8, 0x33b0, 0x2a68, 0x6760, 0x7eb8, 0x54d0, 0x4d08,
+    0xcec0, 0xd718, 0xfd70, 0xe4a8, 0xa9a0, 0xb078, 0x9a10, 0x83c8,
+    0x9591, 0x8c49, 0xa621, 0xbff9, 0xf2f1, 0xeb29, 0xc141, 0xd899,
+    0x5b51, 0x4289, 0x68e1, 0x7139, 0x3c31, 0x25e9, 0x0f81, 0x1659,
+    0x2333, 0x3aeb, 0x1083, 0x095b, 0x4453, 0x5d8b, 0x77e3, 0x6e3b,
+    0xedf3, 0xf42b, 0xde43, 0xc79b, 0x8a93, 0x934b, 0xb923, 0xa0fb,
+    0xb6a2, 0xaf7a, 0x8512, 0x9cca, 0xd1c2, 0xc81a, 0xe272, 0xfbaa,
+    0x7862, 0x61ba, 0x4bd2, 0x520a, 0x1f02, 0x06da, 0x2cb2, 0x356a,
+    0x4666, 0x5fbe, 0x75d6, 0x6c0e, 0x2106, 0x38de, 0x12b6, 0x0b6e,
+    0x88a6, 0x917e, 0xbb16, 0xa2ce, 0xefc6, 0xf61e, 0xdc76, 0xc5ae,
+    0xd3f7, 0xca2f, 0xe047, 0xf99f, 0xb497, 0xad4f, 0x8727, 0x9eff,
+    0x1d37, 0x04ef, 0x2e87, 0x375f, 0x7a57, 0x638f, 0x49e7, 0x503f,
+    0x6555, 0x7c8d, 0x56e5, 0x4f3d, 0x0235, 0x1bed, 0x3185, 0x285d,
+    0xab95, 0xb24d, 0x9825, 0x81fd, 0xccf5, 0xd52d, 0xff45, 0xe69d,
+    0xf0c4, 0xe91c, 0xc374, 0xdaac, 0x97a4, 0x8e7c, 0xa414, 0xbdcc,
+    0x3e04, 0x27dc, 0x0db4, 0x146c, 0x5964, 0x40bc, 0x6ad4, 0x730c,
+    0x8ccc, 0x9514, 0xbf7c, 0xa6a4, 0xebac, 0xf274, 0xd81c, 0xc1c4,
+    0x420c, 0x5bd4, 0x71bc, 0x6864, 0x256c, 0x3cb4, 0x16dc, 0x0f04,
+    0x195d, 0x0085, 0x2aed, 0x3335, 0x7e3d, 0x67e5, 0x4d8d, 0x5455,
+    0xd79d, 0xce45, 0xe42d, 0xfdf5, 0xb0fd, 0xa925, 0x834d, 0x9a95,
+    0xafff, 0xb627, 0x9c4f, 0x8597, 0xc89f, 0xd147, 0xfb2f, 0xe2f7,
+    0x613f, 0x78e7, 0x528f, 0x4b57, 0x065f, 0x1f87, 0x35ef, 0x2c37,
+    0x3a6e, 0x23b6, 0x09de, 0x1006, 0x5d0e, 0x44d6, 0x6ebe, 0x7766,
+    0xf4ae, 0xed76, 0xc71e, 0xdec6, 0x93ce, 0x8a16, 0xa07e, 0xb9a6,
+    0xcaaa, 0xd372, 0xf91a, 0xe0c2, 0xadca, 0xb412, 0x9e7a, 0x87a2,
+    0x046a, 0x1db2, 0x37da, 0x2e02, 0x630a, 0x7ad2, 0x50ba, 0x4962,
+    0x5f3b, 0x46e3, 0x6c8b, 0x7553, 0x385b, 0x2183, 0x0beb, 0x1233,
+    0x91fb, 0x8823, 0xa24b, 0xbb93, 0xf69b, 0xef43, 0xc52b, 0xdcf3,
+    0xe999, 0xf041, 0xda29, 0xc3f1, 0x8ef9, 0x9721, 0xbd49, 0xa491,
+    0x2759, 0x3e81, 0x14e9, 0x0d31, 0x4039, 0x59e1, 0x7389, 0x6a51,
+    0x7c08, 0x65d0, 0x4fb8, 0x5660, 0x1b68, 0x02b0, 0x28d8, 0x3100,
+    0xb2c8, 0xab10, 0x8178, 0x98a0, 0xd5a8, 0xcc70, 0xe618, 0xffc0,
+  },
+  {
+    0x0000, 0x5adc, 0xb5b8, 0xef64, 0x6361, 0x39bd, 0xd6d9, 0x8c05,
+    0xc6c2, 0x9c1e, 0x737a, 0x29a6, 0xa5a3, 0xff7f, 0x101b, 0x4ac7,
+    0x8595, 0xdf49, 0x302d, 0x6af1, 0xe6f4, 0xbc28, 0x534c, 0x0990,
+    0x4357, 0x198b, 0xf6ef, 0xac33, 0x2036, 0x7aea, 0x958e, 0xcf52,
+    0x033b, 0x59e7, 0xb683, 0xec5f, 0x605a, 0x3a86, 0xd5e2, 0x8f3e,
+    0xc5f9, 0x9f25, 0x7041, 0x2a9d, 0xa698, 0xfc44, 0x1320, 0x49fc,
+    0x86ae, 0xdc72, 0x3316, 0x69ca, 0xe5cf, 0xbf13, 0x5077, 0x0aab,
+    0x406c, 0x1ab0, 0xf5d4, 0xaf08, 0x230d, 0x79d1, 0x96b5, 0xcc69,
+    0x0676, 0x5caa, 0xb3ce, 0xe912, 0x6517, 0x3fcb, 0xd0af, 0x8a73,
+    0xc0b4, 0x9a68, 0x750c, 0x2fd0, 0xa3d5, 0xf909, 0x166d, 0x4cb1,
+    0x83e3, 0xd93f, 0x365b, 0x6c87, 0xe082, 0xba5e, 0x553a, 0x0fe6,
+    0x4521, 0x1ffd, 0xf099, 0xaa45, 0x2640, 0x7c9c, 0x93f8, 0xc924,
+    0x054d, 0x5f91, 0xb0f5, 0xea29, 0x662c, 0x3cf0, 0xd394, 0x8948,
+    0xc38f, 0x9953, 0x7637, 0x2ceb, 0xa0ee, 0xfa32, 0x1556, 0x4f8a,
+    0x80d8, 0xda04, 0x3560, 0x6fbc, 0xe3b9, 0xb965, 0x5601, 0x0cdd,
+    0x461a, 0x1cc6, 0xf3a2, 0xa97e, 0x257b, 0x7fa7, 0x90c3, 0xca1f,
+    0x0cec, 0x5630, 0xb954, 0xe388, 0x6f8d, 0x3551, 0xda35, 0x80e9,
+    0xca2e, 0x90f2, 0x7f96, 0x254a, 0xa94f, 0xf393, 0x1cf7, 0x462b,
+    0x8979, 0xd3a5, 0x3cc1, 0x661d, 0xea18, 0xb0c4, 0x5fa0, 0x057c,
+    0x4fbb, 0x1567, 0xfa03, 0xa0df, 0x2cda, 0x7606, 0x9962, 0xc3be,
+    0x0fd7, 0x550b, 0xba6f, 0xe0b3, 0x6cb6, 0x366a, 0xd90e, 0x83d2,
+    0xc915, 0x93c9, 0x7cad, 0x2671, 0xaa74, 0xf0a8, 0x1fcc, 0x4510,
+    0x8a42, 0xd09e, 0x3ffa, 0x6526, 0xe923, 0xb3ff, 0x5c9b, 0x0647,
+    0x4c80, 0x165c, 0xf938, 0xa3e4, 0x2fe1, 0x753d, 0x9a59, 0xc085,
+    0x0a9a, 0x5046, 0xbf22, 0xe5fe, 0x69fb, 0x3327, 0xdc43, 0x869f,
+    0xcc58, 0x9684, 0x79e0, 0x233c, 0xaf39, 0xf5e5, 0x1a81, 0x405d,
+    0x8f0f, 0xd5d3, 0x3ab7, 0x606b, 0xec6e, 0xb6b2, 0x59d6, 0x030a,
+    0x49cd, 0x1311, 0xfc75, 0xa6a9, 0x2aac, 0x7070, 0x9f14, 0xc5c8,
+    0x09a1, 0x537d, 0xbc19, 0xe6c5, 0x6ac0, 0x301c, 0xdf78, 0x85a4,
+    0xcf63, 0x95bf, 0x7adb, 0x2007, 0xac02, 0xf6de, 0x19ba, 0x4366,
+    0x8c34, 0xd6e8, 0x398c, 0x6350, 0xef55, 0xb589, 0x5aed, 0x0031,
+    0x4af6, 0x102a, 0xff4e, 0xa592, 0x2997, 0x734b, 0x9c2f, 0xc6f3,
+  },
+  {
+    0x0000, 0x1cbb, 0x3976, 0x25cd, 0x72ec, 0x6e57, 0x4b9a, 0x5721,
+    0xe5d8, 0xf963, 0xdcae, 0xc015, 0x9734, 0x8b8f, 0xae42, 0xb2f9,
+    0xc3a1, 0xdf1a, 0xfad7, 0xe66c, 0xb14d, 0xadf6, 0x883b, 0x9480,
+    0x2679, 0x3ac2, 0x1f0f, 0x03b4, 0x5495, 0x482e, 0x6de3, 0x7158,
+    0x8f53, 0x93e8, 0xb625, 0xaa9e, 0xfdbf, 0xe104, 0xc4c9, 0xd872,
+    0x6a8b, 0x7630, 0x53fd, 0x4f46, 0x1867, 0x04dc, 0x2111, 0x3daa,
+    0x4cf2, 0x5049, 0x7584, 0x693f, 0x3e1e, 0x22a5, 0x0768, 0x1bd3,
+    0xa92a, 0xb591, 0x905c, 0x8ce7, 0xdbc6, 0xc77d, 0xe2b0, 0xfe0b,
+    0x16b7, 0x0a0c, 0x2fc1, 0x337a, 0x645b, 0x78e0, 0x5d2d, 0x4196,
+    0xf36f, 0xefd4, 0xca19, 0xd6a2, 0x8183, 0x9d38, 0xb8f5, 0xa44e,
+    0xd516, 0xc9ad, 0xec60, 0xf0db, 0xa7fa, 0xbb41, 0x9e8c, 0x8237,
+    0x30ce, 0x2c75, 0x09b8, 0x1503, 0x4222, 0x5e99, 0x7b54, 0x67ef,
+    0x99e4, 0x855f, 0xa092, 0xbc29, 0xeb08, 0xf7b3, 0xd27e, 0xcec5,
+    0x7c3c, 0x6087, 0x454a, 0x59f1, 0x0ed0, 0x126b, 0x37a6, 0x2b1d,
+    0x5a45, 0x46fe, 0x6333, 0x7f88, 0x28a9, 0x3412, 0x11df, 0x0d64,
+    0xbf9d, 0xa326, 0x86eb, 0x9a50, 0xcd71, 0xd1ca, 0xf407, 0xe8bc,
+    0x2d6e, 0x31d5, 0x1418, 0x08a3, 0x5f82, 0x4339, 0x66f4, 0x7a4f,
+    0xc8b6, 0xd40d, 0xf1c0, 0xed7b, 0xba5a, 0xa6e1, 0x832c, 0x9f97,
+    0xeecf, 0xf274, 0xd7b9, 0xcb02, 0x9c23, 0x8098, 0xa555, 0xb9ee,
+    0x0b17, 0x17ac, 0x3261, 0x2eda, 0x79fb, 0x6540, 0x408d, 0x5c36,
+    0xa23d, 0xbe86, 0x9b4b, 0x87f0, 0xd0d1, 0xcc6a, 0xe9a7, 0xf51c,
+    0x47e5, 0x5b5e, 0x7e93, 0x6228, 0x3509, 0x29b2, 0x0c7f, 0x10c4,
+    0x619c, 0x7d27, 0x58ea, 0x4451, 0x1370, 0x0fcb, 0x2a06, 0x36bd,
+    0x8444, 0x98ff, 0xbd32, 0xa189, 0xf6a8, 0xea13, 0xcfde, 0xd365,
+    0x3bd9, 0x2762, 0x02af, 0x1e14, 0x4935, 0x558e, 0x7043, 0x6cf8,
+    0xde01, 0xc2ba, 0xe777, 0xfbcc, 0xaced, 0xb056, 0x959b, 0x8920,
+    0xf878, 0xe4c3, 0xc10e, 0xddb5, 0x8a94, 0x962f, 0xb3e2, 0xaf59,
+    0x1da0, 0x011b, 0x24d6, 0x386d, 0x6f4c, 0x73f7, 0x563a, 0x4a81,
+    0xb48a, 0xa831, 0x8dfc, 0x9147, 0xc666, 0xdadd, 0xff10, 0xe3ab,
+    0x5152, 0x4de9, 0x6824, 0x749f, 0x23be, 0x3f05, 0x1ac8, 0x0673,
+    0x772b, 0x6b90, 0x4e5d, 0x52e6, 0x05c7, 0x197c, 0x3cb1, 0x200a,
+    0x92f3, 0x8e48, 0xab85, 0xb73e, 0xe01f, 0xfca4, 0xd969, 0xc5d2,
+  },
+#endif
+#if PACKET_FCS_SLICES > 4
+  {
+    0x0000, 0x0b44, 0x1688, 0x1dcc, 0x2d10, 0x2654, 0x3b98, 0x30dc,
+    0x5a20, 0x5164, 0x4ca8, 0x47ec, 0x7730, 0x7c74, 0x61b8, 0x6afc,
+    0xb440, 0xbf04, 0xa2c8, 0xa98c, 0x9950, 0x9214, 0x8fd8, 0x849c,
+    0xee60, 0xe524, 0xf8e8, 0xf3ac, 0xc370, 0xc834, 0xd5f8, 0xdebc,
+    0x6091, 0x6bd5, 0x7619, 0x7d5d, 0x4d81, 0x46c5, 0x5b09, 0x504d,
+    0x3ab1, 0x31f5, 0x2c39, 0x277d, 0x17a1, 0x1ce5, 0x0129, 0x0a6d,
+    0xd4d1, 0xdf95, 0xc259, 0xc91d, 0xf9c1, 0xf285, 0xef49, 0xe40d,
+    0x8ef1, 0x85b5, 0x9879, 0x933d, 0xa3e1, 0xa8a5, 0xb569, 0xbe2d,
+    0xc122, 0xca66, 0xd7aa, 0xdcee, 0xec32, 0xe776, 0xfaba, 0xf1fe,
+    0x9b02, 0x9046, 0x8d8a, 0x86ce, 0xb612, 0xbd56, 0xa09a, 0xabde,
+    0x7562, 0x7e26, 0x63ea, 0x68ae, 0x5872, 0x5336, 0x4efa, 0x45be,
+    0x2f42, 0x2406, 0x39ca, 0x328e, 0x0252, 0x0916, 0x14da, 0x1f9e,
+    0xa1b3, 0xaaf7, 0xb73b, 0xbc7f, 0x8ca3, 0x87e7, 0x9a2b, 0x916f,
+    0xfb93, 0xf0d7, 0xed1b, 0xe65f, 0xd683, 0xddc7, 0xc00b, 0xcb4f,
+    0x15f3, 0x1eb7, 0x037b, 0x083f, 0x38e3, 0x33a7, 0x2e6b, 0x252f,
+    0x4fd3, 0x4497, 0x595b, 0x521f, 0x62c3, 0x6987, 0x744b, 0x7f0f,
+    0x8a55, 0x8111, 0x9cdd, 0x9799, 0xa745, 0xac01, 0xb1cd, 0xba89,
+    0xd075, 0xdb31, 0xc6fd, 0xcdb9, 0xfd65, 0xf621, 0xebed, 0xe0a9,
+    0x3e15, 0x3551, 0x289d, 0x23d9, 0x1305, 0x1841, 0x058d, 0x0ec9,
+    0x6435, 0x6f71, 0x72bd, 0x79f9, 0x4925, 0x4261, 0x5fad, 0x54e9,
+    0xeac4, 0xe180, 0xfc4c, 0xf708, 0xc7d4, 0xcc90, 0xd15c, 0xda18,
+    0xb0e4, 0xbba0, 0xa66c, 0xad28, 0x9df4, 0x96b0, 0x8b7c, 0x8038,
+    0x5e84, 0x55c0, 0x480c, 0x4348, 0x7394, 0x78d0, 0x651c, 0x6e58,
+    0x04a4, 0x0fe0, 0x122c, 0x1968, 0x29b4, 0x22f0, 0x3f3c, 0x3478,
+    0x4b77, 0x4033, 0x5dff, 0x56bb, 0x6667, 0x6d23, 0x70ef, 0x7bab,
+    0x1157, 0x1a13, 0x07df, 0x0c9b, 0x3c47, 0x3703, 0x2acf, 0x218b,
+    0xff37, 0xf473, 0xe9bf, 0xe2fb, 0xd227, 0xd963, 0xc4af, 0xcfeb,
+    0xa517, 0xae53, 0xb39f, 0xb8db, 0x8807, 0x8343, 0x9e8f, 0x95cb,
+    0x2be6, 0x20a2, 0x3d6e, 0x362a, 0x06f6, 0x0db2, 0x107e, 0x1b3a,
+    0x71c6, 0x7a82, 0x674e, 0x6c0a, 0x5cd6, 0x5792, 0x4a5e, 0x411a,
+    0x9fa6, 0x94e2, 0x892e, 0x826a, 0xb2b6, 0xb9f2, 0xa43e, 0xaf7a,
+    0xc586, 0xcec2, 0xd30e, 0xd84a, 0xe896, 0xe3d2, 0xfe1e, 0xf55a,
+  },
+  {
+    0x0000, 0x042b, 0x0856, 0x0c7d, 0x10ac, 0x1487, 0x18fa, 0x1cd1,
+    0x2158, 0x2573, 0x290e, 0x2d25, 0x31f4, 0x35df, 0x39a2, 0x3d89,
+    0x42b0, 0x469b, 0x4ae6, 0x4ecd, 0x521c, 0x5637, 0x5a4a, 0x5e61,
+    0x63e8, 0x67c3, 0x6bbe, 0x6f95, 0x7344, 0x776f, 0x7b12, 0x7f39,
+    0x8560, 0x814b, 0x8d36, 0x891d, 0x95cc, 0x91e7, 0x9d9a, 0x99b1,
+    0xa438, 0xa013, 0xac6e, 0xa845, 0xb494, 0xb0bf, 0xbcc2, 0xb8e9,
+    0xc7d0, 0xc3fb, 0xcf86, 0xcbad, 0xd77c, 0xd357, 0xdf2a, 0xdb01,
+    0xe688, 0xe2a3, 0xeede, 0xeaf5, 0xf624, 0xf20f, 0xfe72, 0xfa59,
+    0x02d1, 0x06fa, 0x0a87, 0x0eac, 0x127d, 0x1656, 0x1a2b, 0x1e00,
+    0x2389, 0x27a2, 0x2bdf, 0x2ff4, 0x3325, 0x370e, 0x3b73, 0x3f58,
+    0x4061, 0x444a, 0x4837, 0x4c1c, 0x50cd, 0x54e6, 0x589b, 0x5cb0,
+    0x6139, 0x6512, 0x696f, 0x6d44, 0x7195, 0x75be, 0x79c3, 0x7de8,
+    0x87b1, 0x839a, 0x8fe7, 0x8bcc, 0x971d, 0x9336, 0x9f4b, 0x9b60,
+    0xa6e9, 0xa2c2, 0xaebf, 0xaa94, 0xb645, 0xb26e, 0xbe13, 0xba38,
+    0xc501, 0xc12a, 0xcd57, 0xc97c, 0xd5ad, 0xd186, 0xddfb, 0xd9d0,
+    0xe459, 0xe072, 0xec0f, 0xe824, 0xf4f5, 0xf0de, 0xfca3, 0xf888,
+    0x05a2, 0x0189, 0x0df4, 0x09df, 0x150e, 0x1125, 0x1d58, 0x1973,
+    0x24fa, 0x20d1, 0x2cac, 0x2887, 0x3456, 0x307d, 0x3c00, 0x382b,
+    0x4712, 0x4339, 0x4f44, 0x4b6f, 0x57be, 0x5395, 0x5fe8, 0x5bc3,
+    0x664a, 0x6261, 0x6e1c, 0x6a37, 0x76e6, 0x72cd, 0x7eb0, 0x7a9b,
+    0x80c2, 0x84e9, 0x8894, 0x8cbf, 0x906e, 0x9445, 0x9838, 0x9c13,
+    0xa19a, 0xa5b1, 0xa9cc, 0xade7, 0xb136, 0xb51d, 0xb960, 0xbd4b,
+    0xc272, 0xc659, 0xca24, 0xce0f, 0xd2de, 0xd6f5, 0xda88, 0xdea3,
+    0xe32a, 0xe701, 0xeb7c, 0xef57, 0xf386, 0xf7ad, 0xfbd0, 0xfffb,
+    0x0773, 0x0358, 0x0f25, 0x0b0e, 0x17df, 0x13f4, 0x1f89, 0x1ba2,
+    0x262b, 0x2200, 0x2e7d, 0x2a56, 0x3687, 0x32ac, 0x3ed1, 0x3afa,
+    0x45c3, 0x41e8, 0x4d95, 0x49be, 0x556f, 0x5144, 0x5d39, 0x5912,
+    0x649b, 0x60b0, 0x6ccd, 0x68e6, 0x7437, 0x701c, 0x7c61, 0x784a,
+    0x8213, 0x8638, 0x8a45, 0x8e6e, 0x92bf, 0x9694, 0x9ae9, 0x9ec2,
+    0xa34b, 0xa760, 0xab1d, 0xaf36, 0xb3e7, 0xb7cc, 0xbbb1, 0xbf9a,
+    0xc0a3, 0xc488, 0xc8f5, 0xccde, 0xd00f, 0xd424, 0xd859, 0xdc72,
+    0xe1fb, 0xe5d0, 0xe9ad, 0xed86, 0xf157, 0xf57c, 0xf901, 0xfd2a,
+  },
+  {
+    0x0000, 0x9fd5, 0x37bb, 0xa86e, 0x6f76, 0xf0a3, 0x58cd, 0xc718,
+    0xdeec, 0x4139, 0xe957, 0x7682, 0xb19a, 0x2e4f, 0x8621, 0x19f4,
+    0xb5c9, 0x2a1c, 0x8272, 0x1da7, 0xdabf, 0x456a, 0xed04, 0x72d1,
+    0x6b25, 0xf4f0, 0x5c9e, 0xc34b, 0x0453, 0x9b86, 0x33e8, 0xac3d,
+    0x6383, 0xfc56, 0x5438, 0xcbed, 0x0cf5, 0x9320, 0x3b4e, 0xa49b,
+    0xbd6f, 0x22ba, 0x8ad4, 0x1501, 0xd219, 0x4dcc, 0xe5a2, 0x7a77,
+    0xd64a, 0x499f, 0xe1f1, 0x7e24, 0xb93c, 0x26e9, 0x8e87, 0x1152,
+    0x08a6, 0x9773, 0x3f1d, 0xa0c8, 0x67d0, 0xf805, 0x506b, 0xcfbe,
+    0xc706, 0x58d3, 0xf0bd, 0x6f68, 0xa870, 0x37a5, 0x9fcb, 0x001e,
+    0x19ea, 0x863f, 0x2e51, 0xb184, 0x769c, 0xe949, 0x4127, 0xdef2,
+    0x72cf, 0xed1a, 0x4574, 0xdaa1, 0x1db9, 0x826c, 0x2a02, 0xb5d7,
+    0xac23, 0x33f6, 0x9b98, 0x044d, 0xc355, 0x5c80, 0xf4ee, 0x6b3b,
+    0xa485, 0x3b50, 0x933e, 0x0ceb, 0xcbf3, 0x5426, 0xfc48, 0x639d,
+    0x7a69, 0xe5bc, 0x4dd2, 0xd207, 0x151f, 0x8aca, 0x22a4, 0xbd71,
+    0x114c, 0x8e99, 0x26f7, 0xb922, 0x7e3a, 0xe1ef, 0x4981, 0xd654,
+    0xcfa0, 0x5075, 0xf81b, 0x67ce, 0xa0d6, 0x3f03, 0x976d, 0x08b8,
+    0x861d, 0x19c8, 0xb1a6, 0x2e73, 0xe96b, 0x76be, 0xded0, 0x4105,
+    0x58f1, 0xc724, 0x6f4a, 0xf09f, 0x3787, 0xa852, 0x003c, 0x9fe9,
+    0x33d4, 0xac01, 0x046f, 0x9bba, 0x5ca2, 0xc377, 0x6b19, 0xf4cc,
+    0xed38, 0x72ed, 0xda83, 0x4556, 0x824e, 0x1d9b, 0xb5f5, 0x2a20,
+    0xe59e, 0x7a4b, 0xd225, 0x4df0, 0x8ae8, 0x153d, 0xbd53, 0x2286,
+    0x3b72, 0xa4a7, 0x0cc9, 0x931c, 0x5404, 0xcbd1, 0x63bf, 0xfc6a,
+    0x5057, 0xcf82, 0x67ec, 0xf839, 0x3f21, 0xa0f4, 0x089a, 0x974f,
+    0x8ebb, 0x116e, 0xb900, 0x26d5, 0xe1cd, 0x7e18, 0xd676, 0x49a3,
+    0x411b, 0xdece, 0x76a0, 0xe975, 0x2e6d, 0xb1b8, 0x19d6, 0x8603,
+    0x9ff7, 0x0022, 0xa84c, 0x3799, 0xf081, 0x6f54, 0xc73a, 0x58ef,
+    0xf4d2, 0x6b07, 0xc369, 0x5cbc, 0x9ba4, 0x0471, 0xac1f, 0x33ca,
+    0x2a3e, 0xb5eb, 0x1d85, 0x8250, 0x4548, 0xda9d, 0x72f3, 0xed26,
+    0x2298, 0xbd4d, 0x1523, 0x8af6, 0x4dee, 0xd23b, 0x7a55, 0xe580,
+    0xfc74, 0x63a1, 0xcbcf, 0x541a, 0x9302, 0x0cd7, 0xa4b9, 0x3b6c,
+    0x9751, 0x0884, 0xa0ea, 0x3f3f, 0xf827, 0x67f2, 0xcf9c, 0x5049,
+    0x49bd, 0xd668, 0x7e06, 0xe1d3, 0x26cb, 0xb91e, 0x1170, 0x8ea5,
+  },
+  {
+    0x0000, 0x81bf, 0x0b6f, 0x8ad0, 0x16de, 0x9761, 0x1db1, 0x9c0e,
+    0x2dbc, 0xac03, 0x26d3, 0xa76c, 0x3b62, 0xbadd, 0x300d, 0xb1b2,
+    0x5b78, 0xdac7, 0x5017, 0xd1a8, 0x4da6, 0xcc19, 0x46c9, 0xc776,
+    0x76c4, 0xf77b, 0x7dab, 0xfc14, 0x601a, 0xe1a5, 0x6b75, 0xeaca,
+    0xb6f0, 0x374f, 0xbd9f, 0x3c20, 0xa02e, 0x2191, 0xab41, 0x2afe,
+    0x9b4c, 0x1af3, 0x9023, 0x119c, 0x8d92, 0x0c2d, 0x86fd, 0x0742,
+    0xed88, 0x6c37, 0xe6e7, 0x6758, 0xfb56, 0x7ae9, 0xf039, 0x7186,
+    0xc034, 0x418b, 0xcb5b, 0x4ae4, 0xd6ea, 0x5755, 0xdd85, 0x5c3a,
+    0x65f1, 0xe44e, 0x6e9e, 0xef21, 0x732f, 0xf290, 0x7840, 0xf9ff,
+    0x484d, 0xc9f2, 0x4322, 0xc29d, 0x5e93, 0xdf2c, 0x55fc, 0xd443,
+    0x3e89, 0xbf36, 0x35e6, 0xb459, 0x2857, 0xa9e8, 0x2338, 0xa287,
+    0x1335, 0x928a, 0x185a, 0x99e5, 0x05eb, 0x8454, 0x0e84, 0x8f3b,
+    0xd301, 0x52be, 0xd86e, 0x59d1, 0xc5df, 0x4460, 0xceb0, 0x4f0f,
+    0xfebd, 0x7f02, 0xf5d2, 0x746d, 0xe863, 0x69dc, 0xe30c, 0x62b3,
+    0x8879, 0x09c6, 0x8316, 0x02a9, 0x9ea7, 0x1f18, 0x95c8, 0x1477,
+    0xa5c5, 0x247a, 0xaeaa, 0x2f15, 0xb31b, 0x32a4, 0xb874, 0x39cb,
+    0xcbe2, 0x4a5d, 0xc08d, 0x4132, 0xdd3c, 0x5c83, 0xd653, 0x57ec,
+    0xe65e, 0x67e1, 0xed31, 0x6c8e, 0xf080, 0x713f, 0xfbef, 0x7a50,
+    0x909a, 0x1125, 0x9bf5, 0x1a4a, 0x8644, 0x07fb, 0x8d2b, 0x0c94,
+    0xbd26, 0x3c99, 0xb649, 0x37f6, 0xabf8, 0x2a47, 0xa097, 0x2128,
+    0x7d12, 0xfcad, 0x767d, 0xf7c2, 0x6bcc, 0xea73, 0x60a3, 0xe11c,
+    0x50ae, 0xd111, 0x5bc1, 0xda7e, 0x4670, 0xc7cf, 0x4d1f, 0xcca0,
+    0x266a, 0xa7d5, 0x2d05, 0xacba, 0x30b4, 0xb10b, 0x3bdb, 0xba64,
+    0x0bd6, 0x8a69, 0x00b9, 0x8106, 0x1d08, 0x9cb7, 0x1667, 0x97d8,
+    0xae13, 0x2fac, 0xa57c, 0x24c3, 0xb8cd, 0x3972, 0xb3a2, 0x321d,
+    0x83af, 0x0210, 0x88c0, 0x097f, 0x9571, 0x14ce, 0x9e1e, 0x1fa1,
+    0xf56b, 0x74d4, 0xfe04, 0x7fbb, 0xe3b5, 0x620a, 0xe8da, 0x6965,
+    0xd8d7, 0x5968, 0xd3b8, 0x5207, 0xce09, 0x4fb6, 0xc566, 0x44d9,
+    0x18e3, 0x995c, 0x138c, 0x9233, 0x0e3d, 0x8f82, 0x0552, 0x84ed,
+    0x355f, 0xb4e0, 0x3e30, 0xbf8f, 0x2381, 0xa23e, 0x28ee, 0xa951,
+    0x439b, 0xc224, 0x48f4, 0xc94b, 0x5545, 0xd4fa, 0x5e2a, 0xdf95,
+    0x6e27, 0xef98, 0x6548, 0xe4f7, 0x78f9, 0xf946, 0x7396, 0xf229,
+  },
+#endif
+};
+#endif
+
 /**
  * \brief (INTERNAL) Run one step of the FCS algorithm
  *
@@ -153,12 +493,16 @@ uint16_t packet_frame(uint8_t *dst, const uint8_t *buf, uint16_t buflen, uint8_t
  * \param crc The existing state, before stepping forward
  *
  */
-static uint16_t fcs_step(uint8_t x, uint16_t crc) {
+static inline uint16_t fcs_step(uint8_t x, uint16_t crc) {
+#if PACKET_FCS_SLICES > 0
+  return (crc >> 8) ^ fcs_table[0][(crc ^ x) & 0xFF];
+#else
   for (int j = 0; j < 8; j++) {
     crc=((crc&1)^(x&1))?(crc>>1)^0x8408:crc>>1; // crc calculator
     x >>= 1;
   }
   return crc;
+#endif
 }
 
 
@@ -173,34 +517,65 @@ static uint16_t fcs_step(uint8_t x, uint16_t crc) {
  * last call
  */
 uint16_t packet_fcs(const uint8_t *buf, uint16_t buflen, uint16_t crc) {
-  int i;
+#if PACKET_FCS_SLICES > 1
+  while (buflen >= PACKET_FCS_SLICES) {
+    uint16_t x = crc ^ (buf[0] | (buf[1] << 8));
+
+#if PACKET_FCS_SLICES == 8
+    crc = (fcs_table[7][x & 0xFF] ^ fcs_table[6][x >> 8] ^
+           fcs_table[5][buf[2]] ^ fcs_table[4][buf[3]] ^
+           fcs_table[3][buf[4]] ^ fcs_table[2][buf[5]] ^
+           fcs_table[1][buf[6]] ^ fcs_table[0][buf[7]]);
+#else
+    crc = (fcs_table[3][x & 0xFF] ^ fcs_table[2][x >> 8] ^
+           fcs_table[1][buf[2]] ^ fcs_table[0][buf[3]]);
+#endif
 
-  for (i = 0; i < buflen; i++) {
-    uint8_t x = buf[i];
-    crc = fcs_step(x, crc);
+    buf += PACKET_FCS_SLICES;
+    buflen -= PACKET_FCS_SLICES;
+  }
+#endif
+
+  for (int i = 0; i < buflen; i++) {
+    crc = fcs_step(buf[i], crc);
   }
   return crc;
 }
 
-static packet_parser_data_t parse_state;
+static packet_parser_data_t parse_state; //!< The built-in parser, for the single-instance API
 
 
-static void parser_reset(void) {
-  parse_state.state = IDLE;
-  parse_state.bytes_rem = 0;
-  parse_state.buf_cursor = 0;
-  parse_state.fcs = PACKET_FCS_INITIAL;
-  parse_state.saw_escape = 0;
+static void parser_reset(packet_parser_data_t *p) {
+  p->state = IDLE;
+  p->bytes_rem = 0;
+  p->buf_cursor = 0;
+  p->fcs = PACKET_FCS_INITIAL;
+  p->saw_escape = 0;
 }
 
 
-void parser_setup(parser_callback cb, uint8_t *buf, uint16_t buflen) {
-  parser_reset();
-  parse_state.callback = cb;
-  parse_state.rx_buf = buf;
-  parse_state.rx_buf_len = buflen;
-  parser_register_too_long_cb(NULL);
-  parser_register_pkt_interrupted_cb(NULL);
+/**
+ * \brief Set up a parser instance
+ *
+ * \param p The parser to set up (caller-owned)
+ * \param cb Callback for each completed packet
+ * \param buf Buffer to receive packets into (caller-owned)
+ * \param buflen Length of buf
+ *
+ * Each instance has its own state, buffer, and callbacks, so several
+ * links can be parsed side by side, each feeding its own instance.
+ *
+ * A frame takes its payload length plus PACKET_FRAMING_OVERHEAD-1
+ * bytes of buf; longer ones are dropped through the too-long
+ * callback.
+ */
+void packet_parser_init(packet_parser_data_t *p, parser_callback cb, uint8_t *buf, uint16_t buflen) {
+  parser_reset(p);
+  p->callback = cb;
+  p->rx_buf = buf;
+  p->rx_buf_len = buflen;
+  packet_parser_register_too_long_cb(p, NULL);
+  packet_parser_register_pkt_interrupted_cb(p, NULL);
 }
 
 /**
@@ -214,8 +589,8 @@ void parser_setup(parser_callback cb, uint8_t *buf, uint16_t buflen) {
  * This callback is called with the raw buffer and current buffer
  * position; all other parameters are reserved at this time.
  */
-void parser_register_too_long_cb(parser_callback cb) {
-  parse_state.too_long_callback = cb;
+void packet_parser_register_too_long_cb(packet_parser_data_t *p, parser_callback cb) {
+  p->too_long_callback = cb;
 }
 
 /**
@@ -228,14 +603,16 @@ void parser_register_too_long_cb(parser_callback cb) {
  * This is called with the raw buffer and current buffer position; all
  * other parameters are reserved at this time.
  */
-
-void parser_register_pkt_interrupted_cb(parser_callback cb) {
-  parse_state.pkt_interrupted_callback = cb;
+void packet_parser_register_pkt_interrupted_cb(packet_parser_data_t *p, parser_callback cb) {
+  p->pkt_interrupted_callback = cb;
 }
 
 
-const char *parser_state_name() {
-  switch(parse_state.state) {
+/**
+ * \brief Get a printable name for a parser's current state
+ */
+const char *packet_parser_state_name(const packet_parser_data_t *p) {
+  switch(p->state) {
   case IDLE: return "IDLE";
   case  WAIT_ADDR: return "WAIT_ADDR";
   case  WAIT_CONTROL: return "WAIT_CONTROL";
@@ -250,26 +627,32 @@ const char *parser_state_name() {
   }
 }
 
-void packet_rx_byte(uint8_t c) {
+/**
+ * \brief Feed one received byte to a parser
+ *
+ * \param p The parser
+ * \param c The byte received
+ */
+void packet_parser_rx_byte(packet_parser_data_t *p, uint8_t c) {
   int is_flag = (c == PACKET_FLAG);
   int is_escape = (c == PACKET_ESCAPE);
 
   // All bytes go into the checksum except IDLE flags and the
   // checksums themselves.  This includes all escaping.
-  if ((parse_state.state != IDLE) &&
-      !(!parse_state.saw_escape && is_flag && (parse_state.state == WAIT_ADDR)) &&
-      (parse_state.state != WAIT_CKSUM_HI) &&
-      (parse_state.state != WAIT_CKSUM_LO)) {
-    parse_state.fcs = fcs_step(c, parse_state.fcs);
+  if ((p->state != IDLE) &&
+      !(!p->saw_escape && is_flag && (p->state == WAIT_ADDR)) &&
+      (p->state != WAIT_CKSUM_HI) &&
+      (p->state != WAIT_CKSUM_LO)) {
+    p->fcs = fcs_step(c, p->fcs);
   }
 
-  if (!parse_state.saw_escape) {
+  if (!p->saw_escape) {
     if (is_escape) {
-      parse_state.saw_escape = 1;
+      p->saw_escape = 1;
 
       // These escape bytes do count towards the packet length
-      if (parse_state.state == IN_BODY) {
-        parse_state.bytes_rem--;
+      if (p->state == IN_BODY) {
+        p->bytes_rem--;
       }
 
       return;
@@ -278,7 +661,7 @@ void packet_rx_byte(uint8_t c) {
     // The link can idle by sending flags repeatedly, so we will just
     // quietly drop repeated entries but keep in the WAIT_ADDR state.
 
-    if ((parse_state.state == WAIT_ADDR) && is_flag && !parse_state.saw_escape) {
+    if ((p->state == WAIT_ADDR) && is_flag && !p->saw_escape) {
       return;
     }
 
@@ -286,13 +669,13 @@ void packet_rx_byte(uint8_t c) {
     // All unescaped flags reset to a new frame, except if we're
     // already waiting for a frame start
     if (is_flag
-        && (parse_state.state != IDLE)
-        && (parse_state.state != WAIT_ADDR)) {
-      if (parse_state.pkt_interrupted_callback) {
-        parse_state.pkt_interrupted_callback(parse_state.rx_buf, parse_state.buf_cursor, 0, 0, 0);
+        && (p->state != IDLE)
+        && (p->state != WAIT_ADDR)) {
+      if (p->pkt_interrupted_callback) {
+        p->pkt_interrupted_callback(p->rx_buf, p->buf_cursor, 0, 0, 0);
       }
 
-      parser_reset();
+      parser_reset(p);
       // Fall through so the rest of the logic can do its thing
     }
   }
@@ -302,13 +685,13 @@ void packet_rx_byte(uint8_t c) {
   // All escaping and FCS has been handled above this line
 
   // We can now zero out our escape flag.
-  parse_state.saw_escape = 0;
+  p->saw_escape = 0;
 
   // Handle a couple of common cases quickly
 
 
   // Ignore noise on the line while waiting for a flag
-  if ((parse_state.state == IDLE) && !is_flag) {
+  if ((p->state == IDLE) && !is_flag) {
     return;
   }
 
@@ -316,83 +699,96 @@ void packet_rx_byte(uint8_t c) {
   //////////////////////////////////////////////////
   // All non-data has been handled above this line
 
+  // The length check below should keep us in bounds, but a buffer too
+  // small to even hold the header would still overrun it
+  if (p->buf_cursor >= p->rx_buf_len) {
+    if (p->too_long_callback) {
+      p->too_long_callback(p->rx_buf, p->buf_cursor, 0, 0, 0);
+    }
+    parser_reset(p);
+    return;
+  }
+
   // Copy byte into the buffer
-  parse_state.rx_buf[parse_state.buf_cursor] = c;
-  parse_state.buf_cursor++;
-  parse_state.bytes_rem--;
+  p->rx_buf[p->buf_cursor] = c;
+  p->buf_cursor++;
+  p->bytes_rem--;
 
   ///////////////////////////////////////////////////////
   // All buffer modifications are handled above this line
-  switch(parse_state.state) {
+  switch(p->state) {
   case IDLE:
     if (is_flag) {
-      parse_state.state = WAIT_ADDR;
-      parse_state.rx_buf[0] = '~';
-      parse_state.buf_cursor = 1;
-      parse_state.fcs = PACKET_FCS_INITIAL;
+      p->state = WAIT_ADDR;
+      p->rx_buf[0] = '~';
+      p->buf_cursor = 1;
+      p->fcs = PACKET_FCS_INITIAL;
     }
     break;
 
   case WAIT_ADDR:
-    parse_state.addr = c;
-    parse_state.state = WAIT_CONTROL;
+    p->addr = c;
+    p->state = WAIT_CONTROL;
     break;
 
   case WAIT_CONTROL:
-    parse_state.control = c;
-    parse_state.state = WAIT_LENGTH_HI;
+    p->control = c;
+    p->state = WAIT_LENGTH_HI;
     break;
 
   case WAIT_LENGTH_HI:
-    parse_state.pktlen = c<<8;
-    parse_state.state = WAIT_LENGTH_LO;
+    p->pktlen = c<<8;
+    p->state = WAIT_LENGTH_LO;
     break;
 
   case WAIT_LENGTH_LO:
-    parse_state.pktlen += c;
-
-    parse_state.bytes_rem = parse_state.pktlen;
-
-    // Handle too-long packets
-    if (parse_state.bytes_rem > PACKET_MAX_PAYLOAD_LENGTH) {
-      if (parse_state.too_long_callback) {
-        parse_state.too_long_callback(parse_state.rx_buf,
-                                      parse_state.buf_cursor,
+    p->pktlen += c;
+
+    p->bytes_rem = p->pktlen;
+
+    // Handle too-long packets: everything but the closing flag ends
+    // up in rx_buf, so the frame has to fit in there as well as being
+    // under the protocol's limit
+    if ((p->bytes_rem > PACKET_MAX_PAYLOAD_LENGTH) ||
+        ((uint32_t)p->pktlen + PACKET_FRAMING_OVERHEAD - 1 > p->rx_buf_len)) {
+      if (p->too_long_callback) {
+        p->too_long_callback(p->rx_buf,
+                                      p->buf_cursor,
                                       0, 0, 0);
       }
-      parser_reset();
+      parser_reset(p);
       return;
     }
     // Wonky case here: if there is no body, go straight to checksums
-    parse_state.state = (parse_state.pktlen ? IN_BODY : WAIT_CKSUM_HI);
+    p->state = (p->pktlen ? IN_BODY : WAIT_CKSUM_HI);
     break;
 
   case IN_BODY:
-    if (parse_state.bytes_rem == 0)
-      parse_state.state = WAIT_CKSUM_HI;
+    if (p->bytes_rem == 0)
+      p->state = WAIT_CKSUM_HI;
     break;
 
   case WAIT_CKSUM_HI:
-    parse_state.fcs_expected = c<<8;
-    parse_state.state = WAIT_CKSUM_LO;
+    p->fcs_expected = c<<8;
+    p->state = WAIT_CKSUM_LO;
 
     break;
 
   case WAIT_CKSUM_LO:
-    parse_state.fcs_expected += c;
+    p->fcs_expected += c;
 
-    uint8_t fcs_match = (parse_state.fcs_expected == parse_state.fcs);
+    uint8_t fcs_match = (p->fcs_expected == p->fcs);
 
-    if (parse_state.callback) {
-      parse_state.callback(parse_state.rx_buf+5,
-                           parse_state.buf_cursor - PACKET_FRAMING_OVERHEAD + 1,
-                           parse_state.addr,
-                           parse_state.control,
+    if (p->callback) {
+      p->callback(p->rx_buf+5,
+                           p->buf_cursor - PACKET_FRAMING_OVERHEAD + 1,
+                           p->addr,
+                           p->control,
                            fcs_match);
     }
 
     // Reset parser state
-    parser_reset();
+    parser_reset(p);
     break;
 
   default:
@@ -401,4 +797,273 @@ void packet_rx_byte(uint8_t c) {
 }
 
 
+#define PACKET_ONES 0x01010101UL //!< A one in every byte lane, for the word-at-a-time scan
+#define PACKET_HIGHS 0x80808080UL //!< The top bit of every byte lane
+
+/**
+ * \brief (INTERNAL) Check whether any byte of a word is zero
+ *
+ * This can flag the wrong lane when there is a zero, so it's only
+ * good for yes/no.
+ */
+static inline uint32_t has_zero_byte(uint32_t x) {
+  return (x - PACKET_ONES) & ~x & PACKET_HIGHS;
+}
+
+/**
+ * \brief (INTERNAL) Find the first flag or escape byte in a buffer
+ *
+ * \param buf The bytes to scan
+ * \param buflen How many bytes to scan
+ *
+ * \returns The offset of the first flag or escape, or buflen if there are none
+ *
+ * This checks four bytes at a time, only going byte by byte once it
+ * knows there's something in the word, or for the last few bytes.
+ */
+static uint16_t scan_plain_run(const uint8_t *buf, uint16_t buflen) {
+  uint16_t i = 0;
+
+  for ( ; i + 4 <= buflen; i += 4) {
+    uint32_t w;
+    memcpy(&w, buf + i, 4);  // Unaligned-safe, and a single load on Cortex-M
+
+    if (has_zero_byte(w ^ (PACKET_FLAG * PACKET_ONES)) |
+        has_zero_byte(w ^ (PACKET_ESCAPE * PACKET_ONES))) {
+      break;
+    }
+  }
+
+  for ( ; i < buflen; i++) {
+    if (buf[i] == PACKET_FLAG || buf[i] == PACKET_ESCAPE) break;
+  }
+
+  return i;
+}
+
+/**
+ * \brief Feed a chunk of received bytes to a parser
+ *
+ * \param p The parser
+ * \param buf The bytes received
+ * \param buflen How many there are
+ *
+ * This is equivalent to calling packet_parser_rx_byte() on each byte in
+ * turn, callbacks and all, but much faster through packet bodies.
+ * Inside a body, the run of bytes up to the next flag or escape (or
+ * the end of the body) is found a word at a time, then copied into
+ * the receive buffer and checksummed in bulk.  Everything else (the
+ * headers, escapes, and flags) goes through packet_parser_rx_byte().
+ */
+void packet_parser_rx_buffer(packet_parser_data_t *p, const uint8_t *buf, uint16_t buflen) {
+  while (buflen > 0) {
+    if ((p->state == IN_BODY) && !p->saw_escape && p->bytes_rem) {
+      uint16_t room = p->rx_buf_len - p->buf_cursor;
+      uint16_t limit = (buflen < p->bytes_rem) ? buflen : p->bytes_rem;
+      limit = (limit < room) ? limit : room;
+      uint16_t n = scan_plain_run(buf, limit);
+
+      if (n > 0) {
+        memcpy(p->rx_buf + p->buf_cursor, buf, n);
+        p->buf_cursor += n;
+        p->bytes_rem -= n;
+        p->fcs = packet_fcs(buf, n, p->fcs);
+
+        if (p->bytes_rem == 0)
+          p->state = WAIT_CKSUM_HI;
+
+        buf += n;
+        buflen -= n;
+        continue;
+      }
+    }
+
+    packet_parser_rx_byte(p, *buf);
+    buf++;
+    buflen--;
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Streaming framer
+
+/**
+ * \brief Count how long a payload will be once it's escaped
+ *
+ * \param buf The payload
+ * \param buflen Its length, before escaping
+ *
+ * \returns The escaped length, as packet_framer_begin() wants it
+ */
+uint16_t packet_escaped_len(const uint8_t *buf, uint16_t buflen) {
+  uint16_t len = buflen;
+
+  while (buflen > 0) {
+    uint16_t n = scan_plain_run(buf, buflen);
+    buf += n;
+    buflen -= n;
+
+    if (buflen > 0) {  // Landed on a flag or escape
+      len++;
+      buf++;
+      buflen--;
+    }
+  }
+
+  return len;
+}
+
+/**
+ * \brief (INTERNAL) Emit one byte, escaped if need be
+ *
+ * \param f The framer
+ * \param v The byte to send
+ * \param checksum Whether it (and its escape) go into the FCS
+ */
+static void framer_put(packet_framer_t *f, uint8_t v, bool checksum) {
+  static const uint8_t escape = PACKET_ESCAPE;
+
+  if (v == PACKET_FLAG || v == PACKET_ESCAPE) {
+    f->tx(&escape, 1);
+    if (checksum) f->fcs = fcs_step(escape, f->fcs);
+  }
+
+  f->tx(&v, 1);
+  if (checksum) f->fcs = fcs_step(v, f->fcs);
+}
+
+/**
+ * \brief Start streaming out a packet
+ *
+ * \param f The framer state (caller-owned, usually on the stack)
+ * \param tx Where the framed bytes go
+ * \param address Target address
+ * \param command Command to be used
+ * \param escaped_len Length of the payload after escaping, from
+ * packet_escaped_len()
+ *
+ * packet_frame() needs the whole packet in memory, and a second
+ * buffer to frame it into.  The streaming framer instead escapes and
+ * checksums the payload as it's handed over, in as many pieces as you
+ * like, and passes the framed bytes straight on to tx.  Runs of bytes
+ * that don't need escaping go to tx in one call.
+ *
+ * The header carries the escaped length up front, so that has to be
+ * known before starting.  packet_framer_end() checks that the payload
+ * came out that long.
+ */
+void packet_framer_begin(packet_framer_t *f, packet_tx_cb tx, uint8_t address, uint8_t command,
+                         uint16_t escaped_len) {
+  static const uint8_t flag = PACKET_FLAG;
+
+  f->tx = tx;
+  f->fcs = PACKET_FCS_INITIAL;
+  f->escaped_len = escaped_len;
+  f->body_len = 0;
+
+  f->tx(&flag, 1);
+  framer_put(f, address, true);
+  framer_put(f, command, true);
+  framer_put(f, (escaped_len & 0xFF00) >> 8, true);
+  framer_put(f, (escaped_len & 0xFF), true);
+}
+
+/**
+ * \brief Stream out the next piece of a packet's payload
+ *
+ * \param f The framer, from packet_framer_begin()
+ * \param buf The next piece of the payload
+ * \param buflen Its length
+ */
+void packet_framer_append(packet_framer_t *f, const uint8_t *buf, uint16_t buflen) {
+  while (buflen > 0) {
+    uint16_t n = scan_plain_run(buf, buflen);
+
+    if (n > 0) {
+      f->tx(buf, n);
+      f->fcs = packet_fcs(buf, n, f->fcs);
+      f->body_len += n;
+      buf += n;
+      buflen -= n;
+    }
+
+    if (buflen > 0) {
+      framer_put(f, *buf, true);
+      f->body_len += 2;
+      buf++;
+      buflen--;
+    }
+  }
+}
+
+/**
+ * \brief Finish streaming out a packet
+ *
+ * \param f The framer
+ *
+ * \returns 1 if the payload matched the length given to
+ * packet_framer_begin(), 0 if not (in which case the other end will
+ * reject the packet)
+ */
+uint8_t packet_framer_end(packet_framer_t *f) {
+  static const uint8_t flag = PACKET_FLAG;
+  const uint16_t fcs = f->fcs;
+
+  framer_put(f, (fcs & 0xFF00) >> 8, false);
+  framer_put(f, (fcs & 0xFF), false);
+  f->tx(&flag, 1);
+
+  return (f->body_len == f->escaped_len);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Single-instance API
+//
+// These all work on one built-in parser, for firmware that only has
+// the one link.
+
+/**
+ * \brief Set up the built-in parser, as in packet_parser_init()
+ */
+void parser_setup(parser_callback cb, uint8_t *buf, uint16_t buflen) {
+  packet_parser_init(&parse_state, cb, buf, buflen);
+}
+
+/**
+ * \brief As packet_parser_register_too_long_cb(), on the built-in parser
+ */
+void parser_register_too_long_cb(parser_callback cb) {
+  packet_parser_register_too_long_cb(&parse_state, cb);
+}
+
+/**
+ * \brief As packet_parser_register_pkt_interrupted_cb(), on the built-in parser
+ */
+void parser_register_pkt_interrupted_cb(parser_callback cb) {
+  packet_parser_register_pkt_interrupted_cb(&parse_state, cb);
+}
+
+/**
+ * \brief As packet_parser_state_name(), on the built-in parser
+ */
+const char *parser_state_name(void) {
+  return packet_parser_state_name(&parse_state);
+}
+
+/**
+ * \brief As packet_parser_rx_byte(), on the built-in parser
+ */
+void packet_rx_byte(uint8_t c) {
+  packet_parser_rx_byte(&parse_state, c);
+}
+
+/**
+ * \brief As packet_parser_rx_buffer(), on the built-in parser
+ */
+void packet_rx_buffer(const uint8_t *buf, uint16_t buflen) {
+  packet_parser_rx_buffer(&parse_state, buf, buflen);
+}
+
+
 /** \} */
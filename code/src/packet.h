@@ -11,8 +11,11 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
+#include "tx_queue.h"
+
 #define PACKET_FLAG 0x7E  //!< Flag used to begin packets
 #define PACKET_ESCAPE 0x7D  //!< Escaping character for packets
 
@@ -24,6 +27,10 @@
 
 #define PACKET_FCS_INITIAL 0xFFFF  //!< Default initial state of our FCS checksum
 
+#ifndef PACKET_FCS_SLICES
+#define PACKET_FCS_SLICES 1 //!< FCS lookup tables to build in (0, 1, 4, or 8), see packet.c
+#endif
+
 uint16_t packet_fcs(const uint8_t *, uint16_t, uint16_t);
 uint16_t packet_frame(uint8_t *, const uint8_t *, uint16_t, uint8_t, uint8_t);
 
@@ -54,6 +61,9 @@ typedef   void (*parser_callback)(uint8_t *, uint16_t, uint8_t, uint8_t, uint8_t
 
 /**
  * \brief State used in packet parsing
+ *
+ * These are caller-owned, one per link, and set up by
+ * packet_parser_init().
  */
 typedef struct packet_parser_data {
   enum parser_state state;
@@ -77,10 +87,41 @@ typedef struct packet_parser_data {
 } packet_parser_data_t;
 
 
+void packet_parser_init(packet_parser_data_t *, parser_callback, uint8_t *, uint16_t);
+void packet_parser_register_too_long_cb(packet_parser_data_t *, parser_callback);
+void packet_parser_register_pkt_interrupted_cb(packet_parser_data_t *, parser_callback);
+const char *packet_parser_state_name(const packet_parser_data_t *);
+void packet_parser_rx_byte(packet_parser_data_t *, uint8_t);
+void packet_parser_rx_buffer(packet_parser_data_t *, const uint8_t *, uint16_t);
+
+/**
+ * Where the streaming framer sends its output: a run of framed bytes
+ */
+typedef void (*packet_tx_cb)(const uint8_t *, uint16_t);
+
+/**
+ * \brief State for streaming out one packet
+ *
+ * See packet_framer_begin().
+ */
+typedef struct packet_framer {
+  packet_tx_cb tx; //!< Where the framed bytes go
+  uint16_t fcs; //!< Running FCS
+  uint16_t escaped_len; //!< Payload length promised in the header
+  uint16_t body_len; //!< Escaped payload length sent so far
+} packet_framer_t;
+
+uint16_t packet_escaped_len(const uint8_t *, uint16_t);
+void packet_framer_begin(packet_framer_t *, packet_tx_cb, uint8_t, uint8_t, uint16_t);
+void packet_framer_append(packet_framer_t *, const uint8_t *, uint16_t);
+uint8_t packet_framer_end(packet_framer_t *);
+
 const char *parser_state_name(void);
 void parser_setup(parser_callback, uint8_t *, uint16_t);
 void parser_register_too_long_cb(parser_callback);
 void parser_register_pkt_interrupted_cb(parser_callback);
 void packet_rx_byte(uint8_t);
+void packet_rx_buffer(const uint8_t *, uint16_t);
 void packet_send(const uint8_t *, uint16_t, uint8_t, uint8_t);
+tx_queue_status_t packet_send_prio(const uint8_t *, uint16_t, uint8_t, uint8_t, tx_queue_prio_t);
 /** \} */
@@ -31,6 +31,8 @@
  *
  * When a new digit is needed, call pi_reciter_next_digit().  This
  * will yield the next digit of pi.  It does not advance the cursor.
+ * To send digits ahead of the ones being confirmed, use
+ * pi_reciter_digit(), which ignores the cursor entirely.
  *
  * When a digit is recieved, call pi_reciter_rx_digit() with the
  * received digit.  If it matches, the cursor will be advanced and
@@ -99,6 +101,24 @@ uint8_t pi_reciter_next_digit(void) {
   return PI_DIGITS[digit_cursor];
 }
 
+/**
+ * Get any digit of pi (as ASCII), regardless of the cursor
+ *
+ * \param i Which digit to get, counting from the leading 3
+ *
+ * \return The digit, or '#' if it's beyond the ones we know
+ *
+ * Unlike pi_reciter_next_digit(), this doesn't care about wrong
+ * digits received: it's meant for queueing up digits to send before
+ * the earlier ones have come back.
+ */
+uint8_t pi_reciter_digit(uint16_t i) {
+  if (i >= N_PI_DIGITS)
+    return '#';
+
+  return PI_DIGITS[i];
+}
+
 /**
  * Confirm the current digit of pi (as ASCII)
  *
@@ -24,6 +24,7 @@ typedef enum pi_reciter_rx_state {
 
 void pi_reciter_init(void);
 uint8_t pi_reciter_next_digit(void);
+uint8_t pi_reciter_digit(uint16_t);
 pi_reciter_rx_state_t pi_reciter_rx_digit(uint8_t);
 void pi_reciter_reset(void);
 
@@ -5,7 +5,7 @@
  * \file sin_gen.c
  * \brief A sine wave generator/sampler
  *
- * \defgroup sin_gen Sine wave generator (8 bit only)
+ * \defgroup sin_gen Sine wave generator
  * \addtogroup sin_gen
  * \{
  *
@@ -58,6 +58,20 @@
  * floating point tone frequencies.  The sampling rate will always be
  * an integer due to the design of the microcontroller, but there is
  * no fundamental restriction on the tone you're generating.
+ *
+ * If you need fractional frequencies, or want to generate a tone a
+ * buffer at a time without seams, use the oscillator (NCO) instead:
+ * see sin_gen_nco_init().  It keeps its phase as a 32b fraction of a
+ * turn, and steps it along by a fixed tuning word every sample, so
+ * the only per-sample work is an add, a shift, and a table lookup.
+ *
+ * The DAC is really 12 bits wide, though.  For that, there are 12b
+ * versions of the lookup, the oscillator and the tone mixer
+ * (sin_gen_sin12_bam32(), sin_gen_nco_fill12() and
+ * sin_gen_generate_multi12()), which use a 12b table and interpolate
+ * between its entries.  Their output goes out through dac_setup12().
+ * sin_gen_generate_iq12() makes I/Q pairs for both DAC channels at
+ * once, for dac_setup_dual12().
  */
 
 
@@ -88,6 +102,89 @@ static const uint8_t sin_table[256] = {
   126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 127,
 };
 
+#define SINE_INDEX_SHIFT 22 //!< Shift from a 32b phase to an index into the full wave (4*SINE_TABLE_LENGTH)
+#define SINE_INDEX_ROUND (1UL << (SINE_INDEX_SHIFT-1)) //!< Half an index step, in 32b phase
+
+/**
+ * (Internal) Look up a point on the full wave, folding the quarter
+ * wave table around into the other quadrants
+ *
+ * \param cursor Position in the full wave, only the low 10 bits are used
+ * \param scale A divisor on the amplitude, as in sin_gen_sin()
+ */
+static inline uint8_t sin_gen_lookup(uint16_t cursor, uint8_t scale) {
+  uint8_t i = cursor & (SINE_TABLE_LENGTH-1);
+  if (cursor & SINE_TABLE_LENGTH) i = SINE_TABLE_LENGTH - 1 - i;
+
+  uint8_t v = sin_table[i]/scale;
+  return (cursor & (2*SINE_TABLE_LENGTH)) ? 127 - v : 127 + v;
+}
+
+/**
+ * A quarter wave of sin, in 12b
+ *
+ * This is for the 12b output path, which interpolates between
+ * entries rather than rounding to the nearest one.  Unlike sin_table,
+ * the entries are evenly spaced one full-wave index step apart, with
+ * an extra one at the end (exactly pi/2), so there is always a point
+ * on either side to interpolate between.  The amplitude is 2047, so
+ * SINE12_MIDPOINT plus or minus any entry fits in the DAC's 12 bits.
+ *
+ * See notebooks/sin_table_generation.ipynb for where this came from.
+ */
+static const uint16_t sin_table12[SINE_TABLE_LENGTH+1] = {
+     0,   13,   25,   38,   50,   63,   75,   88,  100,  113,  126,  138,
+   151,  163,  176,  188,  201,  213,  226,  238,  251,  263,  275,  288,
+   300,  313,  325,  338,  350,  362,  375,  387,  399,  412,  424,  436,
+   449,  461,  473,  485,  497,  510,  522,  534,  546,  558,  570,  582,
+   594,  606,  618,  630,  642,  654,  666,  678,  690,  701,  713,  725,
+   737,  748,  760,  772,  783,  795,  807,  818,  830,  841,  852,  864,
+   875,  887,  898,  909,  920,  932,  943,  954,  965,  976,  987,  998,
+  1009, 1020, 1031, 1042, 1052, 1063, 1074, 1085, 1095, 1106, 1116, 1127,
+  1137, 1148, 1158, 1168, 1179, 1189, 1199, 1209, 1219, 1229, 1239, 1249,
+  1259, 1269, 1279, 1289, 1299, 1308, 1318, 1328, 1337, 1347, 1356, 1365,
+  1375, 1384, 1393, 1402, 1411, 1421, 1430, 1439, 1447, 1456, 1465, 1474,
+  1483, 1491, 1500, 1508, 1517, 1525, 1533, 1542, 1550, 1558, 1566, 1574,
+  1582, 1590, 1598, 1606, 1614, 1621, 1629, 1637, 1644, 1652, 1659, 1666,
+  1674, 1681, 1688, 1695, 1702, 1709, 1716, 1723, 1729, 1736, 1743, 1749,
+  1756, 1762, 1769, 1775, 1781, 1787, 1793, 1799, 1805, 1811, 1817, 1823,
+  1828, 1834, 1840, 1845, 1850, 1856, 1861, 1866, 1871, 1876, 1881, 1886,
+  1891, 1896, 1901, 1905, 1910, 1914, 1919, 1923, 1927, 1932, 1936, 1940,
+  1944, 1948, 1951, 1955, 1959, 1962, 1966, 1969, 1973, 1976, 1979, 1983,
+  1986, 1989, 1992, 1994, 1997, 2000, 2003, 2005, 2008, 2010, 2012, 2015,
+  2017, 2019, 2021, 2023, 2025, 2027, 2028, 2030, 2032, 2033, 2035, 2036,
+  2037, 2038, 2039, 2040, 2041, 2042, 2043, 2044, 2045, 2045, 2046, 2046,
+  2046, 2047, 2047, 2047, 2047,
+};
+
+#define SINE12_MIDPOINT 2048 //!< DC level of the 12b output
+#define SINE_QUADRANT (1UL << 30) //!< A quarter turn, in 32b phase
+
+/**
+ * (Internal) Look up a point on the full wave in 12b, interpolating
+ * between table entries
+ *
+ * \param angle Position in the full wave, in 1/2^32 turns
+ * \param scale A divisor on the amplitude, as in sin_gen_sin()
+ */
+static inline uint16_t sin_gen_lookup12(uint32_t angle, uint8_t scale) {
+  // Position within the quadrant, running backwards in the odd ones
+  uint32_t p = angle & (SINE_QUADRANT-1);
+  if (angle & SINE_QUADRANT) p = SINE_QUADRANT - p;
+
+  // Top bits pick the entry, the rest (cut down to 16b) say how far
+  // along we are to the next one.  p == SINE_QUADRANT lands exactly
+  // on the guard entry with no fraction, so i+1 is never past it.
+  uint16_t i = p >> SINE_INDEX_SHIFT;
+  int32_t frac = (p & ((1UL << SINE_INDEX_SHIFT) - 1)) >> (SINE_INDEX_SHIFT - 16);
+
+  int32_t v = sin_table12[i];
+  if (frac) v += ((sin_table12[i+1] - v) * frac + (1 << 15)) >> 16;
+  v /= scale;
+
+  return (angle & (2*SINE_QUADRANT)) ? SINE12_MIDPOINT - v : SINE12_MIDPOINT + v;
+}
+
 /**
  * \brief Prepare a typical sin_gen_request_t
  *
@@ -125,6 +222,60 @@ sin_gen_result_t sin_gen_populate(sin_gen_request_t *req,
   return SIN_GEN_OKAY;
 }
 
+/**
+ * (Internal) Convert radians to a 32b binary angle
+ *
+ * This goes through int64_t so that negative angles wrap around
+ * properly, instead of being truncated towards zero.
+ */
+static uint32_t sin_gen_radians_to_bam32(float theta) {
+  return (uint32_t)(int64_t)(theta * (4294967296.0f / (4*COS_THETA0)));
+}
+
+/**
+ * \brief Get the sin table entry for a 32b binary angle
+ *
+ * \param angle Angle to get sin of, in 1/2^32 turns
+ * \param scale A divisor on the scale of the waveform; use 1 to get full amplitude
+ *
+ * A binary angle is just a fraction of a full turn, so wrapping
+ * around is free, and the quadrant and table index are the top bits.
+ * This is the same thing sin_gen_sin() gives you, rounded to the
+ * nearest table entry, but with no floating point at all.  This
+ * makes it the one to use in per-sample loops.
+ */
+uint8_t sin_gen_sin_bam32(uint32_t angle, uint8_t scale) {
+  return sin_gen_lookup((angle + SINE_INDEX_ROUND) >> SINE_INDEX_SHIFT, scale);
+}
+
+/**
+ * \brief Get the sin table entry for a 16b binary angle
+ *
+ * \param angle Angle to get sin of, in 1/65536 turns
+ * \param scale A divisor on the scale of the waveform; use 1 to get full amplitude
+ *
+ * See sin_gen_sin_bam32().
+ */
+uint8_t sin_gen_sin_bam16(uint16_t angle, uint8_t scale) {
+  return sin_gen_sin_bam32((uint32_t)angle << 16, scale);
+}
+
+/**
+ * \brief Get a 12b sin value for a 32b binary angle
+ *
+ * \param angle Angle to get sin of, in 1/2^32 turns
+ * \param scale A divisor on the scale of the waveform; use 1 to get full amplitude
+ *
+ * This is the 12b version of sin_gen_sin_bam32(), for the DAC's
+ * DHR12R1 register: it's centered on 2048, with an amplitude of 2047.
+ * Rather than rounding to the nearest table entry, it interpolates
+ * between the two on either side, so it's within an LSB of the real
+ * thing everywhere.  That costs a multiply over the 8b version.
+ */
+uint16_t sin_gen_sin12_bam32(uint32_t angle, uint8_t scale) {
+  return sin_gen_lookup12(angle, scale);
+}
+
 /**
  * \brief Get the appropriate entry from the sin table for the given angle
  *
@@ -136,35 +287,16 @@ sin_gen_result_t sin_gen_populate(sin_gen_request_t *req,
  * waves, so you can use the scale parameter to shrink the waveform
  * (but it's still centered on 127).
  *
+ * This is a wrapper around sin_gen_sin_bam32(), which you should use
+ * directly if you're generating lots of samples.
+ *
  * If you wish to add an offset option, please see the commit which
  * first introduced the scale factor above.  The addition of an offset
  * parameter should very closely parallel that one, including fixups
  * to the populate function and the unit tests.
  */
 uint8_t sin_gen_sin(float theta, uint8_t scale) {
-  // cursor_pos = theta * 4*table_length/(2*pi) = theta*table_len/(pi/2)
-  float cursor_pos_f = theta * SINE_TABLE_LENGTH/COS_THETA0;
-  int ipart = cursor_pos_f;
-
-  // Round up if needed: this bites us surprisingly often
-  if (cursor_pos_f - ipart > 0.5) ipart++;
-
-  // We should have to force this into the range [0, UINT16_MAX] here,
-  // as float can go a long way off in either direction.  However,
-  // because we ensured that our table length is a factor of
-  // UINT16_MAX, we can just blindly cast here, and it will only throw
-  // out bits that are equal to 0 modulo our table length.
-
-  // Get down into our table space
-  uint16_t cursor_pos = ipart % (4*SINE_TABLE_LENGTH);
-
-  uint8_t cursor_quadrant = cursor_pos / SINE_TABLE_LENGTH;
-  uint8_t i = cursor_pos % SINE_TABLE_LENGTH;
-  if (cursor_quadrant & 1) i = SINE_TABLE_LENGTH - 1 - i;
-
-  if (cursor_quadrant > 1)
-    return 127-sin_table[i]/scale;
-  return 127+sin_table[i]/scale;
+  return sin_gen_sin_bam32(sin_gen_radians_to_bam32(theta), scale);
 }
 
 /**
@@ -210,8 +342,8 @@ static sin_gen_result_t sin_gen_qualify(sin_gen_request_t *req) {
  */
 static sin_gen_result_t sin_gen_fulfill(sin_gen_request_t *req, uint8_t n_cycles) {
   float samples_per_wave;
-  float theta;
-  float dtheta; // radians per sample to generate our tone
+  uint32_t theta; // 1/2^32 turns
+  uint32_t dtheta; // 1/2^32 turns per sample to generate our tone
 
 
   samples_per_wave = req->f_sample / req->f_tone;
@@ -230,11 +362,11 @@ static sin_gen_result_t sin_gen_fulfill(sin_gen_request_t *req, uint8_t n_cycles
   req->phase_error = COS_THETA0*4 * (1 - (float)req->result_len/samples_per_wave);
 
   // Now actually fill in the table
-  theta = req->theta0;
-  dtheta = 4*COS_THETA0 / samples_per_wave;
+  theta = sin_gen_radians_to_bam32(req->theta0);
+  dtheta = ((1ULL << 32) + (uint32_t)samples_per_wave/2) / (uint32_t)samples_per_wave;
 
   for (int i = 0; i < req->result_len; i++) {
-    req->buf[i] = sin_gen_sin(theta, req->scale);
+    req->buf[i] = sin_gen_sin_bam32(theta, req->scale);
     theta += dtheta;
   }
 
@@ -329,7 +461,7 @@ sin_gen_result_t sin_gen_generate(sin_gen_request_t *req) {
  * Use of this is *STRONGLY DISCOURAGED* unless you know what you are
  * signing up for.  You will almost certainly get nasty artifacts at
  * the end of your buffer unless you have formulated your input buflen
- * to minimize them yourself.
+ * to minimize them yourself: sin_gen_plan_loop() will do that for you.
  */
 sin_gen_result_t sin_gen_generate_fill(sin_gen_request_t *req) {
   // Note that the unit tests assume that this is tied at the hip to
@@ -344,6 +476,427 @@ sin_gen_result_t sin_gen_generate_fill(sin_gen_request_t *req) {
   return fulfill_result;
 }
 
+/**
+ * \brief Compute the tuning word for an oscillator
+ *
+ * \param f_tone The frequency to generate, which needn't be an integer
+ * \param f_sample The sampling rate
+ *
+ * \returns The phase step per sample, in 1/2^32 turns
+ *
+ * The tone actually generated is off by at most f_sample/2^33, which
+ * is well under a millihertz at any DAC rate we use.
+ */
+uint32_t sin_gen_nco_tuning_word(float f_tone, uint32_t f_sample) {
+  // f_tone in Q16 is exact (it's a power of two scaling), and then
+  // the division happens in integer with rounding
+  uint64_t f_q16 = (uint64_t)(f_tone * 65536.0f);
+  return ((f_q16 << 16) + f_sample/2) / f_sample;
+}
+
+/**
+ * \brief Set up an oscillator
+ *
+ * \param nco The oscillator to set up
+ * \param f_tone The frequency to generate, which needn't be an integer
+ * \param f_sample The sampling rate
+ * \param theta0 (radians) The initial phase angle (0 for sin, COS_THETA0 for cos)
+ * \param scale A divisor on the scale of the waveform; use 1 to get full amplitude
+ *
+ * \returns SIN_GEN_INVALID for a NULL oscillator or zero/negative
+ * frequencies, SIN_GEN_UNDERSAMPLED if the tone is at or above
+ * Nyquist, or SIN_GEN_OKAY.
+ */
+sin_gen_result_t sin_gen_nco_init(sin_gen_nco_t *nco, float f_tone, uint32_t f_sample,
+                                  float theta0, uint8_t scale) {
+  if (nco == NULL)
+    return SIN_GEN_INVALID;
+
+  memset(nco, 0, sizeof(sin_gen_nco_t));
+
+  if (scale == 0)
+    return SIN_GEN_INVALID;
+
+  sin_gen_result_t res = sin_gen_nco_set_freq(nco, f_tone, f_sample);
+  if (SIN_GEN_OKAY != res)
+    return res;
+
+  nco->phase = sin_gen_radians_to_bam32(theta0);
+  nco->scale = scale;
+
+  return SIN_GEN_OKAY;
+}
+
+/**
+ * \brief Change an oscillator's frequency, without a phase jump
+ *
+ * \param nco The oscillator to retune
+ * \param f_tone The new frequency
+ * \param f_sample The sampling rate
+ *
+ * \returns As sin_gen_nco_init(); the oscillator is left alone on error.
+ */
+sin_gen_result_t sin_gen_nco_set_freq(sin_gen_nco_t *nco, float f_tone, uint32_t f_sample) {
+  if ((nco == NULL) || !(f_tone > 0) || (f_sample == 0))
+    return SIN_GEN_INVALID;
+
+  if (f_tone >= f_sample/2.0f)
+    return SIN_GEN_UNDERSAMPLED;
+
+  nco->step = sin_gen_nco_tuning_word(f_tone, f_sample);
+  return SIN_GEN_OKAY;
+}
+
+/**
+ * \brief Generate samples from an oscillator
+ *
+ * \param nco The oscillator, set up by sin_gen_nco_init()
+ * \param buf The buffer to fill
+ * \param buflen How many samples to generate
+ *
+ * This picks up exactly where the last call left off, so you can fill
+ * the halves of a double-buffered DMA transfer as they come free,
+ * with no discontinuity between them.
+ */
+void sin_gen_nco_fill(sin_gen_nco_t *nco, uint8_t *buf, uint16_t buflen) {
+  // Keep the phase half an index ahead, so the shift rounds
+  uint32_t phase = nco->phase + SINE_INDEX_ROUND;
+  const uint32_t step = nco->step;
+  const uint8_t scale = nco->scale;
+
+  for (int i = 0; i < buflen; i++) {
+    buf[i] = sin_gen_lookup(phase >> SINE_INDEX_SHIFT, scale);
+    phase += step;
+  }
+
+  nco->phase = phase - SINE_INDEX_ROUND;
+}
+
+/**
+ * \brief Generate 12b samples from an oscillator
+ *
+ * \param nco The oscillator, set up by sin_gen_nco_init()
+ * \param buf The buffer to fill
+ * \param buflen How many samples to generate
+ *
+ * As sin_gen_nco_fill(), but with the output of sin_gen_sin12_bam32().
+ * The two share the phase, so you can switch between them mid-stream.
+ */
+void sin_gen_nco_fill12(sin_gen_nco_t *nco, uint16_t *buf, uint16_t buflen) {
+  uint32_t phase = nco->phase;
+  const uint32_t step = nco->step;
+  const uint8_t scale = nco->scale;
+
+  for (int i = 0; i < buflen; i++) {
+    buf[i] = sin_gen_lookup12(phase, scale);
+    phase += step;
+  }
+
+  nco->phase = phase;
+}
+
+/**
+ * (Internal) Set up the oscillators for sin_gen_generate_multi() and
+ * sin_gen_generate_multi12()
+ *
+ * \param phase[out] Initial phase of each tone
+ * \param step[out] Tuning word for each tone
+ * \param weight[out] Amplitude of each tone, in Q15
+ *
+ * \returns As sin_gen_generate_multi()
+ */
+static sin_gen_result_t sin_gen_multi_setup(uint16_t buflen, uint32_t f_sample,
+                                            const sin_gen_component_t *components, uint8_t n_components,
+                                            uint32_t *phase, uint32_t *step, int32_t *weight) {
+  if ((buflen == 0) || (components == NULL))
+    return SIN_GEN_INVALID;
+
+  if ((n_components == 0) || (n_components > SIN_GEN_MAX_COMPONENTS))
+    return SIN_GEN_INVALID;
+
+  for (int k = 0; k < n_components; k++) {
+    sin_gen_nco_t nco;
+    sin_gen_result_t res = sin_gen_nco_init(&nco, components[k].f_tone, f_sample,
+                                            components[k].theta0, 1);
+    if (SIN_GEN_OKAY != res)
+      return res;
+
+    if (!(components[k].amplitude >= 0) || components[k].amplitude > 1)
+      return SIN_GEN_INVALID;
+
+    phase[k] = nco.phase;
+    step[k] = nco.step;
+    weight[k] = components[k].amplitude * 32768.0f;
+  }
+
+  return SIN_GEN_OKAY;
+}
+
+/**
+ * \brief Fill a buffer with the sum of several tones, in one pass
+ *
+ * \param buf The buffer to fill
+ * \param buflen How many samples to generate
+ * \param f_sample The sampling rate
+ * \param components The tones to mix
+ * \param n_components How many tones there are (1 to SIN_GEN_MAX_COMPONENTS)
+ *
+ * \returns SIN_GEN_INVALID for NULL or empty buffers, a bad number of
+ * components, or a tone sin_gen_nco_init() wouldn't take;
+ * SIN_GEN_UNDERSAMPLED if any tone is at or above Nyquist; or
+ * SIN_GEN_OKAY.  Nothing is written on error.
+ *
+ * This is for things like DTMF, where you want a mix of tones out of
+ * the DAC.  Each tone gets its own oscillator, and their weighted sum
+ * goes straight into buf, so there's no need for a working buffer per
+ * tone.  The output is centered on 127 as usual.  If the amplitudes
+ * add up to more than 1, the peaks will be clipped.
+ *
+ * Like sin_gen_generate_fill(), this fills the whole buffer
+ * regardless of how well the tones wrap around at the end: use
+ * sin_gen_plan_loop() to pick buflen if you're going to loop it.
+ */
+sin_gen_result_t sin_gen_generate_multi(uint8_t *buf, uint16_t buflen, uint32_t f_sample,
+                                        const sin_gen_component_t *components, uint8_t n_components) {
+  uint32_t phase[SIN_GEN_MAX_COMPONENTS];
+  uint32_t step[SIN_GEN_MAX_COMPONENTS];
+  int32_t weight[SIN_GEN_MAX_COMPONENTS]; // Q15
+
+  if (buf == NULL)
+    return SIN_GEN_INVALID;
+
+  sin_gen_result_t res = sin_gen_multi_setup(buflen, f_sample, components, n_components,
+                                             phase, step, weight);
+  if (SIN_GEN_OKAY != res)
+    return res;
+
+  // Keep the phases half an index ahead, so the shift rounds
+  for (int k = 0; k < n_components; k++)
+    phase[k] += SINE_INDEX_ROUND;
+
+  for (int i = 0; i < buflen; i++) {
+    int32_t acc = 0;
+
+    for (int k = 0; k < n_components; k++) {
+      acc += weight[k] * (sin_gen_lookup(phase[k] >> SINE_INDEX_SHIFT, 1) - 127);
+      phase[k] += step[k];
+    }
+
+    acc = 127 + ((acc + (1 << 14)) >> 15);
+    buf[i] = (acc < 0 ? 0 : (acc > 254 ? 254 : acc));
+  }
+
+  return SIN_GEN_OKAY;
+}
+
+/**
+ * (Internal) Mix one 12b sample from a set of oscillators
+ *
+ * \param offset Extra phase to add to every tone, in 1/2^32 turns
+ */
+static inline uint16_t sin_gen_mix12(const uint32_t *phase, const int32_t *weight,
+                                     uint8_t n_components, uint32_t offset) {
+  int32_t acc = 0;
+
+  for (int k = 0; k < n_components; k++)
+    acc += weight[k] * (sin_gen_lookup12(phase[k] + offset, 1) - SINE12_MIDPOINT);
+
+  acc = SINE12_MIDPOINT + ((acc + (1 << 14)) >> 15);
+  return (acc < 0 ? 0 : (acc > 4095 ? 4095 : acc));
+}
+
+/**
+ * \brief Fill a buffer with the sum of several tones, in 12b
+ *
+ * \param buf The buffer to fill
+ * \param buflen How many samples to generate
+ * \param f_sample The sampling rate
+ * \param components The tones to mix
+ * \param n_components How many tones there are (1 to SIN_GEN_MAX_COMPONENTS)
+ *
+ * \returns As sin_gen_generate_multi()
+ *
+ * The 12b version of sin_gen_generate_multi(), for dac_setup12().
+ * The output is centered on 2048, and clipped to 0..4095.
+ */
+sin_gen_result_t sin_gen_generate_multi12(uint16_t *buf, uint16_t buflen, uint32_t f_sample,
+                                          const sin_gen_component_t *components, uint8_t n_components) {
+  uint32_t phase[SIN_GEN_MAX_COMPONENTS];
+  uint32_t step[SIN_GEN_MAX_COMPONENTS];
+  int32_t weight[SIN_GEN_MAX_COMPONENTS]; // Q15
+
+  if (buf == NULL)
+    return SIN_GEN_INVALID;
+
+  sin_gen_result_t res = sin_gen_multi_setup(buflen, f_sample, components, n_components,
+                                             phase, step, weight);
+  if (SIN_GEN_OKAY != res)
+    return res;
+
+  for (int i = 0; i < buflen; i++) {
+    buf[i] = sin_gen_mix12(phase, weight, n_components, 0);
+
+    for (int k = 0; k < n_components; k++)
+      phase[k] += step[k];
+  }
+
+  return SIN_GEN_OKAY;
+}
+
+/**
+ * \brief Fill a buffer with a mix of tones and its quadrature, in 12b
+ * sample pairs
+ *
+ * \param buf The buffer to fill, one packed pair per sample
+ * \param buflen How many sample pairs to generate
+ * \param f_sample The sampling rate
+ * \param components The tones to mix
+ * \param n_components How many tones there are (1 to SIN_GEN_MAX_COMPONENTS)
+ *
+ * \returns As sin_gen_generate_multi()
+ *
+ * This is for dac_setup_dual12(): the low halfword of each entry is
+ * the mix as sin_gen_generate_multi12() would make it (I), and the
+ * high halfword is the same mix with every tone a quarter turn ahead
+ * (Q), just as if you'd added COS_THETA0 to each theta0.  The two
+ * channels share their oscillators, so there's no float work per
+ * channel, and they stay exactly in quadrature.
+ */
+sin_gen_result_t sin_gen_generate_iq12(uint32_t *buf, uint16_t buflen, uint32_t f_sample,
+                                       const sin_gen_component_t *components, uint8_t n_components) {
+  uint32_t phase[SIN_GEN_MAX_COMPONENTS];
+  uint32_t step[SIN_GEN_MAX_COMPONENTS];
+  int32_t weight[SIN_GEN_MAX_COMPONENTS]; // Q15
+
+  if (buf == NULL)
+    return SIN_GEN_INVALID;
+
+  sin_gen_result_t res = sin_gen_multi_setup(buflen, f_sample, components, n_components,
+                                             phase, step, weight);
+  if (SIN_GEN_OKAY != res)
+    return res;
+
+  for (int i = 0; i < buflen; i++) {
+    uint32_t i_sample = sin_gen_mix12(phase, weight, n_components, 0);
+    uint32_t q_sample = sin_gen_mix12(phase, weight, n_components, SINE_QUADRANT);
+    buf[i] = i_sample | (q_sample << 16); // DHR12RD layout
+
+    for (int k = 0; k < n_components; k++)
+      phase[k] += step[k];
+  }
+
+  return SIN_GEN_OKAY;
+}
+
+/**
+ * (Internal) Total wraparound error of a set of tones after len samples
+ *
+ * \returns The sum over the tones of how far (in 1/2^32 turns) each
+ * one's phase is from a whole number of cycles
+ */
+static uint64_t sin_gen_loop_error(const uint32_t *steps, uint8_t n_tones, uint16_t len) {
+  uint64_t err = 0;
+
+  for (int k = 0; k < n_tones; k++) {
+    // Same arithmetic as the oscillators use, so this is the exact
+    // phase jump they'd make going from buf[len-1] back to buf[0].
+    int32_t wrap = (int32_t)(steps[k] * len);
+    err += (wrap < 0 ? -(int64_t)wrap : wrap);
+  }
+
+  return err;
+}
+
+/**
+ * \brief Find the best buffer length to loop a set of tones in
+ *
+ * \param f_tones The frequencies that will go into the buffer
+ * \param n_tones How many there are (1 to SIN_GEN_MAX_COMPONENTS)
+ * \param f_sample The sampling rate
+ * \param max_len The longest buffer you can spare
+ * \param len[out] The length to use
+ * \param phase_error[out] (radians) The combined phase jump at the
+ * wraparound, summed over the tones.  May be NULL.
+ *
+ * \returns SIN_GEN_INVALID for NULL pointers, zero lengths, or a bad
+ * number of tones; SIN_GEN_UNDERSAMPLED if any tone is at or above
+ * Nyquist; SIN_GEN_TOO_SHORT if max_len can't hold a full wave of the
+ * lowest tone (len is set to max_len anyway, as sin_gen_generate()
+ * does); or SIN_GEN_OKAY.
+ *
+ * A buffer that's being DMA'd out in circular mode only sounds clean
+ * if every tone in it goes through a whole number of cycles, which
+ * with arbitrary tones and sample rates generally isn't possible.
+ * This finds the length up to max_len where the tones come closest,
+ * and of the lengths that are about that close, the shortest one.  It
+ * never goes below one full wave of the lowest tone, though: a short
+ * enough buffer always wraps "cleanly", but it isn't a tone any more.
+ * That's the least RAM, and the least time spent filling it.
+ *
+ * "About that close" means within SIN_GEN_LOOP_TOLERANCE of the best:
+ * anything finer than that is below the resolution of the sine table.
+ *
+ * The search is all integer math on the same tuning words that
+ * sin_gen_nco_fill() and sin_gen_generate_multi() use, so the error
+ * reported is exactly what those will produce at this length.  It
+ * costs max_len*n_tones multiplies, which is cheap enough to do
+ * whenever the sample rate changes, but not in an interrupt.
+ */
+sin_gen_result_t sin_gen_plan_loop(const float *f_tones, uint8_t n_tones, uint32_t f_sample,
+                                   uint16_t max_len, uint16_t *len, float *phase_error) {
+  uint32_t steps[SIN_GEN_MAX_COMPONENTS];
+  uint32_t min_step = UINT32_MAX;
+  uint64_t best_err = UINT64_MAX;
+  uint64_t min_len;
+
+  if ((f_tones == NULL) || (len == NULL) || (max_len == 0))
+    return SIN_GEN_INVALID;
+
+  if ((n_tones == 0) || (n_tones > SIN_GEN_MAX_COMPONENTS))
+    return SIN_GEN_INVALID;
+
+  for (int k = 0; k < n_tones; k++) {
+    sin_gen_nco_t nco;
+    sin_gen_result_t res = sin_gen_nco_set_freq(&nco, f_tones[k], f_sample);
+    if (SIN_GEN_OKAY != res)
+      return res;
+
+    steps[k] = nco.step;
+    if (nco.step < min_step)
+      min_step = nco.step;
+  }
+
+  // Anything shorter than a full wave of the lowest tone isn't that
+  // tone any more, no matter how neatly it wraps.
+  min_len = ((1ULL << 32) + min_step - 1) / min_step;
+  if (min_len > max_len) {
+    *len = max_len;
+    if (phase_error)
+      *phase_error = sin_gen_loop_error(steps, n_tones, max_len) * (4*COS_THETA0 / 4294967296.0);
+    return SIN_GEN_TOO_SHORT;
+  }
+
+  // First find how good it can get...
+  for (uint32_t n = min_len; n <= max_len; n++) {
+    uint64_t err = sin_gen_loop_error(steps, n_tones, n);
+    if (err < best_err)
+      best_err = err;
+  }
+
+  // ...then take the first length that's about that good
+  for (uint32_t n = min_len; n <= max_len; n++) {
+    uint64_t err = sin_gen_loop_error(steps, n_tones, n);
+    if (err <= best_err + SIN_GEN_LOOP_TOLERANCE) {
+      *len = n;
+      if (phase_error)
+        *phase_error = err * (4*COS_THETA0 / 4294967296.0);
+      break;
+    }
+  }
+
+  return SIN_GEN_OKAY;
+}
+
 /**
  * \brief Get a human readable version of a sin_gen_result_t
  *
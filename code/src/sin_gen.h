@@ -46,10 +46,49 @@ typedef struct sin_gen_request {
   float phase_error; //!< OUTPUT: (radians) How many radians of error are dropped at the result_len wraparound
 } sin_gen_request_t;
 
+/**
+ * \brief A phase-accumulator oscillator (NCO)
+ *
+ * Set one up with sin_gen_nco_init(), then pull samples out of it
+ * with sin_gen_nco_fill().  The phase carries over between calls, so
+ * it can be called a buffer at a time without any seams.
+ */
+typedef struct sin_gen_nco {
+  uint32_t phase; //!< Current phase, in 1/2^32 turns
+  uint32_t step; //!< Tuning word: phase advance per sample, in 1/2^32 turns
+  uint8_t scale; //!< Scaling factor to shrink the amplitude by (see sin_gen_sin())
+} sin_gen_nco_t;
+
+#define SIN_GEN_MAX_COMPONENTS 8 //!< Most tones sin_gen_generate_multi() can mix at once
+#define SIN_GEN_LOOP_TOLERANCE (1UL << 22) //!< Loop errors this close (in 1/2^32 turns) count as a tie in sin_gen_plan_loop()
+
+/**
+ * \brief One tone to mix in with sin_gen_generate_multi()
+ */
+typedef struct sin_gen_component {
+  float f_tone; //!< The frequency to generate, which needn't be an integer
+  float amplitude; //!< Peak amplitude, as a fraction of full scale
+  float theta0; //!< (radians) The initial phase angle (0 for sin, COS_THETA0 for cos)
+} sin_gen_component_t;
+
 
 uint8_t sin_gen_sin(float, uint8_t);
+uint8_t sin_gen_sin_bam16(uint16_t, uint8_t);
+uint8_t sin_gen_sin_bam32(uint32_t, uint8_t);
+uint16_t sin_gen_sin12_bam32(uint32_t, uint8_t);
 sin_gen_result_t sin_gen_populate(sin_gen_request_t *, uint8_t *, uint16_t, uint32_t, uint32_t);
 sin_gen_result_t sin_gen_generate(sin_gen_request_t *);
 sin_gen_result_t sin_gen_generate_fill(sin_gen_request_t *);
 const char* sin_gen_result_name(sin_gen_result_t);
+
+uint32_t sin_gen_nco_tuning_word(float, uint32_t);
+sin_gen_result_t sin_gen_nco_init(sin_gen_nco_t *, float, uint32_t, float, uint8_t);
+sin_gen_result_t sin_gen_nco_set_freq(sin_gen_nco_t *, float, uint32_t);
+void sin_gen_nco_fill(sin_gen_nco_t *, uint8_t *, uint16_t);
+void sin_gen_nco_fill12(sin_gen_nco_t *, uint16_t *, uint16_t);
+
+sin_gen_result_t sin_gen_generate_multi(uint8_t *, uint16_t, uint32_t, const sin_gen_component_t *, uint8_t);
+sin_gen_result_t sin_gen_generate_multi12(uint16_t *, uint16_t, uint32_t, const sin_gen_component_t *, uint8_t);
+sin_gen_result_t sin_gen_generate_iq12(uint32_t *, uint16_t, uint32_t, const sin_gen_component_t *, uint8_t);
+sin_gen_result_t sin_gen_plan_loop(const float *, uint8_t, uint32_t, uint16_t, uint16_t *, float *);
 /** \} */ // End doxygen group
@@ -103,6 +103,9 @@
 #include "logging.h"
 #include "dtmf.h"
 
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/dwt.h>
+
 //////////////////////////////////////////////////////////////////////
 // Debug Macros
 
@@ -111,10 +114,56 @@
 // State variables
 
 static adc_config_t saved_adc_config;
+static volatile adc_cb_stats_t adc_cb_stats; //!< Timing of the buffer callback, see adc_get_cb_stats()
 
 //////////////////////////////////////////////////////////////////////
 // Implementation code
 
+/**
+ * \brief (Internal) Record how long a buffer callback took
+ *
+ * This is only called from the DMA ISR.
+ */
+static void adc_record_cb_cycles(uint32_t cycles) {
+  if (cycles < adc_cb_stats.min_cycles) adc_cb_stats.min_cycles = cycles;
+  if (cycles > adc_cb_stats.max_cycles) adc_cb_stats.max_cycles = cycles;
+  adc_cb_stats.total_cycles += cycles;
+  adc_cb_stats.count++;
+}
+
+/**
+ * \brief Get the timing statistics for the buffer callback
+ *
+ * \param stats[out] Where to put the statistics
+ *
+ * Every call into the buffer callback from the DMA ISR is timed with
+ * the DWT cycle counter, so you can see what the decoding code is
+ * costing in interrupt context.  Divide by rcc_ahb_frequency to get
+ * seconds.  The statistics are reset by adc_setup() and
+ * adc_reset_cb_stats().  If nothing has been timed yet, count is 0
+ * and min_cycles is UINT32_MAX.
+ */
+void adc_get_cb_stats(adc_cb_stats_t *stats) {
+  CM_ATOMIC_BLOCK() {
+    stats->count = adc_cb_stats.count;
+    stats->min_cycles = adc_cb_stats.min_cycles;
+    stats->max_cycles = adc_cb_stats.max_cycles;
+    stats->total_cycles = adc_cb_stats.total_cycles;
+  }
+}
+
+/**
+ * \brief Clear the timing statistics for the buffer callback
+ */
+void adc_reset_cb_stats(void) {
+  CM_ATOMIC_BLOCK() {
+    adc_cb_stats.count = 0;
+    adc_cb_stats.min_cycles = UINT32_MAX;
+    adc_cb_stats.max_cycles = 0;
+    adc_cb_stats.total_cycles = 0;
+  }
+}
+
 /**
  * \brief Starts up the clocks needed for ADC
  */
@@ -341,6 +390,10 @@ float adc_setup(adc_config_t *adc_config) {
   // sideways.
   adc_enable_overrun_interrupt(ADC1);
 
+  // Time every buffer callback from here on
+  dwt_enable_cycle_counter();
+  adc_reset_cb_stats();
+
   return adc_get_sample_rate();
 }
 
@@ -421,7 +474,11 @@ void dma2_stream0_isr(void) {
       }
     }
 
-    if (saved_adc_config.cb) saved_adc_config.cb(bufpos, buflen);
+    if (saved_adc_config.cb) {
+      uint32_t t0 = dwt_read_cycle_counter();
+      saved_adc_config.cb(bufpos, buflen);
+      adc_record_cb_cycles(dwt_read_cycle_counter() - t0);
+    }
   }
 }
 
@@ -99,16 +99,33 @@ typedef struct adc_config {
   adc_buffer_cb cb; //!< Callback to call when buffers get filled
 } adc_config_t;
 
+/**
+ * How long the buffer callback has been taking, in CPU cycles
+ *
+ * See adc_get_cb_stats().
+ */
+typedef struct adc_cb_stats {
+  uint32_t count; //!< Number of callbacks timed
+  uint32_t min_cycles; //!< Fewest cycles spent in a single callback
+  uint32_t max_cycles; //!< Most cycles spent in a single callback
+  uint64_t total_cycles; //!< Cycles spent in all the callbacks together
+} adc_cb_stats_t;
+
 float adc_setup(adc_config_t *);
 uint32_t adc_stop(void);
 void adc_start(void);
 
+void adc_get_cb_stats(adc_cb_stats_t *);
+void adc_reset_cb_stats(void);
+
 float adc_get_sample_rate(void);
 float adc_get_interchannel_time(void);
 
 
 #define ADC_PRESCALER_8KHZ 104 //!< The prescaler needed to get 8kHz
 #define ADC_PERIOD_8KHZ 49 //!< The period needed to get 8kHz
+#define ADC_PRESCALER_48KHZ 34 //!< The prescaler needed to get 48kHz, for decimation
+#define ADC_PERIOD_48KHZ 24 //!< The period needed to get 48kHz, for decimation
 
 
 #endif
@@ -3,6 +3,9 @@
 #include "console.h"
 #include "dma.h"
 
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/scb.h>
+
 /**
  * \file console.c
  * \brief Serial Console driver implementation (Nucleo F413ZH)
@@ -23,6 +26,18 @@
 
 static console_state_t console_state;
 
+#define CONSOLE_TX_CONTROL_LEN 2560 //!< Ring size for control replies
+#define CONSOLE_TX_DATA_LEN 4608 //!< Ring size for bulk data
+#define CONSOLE_TX_LOG_LEN 2560 //!< Ring size for log lines
+
+static uint8_t console_tx_control_buf[CONSOLE_TX_CONTROL_LEN]; //!< Ring for TX_PRIO_CONTROL
+static uint8_t console_tx_data_buf[CONSOLE_TX_DATA_LEN]; //!< Ring for TX_PRIO_DATA
+static uint8_t console_tx_log_buf[CONSOLE_TX_LOG_LEN]; //!< Ring for TX_PRIO_LOG
+
+static tx_queue_t console_txq; //!< Frames waiting to go out the console
+static volatile bool console_tx_busy; //!< Is the TX DMA stream running?
+static uint32_t console_tx_old_mask; //!< Interrupt mask to restore in console_tx_end()
+
 #define DUMPBUFLEN 512 //!< Size of the buffer for the dump console
 static uint8_t dumpbuf[DUMPBUFLEN]; //!< Buffer for the dump console
 
@@ -237,6 +252,14 @@ void console_setup(console_cb cb, char *buf, uint32_t buflen) {
   usart_enable_rx_dma(CONSOLE_USART);
   dma_setup(&settings);
 
+  // TX goes through a DMA stream too, fed from console_txq
+  tx_queue_init(&console_txq);
+  tx_queue_set_ring(&console_txq, TX_PRIO_CONTROL, console_tx_control_buf, CONSOLE_TX_CONTROL_LEN);
+  tx_queue_set_ring(&console_txq, TX_PRIO_DATA, console_tx_data_buf, CONSOLE_TX_DATA_LEN);
+  tx_queue_set_ring(&console_txq, TX_PRIO_LOG, console_tx_log_buf, CONSOLE_TX_LOG_LEN);
+  console_tx_busy = false;
+  usart_enable_tx_dma(CONSOLE_USART);
+
   // 5. Select the desired baud rate using the baud rate register
   // USART_BRR
   usart_set_baudrate(CONSOLE_USART, CONSOLE_BAUD);
@@ -260,9 +283,168 @@ void console_send_blocking(const char c)
 }
 
 
+//////////////////////////////////////////////////////////////////////
+// Queued transmit
+//
+// Whole frames get queued up in console_txq, one ring per priority
+// class, and DMA1 Stream3 (USART3_TX, channel 4) sends them out a
+// contiguous chunk at a time.  Each chunk's transfer-complete
+// interrupt starts the next one.
+
+/**
+ * \brief (INTERNAL) Start the next chunk out, if the stream is idle
+ */
+static void console_tx_kick(void) {
+  const uint8_t *chunk;
+
+  if (console_tx_busy) return;
+
+  uint16_t n = tx_queue_next_chunk(&console_txq, &chunk);
+  if (0 == n) return;
+
+  dma_settings_t settings = {
+                             .dma = DMA1,
+                             .stream = DMA_STREAM3,
+                             .channel = DMA_SxCR_CHSEL_4,
+                             .priority = DMA_SxCR_PL_MEDIUM,
+
+                             .direction = DMA_SxCR_DIR_MEM_TO_PERIPHERAL,
+                             .paddr = (uint32_t)&(USART_DR(CONSOLE_USART)),
+                             .peripheral_size = DMA_SxCR_PSIZE_8BIT,
+                             .buf = (uint32_t) chunk,
+                             .buflen = n,
+                             .mem_size = DMA_SxCR_MSIZE_8BIT,
+
+                             .circular_mode = 0,
+                             .double_buffer = 0,
+
+                             .transfer_complete_interrupt = 1,
+                             .enable_irq = 1,
+                             .irqn = NVIC_DMA1_STREAM3_IRQ,
+
+                             .enable_stream = 1,
+  };
+
+  console_tx_busy = true;
+  dma_setup(&settings);
+}
+
+/**
+ * \brief (INTERNAL) Retire a finished chunk and start the next
+ *
+ * This is the body of the TX DMA ISR.
+ */
+static void console_tx_service(void) {
+  if (!dma_get_interrupt_flag(DMA1, DMA_STREAM3, DMA_TCIF)) return;
+  dma_clear_interrupt_flags(DMA1, DMA_STREAM3, DMA_TCIF);
+
+  console_tx_busy = false;
+  tx_queue_chunk_done(&console_txq);
+  console_tx_kick();
+}
+
+/**
+ * \brief Start queueing a frame to send out the console
+ *
+ * \param prio Which priority class it goes in
+ * \param max_len The longest the frame could be
+ *
+ * \returns TX_QUEUE_OKAY if the frame is open, otherwise the frame
+ * was dropped and there's no need to call console_tx_end()
+ *
+ * On success, this leaves interrupts masked until console_tx_end(),
+ * so frames queued from ISRs can't get interleaved with this one.
+ * That only covers copying the frame into the queue, not sending it.
+ *
+ * Control replies and log lines are dropped if their ring is full,
+ * as is anything queued from an ISR.  Bulk data queued from thread
+ * mode (with interrupts enabled) waits for room instead, while the TX
+ * DMA ISR drains the queue, so those dumps stay lossless.  A frame
+ * bigger than its whole ring is always dropped.
+ */
+tx_queue_status_t console_tx_begin(tx_queue_prio_t prio, uint16_t max_len) {
+  // An empty ring has room for its size less 3 (see tx_queue_room())
+  const bool can_wait = (TX_PRIO_DATA == prio &&
+                         max_len <= CONSOLE_TX_DATA_LEN - 3 &&
+                         !cm_is_masked_interrupts() &&
+                         0 == (SCB_ICSR & SCB_ICSR_VECTACTIVE));
+  uint32_t old_mask;
+
+  for (;;) {
+    if (can_wait) {
+      while (tx_queue_room(&console_txq, prio) < max_len) {
+        // The TX DMA ISR frees up room as it goes
+      }
+    }
+
+    old_mask = cm_mask_interrupts(1);
+
+    // An ISR may have taken the room before we masked, so check again
+    if (!can_wait || tx_queue_room(&console_txq, prio) >= max_len) break;
+    cm_mask_interrupts(old_mask);
+  }
+
+  tx_queue_status_t res = tx_queue_begin(&console_txq, prio, max_len);
+  if (TX_QUEUE_OKAY != res) {
+    cm_mask_interrupts(old_mask);
+    return res;
+  }
+
+  console_tx_old_mask = old_mask;
+  return TX_QUEUE_OKAY;
+}
+
+/**
+ * \brief Add bytes to the frame opened by console_tx_begin()
+ *
+ * \param buf The bytes
+ * \param buflen How many
+ *
+ * This matches packet_tx_cb, so it can be a framer's output.
+ */
+void console_tx_write(const uint8_t *buf, uint16_t buflen) {
+  tx_queue_write(&console_txq, buf, buflen);
+}
+
+/**
+ * \brief Finish the frame opened by console_tx_begin() and send it
+ *
+ * \returns TX_QUEUE_OKAY, or TX_QUEUE_OVERFLOW if it outgrew max_len
+ * and was dropped
+ */
+tx_queue_status_t console_tx_end(void) {
+  tx_queue_status_t res = tx_queue_end(&console_txq);
+  console_tx_kick();
+
+  cm_mask_interrupts(console_tx_old_mask);
+  return res;
+}
+
+/**
+ * \brief Get the queued transmit accounting for a priority class
+ *
+ * \param prio The class
+ * \param stats[out] Where to put the statistics
+ */
+void console_get_tx_stats(tx_queue_prio_t prio, tx_queue_stats_t *stats) {
+  CM_ATOMIC_BLOCK() {
+    tx_queue_get_stats(&console_txq, prio, stats);
+  }
+}
+
+
 //////////////////////////////////////////////////////////////////////
 // ISRs
 
+/**
+ * \brief DMA1 Stream3 ISR: USART TX
+ *
+ * Moves on to the next chunk of console_txq.
+ */
+void dma1_stream3_isr(void) {
+  console_tx_service();
+}
+
 /**
  * \brief DMA1 Stream1 ISR: USART RX
  *
@@ -23,7 +23,34 @@
 
 #endif
 
+/**
+ * Pack a pair of 12b samples for dac_setup_dual12(), in DHR12RD's layout
+ */
+#define DAC_DUAL12(ch1, ch2) ((uint32_t)((ch1) & 0xFFF) | ((uint32_t)((ch2) & 0xFFF) << 16))
+
+typedef void (*dac_fill_cb)(uint16_t *, uint16_t); //!< A streaming DAC producer, see dac_setup_stream()
+
+/**
+ * How the streaming producer has been keeping up
+ *
+ * See dac_get_stream_stats().
+ */
+typedef struct dac_stream_stats {
+  uint32_t refills; //!< Number of half-buffers filled
+  uint32_t underruns; //!< Number of refills that weren't done in time
+  uint32_t max_cycles; //!< Most CPU cycles spent in a single refill
+} dac_stream_stats_t;
+
 void dac_setup(uint16_t, uint32_t, const uint8_t*, uint16_t);
+void dac_setup12(uint16_t, uint32_t, const uint16_t*, uint16_t);
+void dac_setup_dual12(uint16_t, uint32_t, const uint32_t*, uint16_t);
+void dac_setup_stream(uint16_t, uint32_t, uint16_t*, uint16_t, dac_fill_cb);
+void dac_get_stream_stats(dac_stream_stats_t *);
+void dac_reset_stream_stats(void);
+bool dac_queue(const uint8_t*, uint16_t);
+bool dac_queue12(const uint16_t*, uint16_t);
+bool dac_queue_dual12(const uint32_t*, uint16_t);
+bool dac_queue_pending(void);
 float dac_get_sample_rate(uint16_t, uint32_t);
 
 void dac_start(void);
@@ -95,6 +95,11 @@ void dma_setup(dma_settings_t *s) {
   else
      dma_disable_transfer_complete_interrupt(s->dma, s->stream);
 
+  if (s->half_transfer_interrupt)
+    dma_enable_half_transfer_interrupt(s->dma, s->stream);
+  else
+    dma_disable_half_transfer_interrupt(s->dma, s->stream);
+
   if (s->enable_irq)
     nvic_enable_irq(s->irqn);
 
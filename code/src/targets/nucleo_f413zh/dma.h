@@ -43,6 +43,7 @@ typedef struct dma_settings {
   bool double_buffer; //!< If true, enable double buffer mode (we split your buffer for you)
 
   bool transfer_complete_interrupt;  //!< If true, enable TCIF flag
+  bool half_transfer_interrupt;  //!< If true, enable HTIF flag
   bool enable_irq; //!< Whether or not to enable the NVIC IRQ here
   uint8_t irqn; //!< The IRQ to enable with nvic_enable_irq (NVIC_DMA1_STREAM5_IRQ)
 
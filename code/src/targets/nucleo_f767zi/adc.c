@@ -80,6 +80,9 @@
 #include "logging.h"
 #include "dtmf.h"
 
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/dwt.h>
+
 //////////////////////////////////////////////////////////////////////
 // Debug Macros
 
@@ -88,10 +91,56 @@
 // State variables
 
 static adc_dma_buffer_t dma_buffer; //!< The buffer that was given to us
+static volatile adc_cb_stats_t adc_cb_stats; //!< Timing of the buffer callback, see adc_get_cb_stats()
 
 //////////////////////////////////////////////////////////////////////
 // Implementation code
 
+/**
+ * \brief (Internal) Record how long a buffer callback took
+ *
+ * This is only called from the DMA ISR.
+ */
+static void adc_record_cb_cycles(uint32_t cycles) {
+  if (cycles < adc_cb_stats.min_cycles) adc_cb_stats.min_cycles = cycles;
+  if (cycles > adc_cb_stats.max_cycles) adc_cb_stats.max_cycles = cycles;
+  adc_cb_stats.total_cycles += cycles;
+  adc_cb_stats.count++;
+}
+
+/**
+ * \brief Get the timing statistics for the buffer callback
+ *
+ * \param stats[out] Where to put the statistics
+ *
+ * Every call into the buffer callback from the DMA ISR is timed with
+ * the DWT cycle counter, so you can see what the decoding code is
+ * costing in interrupt context.  Divide by rcc_ahb_frequency to get
+ * seconds.  The statistics are reset by adc_setup() and
+ * adc_reset_cb_stats().  If nothing has been timed yet, count is 0
+ * and min_cycles is UINT32_MAX.
+ */
+void adc_get_cb_stats(adc_cb_stats_t *stats) {
+  CM_ATOMIC_BLOCK() {
+    stats->count = adc_cb_stats.count;
+    stats->min_cycles = adc_cb_stats.min_cycles;
+    stats->max_cycles = adc_cb_stats.max_cycles;
+    stats->total_cycles = adc_cb_stats.total_cycles;
+  }
+}
+
+/**
+ * \brief Clear the timing statistics for the buffer callback
+ */
+void adc_reset_cb_stats(void) {
+  CM_ATOMIC_BLOCK() {
+    adc_cb_stats.count = 0;
+    adc_cb_stats.min_cycles = UINT32_MAX;
+    adc_cb_stats.max_cycles = 0;
+    adc_cb_stats.total_cycles = 0;
+  }
+}
+
 /**
  * \brief Starts up the clocks needed for ADC
  */
@@ -246,6 +295,10 @@ float adc_setup(uint16_t prescaler, uint32_t period, uint8_t *buff, uint32_t buf
   adc_setup_clocks();
   adc_setup_gpio();
 
+  // Time every buffer callback from here on
+  dwt_enable_cycle_counter();
+  adc_reset_cb_stats();
+
   timer_setup_adcdac(TIM4, prescaler, period);
 
   adc_setup_adc(channels, n_channels);
@@ -299,7 +352,9 @@ void dma2_stream0_isr(void) {
       bufpos += dma_buffer.buflen/2;
     }
 
+    uint32_t t0 = dwt_read_cycle_counter();
     dtmf_process(bufpos, dma_buffer.buflen/2);
+    adc_record_cb_cycles(dwt_read_cycle_counter() - t0);
   }
 }
 
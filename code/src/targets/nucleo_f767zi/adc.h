@@ -29,15 +29,32 @@ typedef struct adc_dma_buffer {
   uint16_t buflen; //!< The length of the buffer
 } adc_dma_buffer_t;
 
+/**
+ * How long the buffer callback has been taking, in CPU cycles
+ *
+ * See adc_get_cb_stats().
+ */
+typedef struct adc_cb_stats {
+  uint32_t count; //!< Number of callbacks timed
+  uint32_t min_cycles; //!< Fewest cycles spent in a single callback
+  uint32_t max_cycles; //!< Most cycles spent in a single callback
+  uint64_t total_cycles; //!< Cycles spent in all the callbacks together
+} adc_cb_stats_t;
+
 
 #define ADC_PRESCALER_8KHZ 134 //!< The prescaler needed to get 8kHz
 #define ADC_PERIOD_8KHZ 49 //!< The period needed to get 8kHz
+#define ADC_PRESCALER_48KHZ 44 //!< The prescaler needed to get 48kHz, for decimation
+#define ADC_PERIOD_48KHZ 24 //!< The period needed to get 48kHz, for decimation
 
 float adc_setup(uint16_t, uint32_t, uint8_t *,uint32_t);
 uint32_t adc_stop(void);
 void adc_start(void);
 
 float adc_get_sample_rate(uint16_t, uint32_t);
+
+void adc_get_cb_stats(adc_cb_stats_t *);
+void adc_reset_cb_stats(void);
 #endif
 
 /** \} */
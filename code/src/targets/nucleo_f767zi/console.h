@@ -15,6 +15,8 @@
 
 #include <libopencm3/stm32/usart.h>
 
+#include "tx_queue.h"
+
 #define CONSOLE_USART USART3 //!< Which USART peripheral to use for console output
 #define CONSOLE_USART_CLOCK RCC_USART3 //!< Clock for the USART peripheral itself
 
@@ -56,6 +58,11 @@ typedef struct {
 void console_setup(console_cb, char *, uint32_t);
 void console_send_blocking(const char);
 
+tx_queue_status_t console_tx_begin(tx_queue_prio_t, uint16_t);
+void console_tx_write(const uint8_t *, uint16_t);
+tx_queue_status_t console_tx_end(void);
+void console_get_tx_stats(tx_queue_prio_t, tx_queue_stats_t *);
+
 void console_dump(const uint8_t *, uint16_t);
 void console_dumps(const char*, ...);
 void console_dump_hex(const uint8_t *, uint16_t);
@@ -7,6 +7,9 @@
 #include "dma.h"
 #include "timer.h"
 
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/dwt.h>
+
 #include "logging.h"
 
 /**
@@ -21,10 +24,31 @@
 //////////////////////////////////////////////////////////////////////
 // State variables
 
+/**
+ * (Internal) What's in the waveform buffer, and so where the DMA puts it
+ */
+typedef enum dac_format {
+                         DAC_FORMAT_8B, //!< uint8_t into DHR8R1
+                         DAC_FORMAT_12B, //!< uint16_t into DHR12R1
+                         DAC_FORMAT_DUAL12, //!< uint32_t (both channels) into DHR12RD
+} dac_format_t;
+
+static uint32_t dac_channels = DAC_CHANNEL1; //!< Which channels dac_start() turns on
+
+static dac_fill_cb dac_stream_cb; //!< Producer for streaming mode, NULL when not streaming
+static uint16_t *dac_stream_buf; //!< The streaming buffer, both halves
+static uint16_t dac_stream_len; //!< Length of dac_stream_buf, in samples
+static volatile dac_stream_stats_t dac_stream_stats; //!< See dac_get_stream_stats()
+
+static dac_format_t dac_loop_format; //!< Format of the waveform being looped
+static uint16_t dac_loop_len; //!< Length of the waveform being looped
+static const void * volatile dac_pending; //!< Waveform queued by dac_queue(), until it's fully swapped in
+
 static uint16_t last_prescaler;
 static uint32_t last_period;
-static const uint8_t *last_waveform;
+static const void *last_waveform;
 static uint16_t last_npoints;
+static dac_format_t last_format;
 
 //////////////////////////////////////////////////////////////////////
 // Implementation code
@@ -32,12 +56,19 @@ static uint16_t last_npoints;
 
 /**
  * \brief Set up the GPIOs for the DAC subsystem
+ *
+ * \param dual Whether to set up channel 2 as well
  */
-static void gpio_setup(void) {
+static void gpio_setup(bool dual) {
   rcc_periph_clock_enable(RCC_GPIOA);
   // Set PA4 for DAC channel 1 to analogue, ignoring drive mode.
   // CN7.17
   gpio_mode_setup(GPIOA, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, GPIO4);
+
+  if (dual) {
+    // PA5 for DAC channel 2, CN7.10
+    gpio_mode_setup(GPIOA, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, GPIO5);
+  }
 }
 
 
@@ -53,9 +84,24 @@ static void gpio_setup(void) {
  *
  * \param waveform The points to output on the DAC
  * \param npoints How many points are in the waveform
+ * \param format What the points are, see dac_format_t
  */
-static void dac_dma_setup(const uint8_t *waveform, uint16_t npoints)
+static void dac_dma_setup(const void *waveform, uint16_t npoints, dac_format_t format)
 {
+  uint32_t paddr = (uint32_t) &DAC_DHR8R1(DAC1);
+  uint32_t psize = DMA_SxCR_PSIZE_8BIT;
+  uint32_t msize = DMA_SxCR_MSIZE_8BIT;
+
+  if (DAC_FORMAT_12B == format) {
+    paddr = (uint32_t) &DAC_DHR12R1(DAC1);
+    psize = DMA_SxCR_PSIZE_16BIT;
+    msize = DMA_SxCR_MSIZE_16BIT;
+  } else if (DAC_FORMAT_DUAL12 == format) {
+    paddr = (uint32_t) &DAC_DHR12RD(DAC1);
+    psize = DMA_SxCR_PSIZE_32BIT;
+    msize = DMA_SxCR_MSIZE_32BIT;
+  }
+
   dma_settings_t settings = {
                              .dma = DMA1,
                              .stream = DMA_STREAM5,
@@ -63,16 +109,17 @@ static void dac_dma_setup(const uint8_t *waveform, uint16_t npoints)
                              .priority = DMA_SxCR_PL_LOW,
 
                              .direction = DMA_SxCR_DIR_MEM_TO_PERIPHERAL,
-                             .paddr = (uint32_t) &DAC_DHR8R1(DAC1),
-                             .peripheral_size = DMA_SxCR_PSIZE_8BIT,
+                             .paddr = paddr,
+                             .peripheral_size = psize,
                              .buf = (uint32_t) waveform,
                              .buflen = npoints,
-                             .mem_size = DMA_SxCR_MSIZE_8BIT,
+                             .mem_size = msize,
 
                              .circular_mode = 1,
                              .double_buffer = 0,
 
-                             .transfer_complete_interrupt = 0,
+                             .transfer_complete_interrupt = 1,
+                             .half_transfer_interrupt = (dac_stream_cb != NULL),
                              .enable_irq = 1,
                              .irqn = NVIC_DMA1_STREAM5_IRQ,
 
@@ -80,6 +127,58 @@ static void dac_dma_setup(const uint8_t *waveform, uint16_t npoints)
   };
 
   dma_setup(&settings);
+
+  if (!dac_stream_cb) {
+    // Loop in double buffer mode, with both buffers the same, so that
+    // dac_queue() can slip a new waveform in behind the current one.
+    dma_set_memory_address_1(DMA1, DMA_STREAM5, (uint32_t) waveform);
+    dma_enable_double_buffer_mode(DMA1, DMA_STREAM5);
+  }
+}
+
+
+/**
+ * (Internal) Set up the DAC for any sample format, see dac_setup()
+ */
+static void dac_setup_common(uint16_t prescaler, uint32_t period,
+                             const void *waveform, uint16_t npoints, dac_format_t format) {
+  const bool dual = (DAC_FORMAT_DUAL12 == format);
+
+  dac_loop_format = format;
+  dac_loop_len = npoints;
+  dac_pending = NULL;
+
+  // Stash these in case we need to do the erratum workaround
+  last_prescaler = prescaler;
+  last_period = period;
+  last_waveform = waveform;
+  last_npoints = npoints;
+  last_format = format;
+
+  gpio_setup(dual);
+  timer_setup_adcdac(TIM2, prescaler, period);
+
+  rcc_periph_clock_enable(RCC_DMA1);
+  dac_dma_setup(waveform, npoints, format);
+
+  /* Enable the DAC clock on APB1 */
+  rcc_periph_clock_enable(RCC_DAC);
+  /* Setup the DAC channel 1, with timer 2 as trigger source.
+   * Assume the DAC has woken up by the time the first transfer occurs */
+  dac_trigger_enable(DAC1, DAC_CHANNEL1);
+  dac_set_trigger_source(DAC1, DAC_CR_TSEL1_T2);  // RM0410r4 p490
+  dac_dma_enable(DAC1, DAC_CHANNEL1);
+
+  if (dual) {
+    // Channel 2 converts on the same timer edge, but only channel 1
+    // asks for DMA: one transfer into DHR12RD feeds them both.
+    dac_trigger_enable(DAC1, DAC_CHANNEL2);
+    dac_set_trigger_source(DAC1, DAC_CR_TSEL2_T2);
+    dac_channels = DAC_CHANNEL_BOTH;
+  } else {
+    dac_disable(DAC1, DAC_CHANNEL2);
+    dac_channels = DAC_CHANNEL1;
+  }
 }
 
 
@@ -137,25 +236,204 @@ static void dac_dma_setup(const uint8_t *waveform, uint16_t npoints)
  *
  */
 void dac_setup(uint16_t prescaler, uint32_t period, const uint8_t *waveform, uint16_t npoints) {
-  // Stash these in case we need to do the erratum workaround
-  last_prescaler = prescaler;
-  last_period = period;
-  last_waveform = waveform;
-  last_npoints = npoints;
+  dac_stream_cb = NULL;
+  dac_setup_common(prescaler, period, waveform, npoints, DAC_FORMAT_8B);
+}
 
-  gpio_setup();
-  timer_setup_adcdac(TIM2, prescaler, period);
+/**
+ * \brief Set up a DAC channel for continuous 12b output
+ *
+ * \param prescaler The prescaler used for the timer clocking the DAC, as in dac_setup()
+ * \param period The semi-period between timer clocks, as in dac_setup()
+ * \param waveform A buffer of 12b samples (0..4095) to send out the DAC
+ * \param npoints The number of samples before looping
+ *
+ * This is the same as dac_setup(), but uses the full resolution of
+ * the DAC: the DMA moves a halfword per sample into DHR12R1 instead of
+ * a byte into DHR8R1.  The extra bus traffic is negligible at audio
+ * rates.  sin_gen_generate_multi12() makes suitable waveforms.
+ */
+void dac_setup12(uint16_t prescaler, uint32_t period, const uint16_t *waveform, uint16_t npoints) {
+  dac_stream_cb = NULL;
+  dac_setup_common(prescaler, period, waveform, npoints, DAC_FORMAT_12B);
+}
 
-  rcc_periph_clock_enable(RCC_DMA1);
-  dac_dma_setup(waveform, npoints);
+/**
+ * \brief Set up both DAC channels for continuous, sample-aligned 12b output
+ *
+ * \param prescaler The prescaler used for the timer clocking the DAC, as in dac_setup()
+ * \param period The semi-period between timer clocks, as in dac_setup()
+ * \param waveform A buffer of packed sample pairs: channel 1 in the
+ * low 12 bits, channel 2 in bits 16-27 (see DAC_DUAL12())
+ * \param npoints The number of sample pairs before looping
+ *
+ * This drives channel 2 (PA5) alongside channel 1 (PA4), for things
+ * like I/Q output; sin_gen_generate_iq12() makes suitable waveforms.
+ * Rather than running a second DMA stream for channel 2, each sample
+ * pair goes over in a single 32b transfer into the dual data holding
+ * register, DHR12RD.  That's half the DMA requests and bus traffic of
+ * two streams, and since both channels are updated by the same
+ * transfer and converted on the same trigger, they can't drift apart.
+ *
+ * dac_start() and dac_stop() handle both channels until the next
+ * dac_setup() or dac_setup12() call.
+ */
+void dac_setup_dual12(uint16_t prescaler, uint32_t period, const uint32_t *waveform, uint16_t npoints) {
+  dac_stream_cb = NULL;
+  dac_setup_common(prescaler, period, waveform, npoints, DAC_FORMAT_DUAL12);
+}
 
-  /* Enable the DAC clock on APB1 */
-  rcc_periph_clock_enable(RCC_DAC);
-  /* Setup the DAC channel 1, with timer 2 as trigger source.
-   * Assume the DAC has woken up by the time the first transfer occurs */
-  dac_trigger_enable(DAC1, DAC_CHANNEL1);
-  dac_set_trigger_source(DAC1, DAC_CR_TSEL1_T2);  // RM0410r4 p490
-  dac_dma_enable(DAC1, DAC_CHANNEL1);
+/**
+ * \brief Set up the DAC to stream 12b samples from a producer callback
+ *
+ * \param prescaler The prescaler used for the timer clocking the DAC, as in dac_setup()
+ * \param period The semi-period between timer clocks, as in dac_setup()
+ * \param buf The buffer to stream through, which must stay around
+ * \param npoints The length of buf, in samples (rounded down to even)
+ * \param cb The producer, which fills in half of buf at a time
+ *
+ * The other setup functions loop a fixed buffer, which limits you to
+ * waveforms that fit in RAM and repeat.  This instead treats buf as
+ * two halves: while the DMA is playing one, cb is called from the DMA
+ * interrupt to fill in the other.  So the waveform can be as long as
+ * you like, and change as it goes (chirps, sequences of tones, etc),
+ * with only a small fixed buffer.
+ *
+ * Both halves are filled before this returns, so cb must be ready to
+ * go beforehand.  After that, it's called at every half-transfer and
+ * transfer-complete interrupt, and has half a buffer's worth of time
+ * to finish: at 48kSps and 256 samples, that's 2.7ms.  If it's late,
+ * some stale samples go out, and the underrun is counted in
+ * dac_get_stream_stats().
+ *
+ * The simplest producer is just sin_gen_nco_fill12() on an oscillator
+ * that lives outside the callback, which keeps its phase across
+ * refills.
+ *
+ * As with the other modes, call dac_start() to get it going.
+ */
+void dac_setup_stream(uint16_t prescaler, uint32_t period, uint16_t *buf, uint16_t npoints,
+                      dac_fill_cb cb) {
+  const uint16_t half = npoints/2;
+
+  dac_stream_buf = buf;
+  dac_stream_len = 2*half;
+
+  cb(buf, half);
+  cb(buf + half, half);
+
+  dac_reset_stream_stats();
+  dwt_enable_cycle_counter();
+  dac_stream_cb = cb;
+
+  dac_setup_common(prescaler, period, buf, dac_stream_len, DAC_FORMAT_12B);
+}
+
+/**
+ * \brief Get the statistics for the streaming producer
+ *
+ * \param stats[out] Where to put the statistics
+ *
+ * These are reset by dac_setup_stream() and dac_reset_stream_stats().
+ */
+void dac_get_stream_stats(dac_stream_stats_t *stats) {
+  CM_ATOMIC_BLOCK() {
+    stats->refills = dac_stream_stats.refills;
+    stats->underruns = dac_stream_stats.underruns;
+    stats->max_cycles = dac_stream_stats.max_cycles;
+  }
+}
+
+/**
+ * \brief Clear the statistics for the streaming producer
+ */
+void dac_reset_stream_stats(void) {
+  CM_ATOMIC_BLOCK() {
+    dac_stream_stats.refills = 0;
+    dac_stream_stats.underruns = 0;
+    dac_stream_stats.max_cycles = 0;
+  }
+}
+
+/**
+ * (Internal) Queue up a waveform for any sample format, see dac_queue()
+ */
+static bool dac_queue_common(const void *waveform, uint16_t npoints, dac_format_t format) {
+  bool queued = false;
+
+  CM_ATOMIC_BLOCK() {
+    if (!dac_stream_cb && (format == dac_loop_format) && (npoints == dac_loop_len) &&
+        (DMA_SCR(DMA1, DMA_STREAM5) & DMA_SxCR_EN)) {
+      dac_pending = waveform;
+
+      // libopencm3 only lets us write the address the DMA isn't using
+      if (dma_get_target(DMA1, DMA_STREAM5))
+        dma_set_memory_address(DMA1, DMA_STREAM5, (uint32_t) waveform);
+      else
+        dma_set_memory_address_1(DMA1, DMA_STREAM5, (uint32_t) waveform);
+
+      queued = true;
+    }
+  }
+
+  return queued;
+}
+
+/**
+ * \brief Switch to a new waveform at the end of the current cycle
+ *
+ * \param waveform The new waveform, as in dac_setup()
+ * \param npoints Its length, which must be the same as the current one
+ *
+ * \returns true if it's queued, false if the DAC isn't running, is
+ * streaming, is looping a different sample format from the one this
+ * function takes, or npoints doesn't match
+ *
+ * Changing waveforms with dac_stop() and dac_setup() resets the timer
+ * and DMA, which leaves a gap in the output, and on the F767 runs
+ * into errata around stopped DMA.  This doesn't stop anything:
+ * the loop modes run the DMA in double buffer mode, with both memory
+ * addresses on the same waveform.  This points the idle address at
+ * the new one, so the DMA moves onto it as soon as it finishes the
+ * current pass, and the transfer complete interrupt then points the
+ * other address at it as well.  See dac_queue_pending() to find out
+ * when that's happened.
+ *
+ * The catch is that both addresses share one transfer count, so the
+ * new waveform must be the same length as the current one.  If it
+ * isn't, you have to go through dac_setup() again.
+ */
+bool dac_queue(const uint8_t *waveform, uint16_t npoints) {
+  return dac_queue_common(waveform, npoints, DAC_FORMAT_8B);
+}
+
+/**
+ * \brief Switch to a new 12b waveform at the end of the current cycle
+ *
+ * See dac_queue() and dac_setup12().
+ */
+bool dac_queue12(const uint16_t *waveform, uint16_t npoints) {
+  return dac_queue_common(waveform, npoints, DAC_FORMAT_12B);
+}
+
+/**
+ * \brief Switch to a new pair of 12b waveforms at the end of the
+ * current cycle
+ *
+ * See dac_queue() and dac_setup_dual12().
+ */
+bool dac_queue_dual12(const uint32_t *waveform, uint16_t npoints) {
+  return dac_queue_common(waveform, npoints, DAC_FORMAT_DUAL12);
+}
+
+/**
+ * \brief Check if a queued waveform is still waiting to be swapped in
+ *
+ * \returns true until the DMA is playing the last waveform passed to
+ * one of the dac_queue() functions, and will keep playing it
+ */
+bool dac_queue_pending(void) {
+  return dac_pending != NULL;
 }
 
 
@@ -179,11 +457,11 @@ void dac_start(void) {
 
 #ifdef F767_ATTEMPT_DAC_DMA_WORKAROUND_2_6_2
     // 2. Clear the DAC channel DMAEN bit.
-    dac_disable(DAC1, DAC_CHANNEL1);
+    dac_disable(DAC1, dac_channels);
     // 3. Disable the DAC clock.
     rcc_periph_clock_disable(RCC_DAC);
     // 4. Reconfigure the DAC, DMA and the triggers.
-    dac_setup(last_prescaler, last_period, last_waveform, last_npoints);
+    dac_setup_common(last_prescaler, last_period, last_waveform, last_npoints, last_format);
 
     // 5. Restart the application.
     // fallthrough to the rest of this routine
@@ -191,7 +469,7 @@ void dac_start(void) {
   }
   dac_dma_enable(DAC1, DAC_CHANNEL1);
   dma_enable_stream(DMA1, DMA_STREAM5);
-  dac_enable(DAC1, DAC_CHANNEL1);
+  dac_enable(DAC1, dac_channels);
 }
 
 /**
@@ -201,7 +479,7 @@ void dac_start(void) {
  */
 void dac_stop(void) {
   dac_dma_disable(DAC1, DAC_CHANNEL1);
-  dac_disable(DAC1, DAC_CHANNEL1);
+  dac_disable(DAC1, dac_channels);
   dma_disable_stream(DMA1, DMA_STREAM5);
 }
 
@@ -226,10 +504,85 @@ float dac_get_sample_rate(uint16_t prescaler, uint32_t period) {
 // ISRs
 
 /**
- * \brief DMA Callback ISR for DAC (currently empty)
+ * (Internal) Refill the half of the streaming buffer the DMA isn't
+ * playing, see dac_setup_stream()
+ *
+ * \param missed Whether both halves went by since the last refill
+ *
+ * Rather than trusting which flag fired, this looks at how far along
+ * the DMA actually is (NDTR counts down to 0 over the whole buffer).
+ * That way a late interrupt still refills the right half, and we can
+ * tell if the DMA ran into the half we were filling before we were
+ * done with it.
+ */
+static void dac_stream_refill(bool missed) {
+  const uint16_t half = dac_stream_len/2;
+  const bool playing_first = dma_get_number_of_data(DMA1, DMA_STREAM5) > half;
+  uint16_t *dst = playing_first ? dac_stream_buf + half : dac_stream_buf;
+
+  uint32_t t0 = dwt_read_cycle_counter();
+  dac_stream_cb(dst, half);
+  uint32_t cycles = dwt_read_cycle_counter() - t0;
+
+  dac_stream_stats.refills++;
+  if (cycles > dac_stream_stats.max_cycles) dac_stream_stats.max_cycles = cycles;
+
+  // The DMA moving into the half we were filling means some of it
+  // went out stale.
+  if (missed || ((dma_get_number_of_data(DMA1, DMA_STREAM5) > half) != playing_first)) {
+    dac_stream_stats.underruns++;
+  }
+}
+
+/**
+ * (Internal) Finish swapping in a waveform from dac_queue()
+ *
+ * This is called at the end of every pass through the waveform while
+ * one is pending.  Normally the DMA has just moved onto the new
+ * waveform, and we point the other address at it too, so it stays
+ * there.  If dac_queue() raced the end of a pass and its write didn't
+ * land, the DMA went back to the old one, but the write here means
+ * it'll be on the new one at the end of this pass instead.
+ */
+static void dac_finish_swap(void) {
+  const void *next = dac_pending;
+  const bool in_m1 = dma_get_target(DMA1, DMA_STREAM5);
+
+  if (in_m1)
+    dma_set_memory_address(DMA1, DMA_STREAM5, (uint32_t) next);
+  else
+    dma_set_memory_address_1(DMA1, DMA_STREAM5, (uint32_t) next);
+
+  uint32_t active = (in_m1
+                     ? (uint32_t) DMA_SM1AR(DMA1, DMA_STREAM5)
+                     : (uint32_t) DMA_SM0AR(DMA1, DMA_STREAM5));
+  if (active == (uint32_t) next) {
+    dac_pending = NULL;
+    last_waveform = next; // So the erratum workaround sets up the right one
+  }
+}
+
+/**
+ * \brief DMA Callback ISR for DAC
+ *
+ * In streaming mode (see dac_setup_stream()), this refills the buffer
+ * at each half.  In the looping modes, it finishes off waveform swaps
+ * from dac_queue() at the end of each pass.
  */
 void dma1_stream5_isr(void)
 {
+  const bool half_done = dma_get_interrupt_flag(DMA1, DMA_STREAM5, DMA_HTIF);
+  const bool all_done = dma_get_interrupt_flag(DMA1, DMA_STREAM5, DMA_TCIF);
+  dma_clear_interrupt_flags(DMA1, DMA_STREAM5, DMA_HTIF | DMA_TCIF);
+
+  if (dac_stream_cb) {
+    if (half_done || all_done)
+      dac_stream_refill(half_done && all_done);
+    return;
+  }
+
+  if (all_done && dac_pending)
+    dac_finish_swap();
 }
 
 /** \} */
@@ -26,6 +26,7 @@ uint8_t HW_packet_buf[2048]; //!< A copy of the most recent packet submission
 uint16_t HW_packet_len;      //!< Length of most recent packet submission
 uint8_t HW_packet_addr;      //!< Address of most recent packet submission
 uint8_t HW_packet_command;   //!< Command of most recent packet submission
+tx_queue_prio_t HW_packet_prio; //!< Priority class of most recent packet submission
 
 
 void HW_set_default_state(void) {
@@ -43,6 +44,7 @@ void HW_set_default_state(void) {
   HW_packet_len = 0;
   HW_packet_addr = 0;
   HW_packet_command = 0;
+  HW_packet_prio = TX_PRIO_CONTROL;
 }
 
 
@@ -79,12 +81,20 @@ void scb_reset_system(void) {
 //////////////////////////////////////////////////////////////////////
 // Packet state (very close to hardware)
 
-void packet_send(const uint8_t *buf, uint16_t buflen, uint8_t address, uint8_t command) {
+tx_queue_status_t packet_send_prio(const uint8_t *buf, uint16_t buflen, uint8_t address, uint8_t command,
+                                   tx_queue_prio_t prio) {
   HW_packet_count++;
   memcpy(HW_packet_buf, buf, buflen);
   HW_packet_len = buflen;
   HW_packet_addr = address;
   HW_packet_command = command;
+  HW_packet_prio = prio;
+
+  return TX_QUEUE_OKAY;
+}
+
+void packet_send(const uint8_t *buf, uint16_t buflen, uint8_t address, uint8_t command) {
+  packet_send_prio(buf, buflen, address, command, TX_PRIO_CONTROL);
 }
 
 
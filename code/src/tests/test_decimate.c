@@ -0,0 +1,275 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "unity.h"
+
+#include "decimate.h"
+#include "dtmf.h"
+
+#ifndef M_PI
+#include "sin_gen.h"
+#define M_PI 2*COS_THETA0
+#endif
+
+#define FS_IN 48000 //!< Input sample rate for the tests
+#define RATIO 6 //!< Decimation ratio for the tests, to get to 8kHz
+#define ORDER 3 //!< CIC order for the tests
+
+#define IN_LEN 9600 //!< Input samples in the test buffers (200ms)
+
+static uint8_t in8[IN_LEN];
+static uint16_t out[IN_LEN/RATIO + 1];
+
+//////////////////////////////////////////////////////////////////////
+// Unity requires a setUp and tearDown function.
+
+void setUp(void) {
+  memset(in8, 0, sizeof(in8));
+  memset(out, 0, sizeof(out));
+}
+
+/**
+ * There is nothing to tear down in this set of tests.
+ */
+void tearDown(void) {}
+
+//////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+ * Fill in8 with a tone at 8b, centered on 127
+ */
+static void fill_tone(float freq, float amplitude) {
+  for (int i = 0; i < IN_LEN; i++) {
+    in8[i] = 127 + roundf(amplitude * sinf(2*M_PI*freq*i/FS_IN));
+  }
+}
+
+/**
+ * Get the magnitude of one frequency in the decimated output
+ *
+ * Skips the first few samples, where the combs are still filling.
+ */
+static float out_magnitude(uint16_t n_out, float freq) {
+  float re = 0, im = 0, mean = 0;
+
+  for (int i = ORDER; i < n_out; i++) mean += out[i];
+  mean /= (n_out - ORDER);
+
+  for (int i = ORDER; i < n_out; i++) {
+    float w = 2*M_PI*freq*i*RATIO/FS_IN;
+    re += (out[i] - mean) * cosf(w);
+    im += (out[i] - mean) * sinf(w);
+  }
+
+  return sqrtf(re*re + im*im) * 2 / (n_out - ORDER);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Tests
+
+void test_init__invalid(void) {
+  decimate_t dec;
+
+  TEST_ASSERT_EQUAL(DECIMATE_INVALID_INPUTS, decimate_init(NULL, RATIO, ORDER, 1));
+  TEST_ASSERT_EQUAL(DECIMATE_INVALID_INPUTS, decimate_init(&dec, 0, ORDER, 1));
+  TEST_ASSERT_EQUAL(DECIMATE_INVALID_INPUTS, decimate_init(&dec, RATIO, 0, 1));
+  TEST_ASSERT_EQUAL(DECIMATE_INVALID_INPUTS, decimate_init(&dec, RATIO, DECIMATE_MAX_ORDER+1, 1));
+  TEST_ASSERT_EQUAL(DECIMATE_INVALID_INPUTS, decimate_init(&dec, RATIO, ORDER, 0));
+  TEST_ASSERT_EQUAL(DECIMATE_INVALID_INPUTS, decimate_init(&dec, RATIO, ORDER, 3));
+
+  TEST_ASSERT_EQUAL_STRING("INVALID_INPUTS", decimate_status_name(DECIMATE_INVALID_INPUTS));
+}
+
+void test_init__overflow(void) {
+  decimate_t dec;
+
+  // 8b in, 64^4 = 2^24 of gain: just fits
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, 64, 4, 1));
+  TEST_ASSERT_EQUAL(DECIMATE_OVERFLOW, decimate_init(&dec, 65, 4, 1));
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, 255, 3, 1));
+
+  // 12b in gets less room
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, 101, 3, 2));
+  TEST_ASSERT_EQUAL(DECIMATE_OVERFLOW, decimate_init(&dec, 102, 3, 2));
+  TEST_ASSERT_EQUAL(DECIMATE_OVERFLOW, decimate_init(&dec, 255, 4, 2));
+
+  TEST_ASSERT_EQUAL_STRING("OVERFLOW", decimate_status_name(DECIMATE_OVERFLOW));
+}
+
+/**
+ * A constant input should settle to input * gain, and a power of two
+ * ratio should come out as plain 12b
+ */
+void test_dc_gain(void) {
+  decimate_t dec;
+
+  memset(in8, 100, sizeof(in8));
+
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, RATIO, ORDER, 1));
+  TEST_ASSERT_EQUAL_FLOAT(13.5, decimate_gain(&dec));
+
+  uint16_t n_out = decimate_run(&dec, in8, 1, IN_LEN, out);
+  TEST_ASSERT_EQUAL(IN_LEN/RATIO, n_out);
+
+  for (int i = ORDER; i < n_out; i++) {
+    TEST_ASSERT_EQUAL(1350, out[i]);
+  }
+
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, 4, ORDER, 1));
+  TEST_ASSERT_EQUAL_FLOAT(16, decimate_gain(&dec));
+  n_out = decimate_run(&dec, in8, 1, IN_LEN, out);
+  TEST_ASSERT_EQUAL(IN_LEN/4, n_out);
+  TEST_ASSERT_EQUAL(1600, out[n_out-1]);
+
+  // 12b in, 12b out
+  static uint16_t in16[IN_LEN];
+  for (int i = 0; i < IN_LEN; i++) in16[i] = 3000;
+
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, 4, ORDER, 2));
+  TEST_ASSERT_EQUAL_FLOAT(1, decimate_gain(&dec));
+  n_out = decimate_run(&dec, (const uint8_t *)in16, 1, IN_LEN, out);
+  TEST_ASSERT_EQUAL(3000, out[n_out-1]);
+}
+
+/**
+ * Odd-sized blocks should give exactly the same output as one big one
+ */
+void test_chunked_matches_oneshot(void) {
+  decimate_t dec;
+  static uint16_t out_chunked[IN_LEN/RATIO + 1];
+
+  fill_tone(1209, 100);
+
+  decimate_init(&dec, RATIO, ORDER, 1);
+  uint16_t n_out = decimate_run(&dec, in8, 1, IN_LEN, out);
+
+  decimate_init(&dec, RATIO, ORDER, 1);
+  uint16_t n_chunked = 0;
+  for (int i = 0; i < IN_LEN; i += 37) {
+    uint16_t l = IN_LEN - i;
+    l = (l > 37 ? 37 : l);
+    n_chunked += decimate_run(&dec, in8+i, 1, l, out_chunked+n_chunked);
+  }
+
+  TEST_ASSERT_EQUAL(n_out, n_chunked);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(out, out_chunked, n_out);
+
+  // And a reset starts it over
+  decimate_reset(&dec);
+  n_chunked = decimate_run(&dec, in8, 1, IN_LEN, out_chunked);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(out, out_chunked, n_out);
+}
+
+/**
+ * Picking one channel out of an interleaved buffer should match
+ * running on that channel alone
+ */
+void test_strided(void) {
+  decimate_t dec;
+  static uint8_t interleaved[2*IN_LEN];
+  static uint16_t out_strided[IN_LEN/RATIO + 1];
+
+  fill_tone(941, 100);
+  for (int i = 0; i < IN_LEN; i++) {
+    interleaved[2*i] = 255 - in8[i];
+    interleaved[2*i+1] = in8[i];
+  }
+
+  decimate_init(&dec, RATIO, ORDER, 1);
+  uint16_t n_out = decimate_run(&dec, in8, 1, IN_LEN, out);
+
+  decimate_init(&dec, RATIO, ORDER, 1);
+  TEST_ASSERT_EQUAL(n_out, decimate_run(&dec, interleaved+1, 2, IN_LEN, out_strided));
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(out, out_strided, n_out);
+}
+
+/**
+ * DTMF tones should pass, with only a little droop, while anything
+ * that would alias onto them is knocked way down
+ */
+void test_passband_and_alias(void) {
+  decimate_t dec;
+
+  fill_tone(697, 100);
+  decimate_init(&dec, RATIO, ORDER, 1);
+  float row = out_magnitude(decimate_run(&dec, in8, 1, IN_LEN, out), 697) / decimate_gain(&dec);
+
+  fill_tone(1633, 100);
+  decimate_init(&dec, RATIO, ORDER, 1);
+  float col = out_magnitude(decimate_run(&dec, in8, 1, IN_LEN, out), 1633) / decimate_gain(&dec);
+
+  // 40697Hz lands right on 697Hz after decimation
+  fill_tone(FS_IN - 8000 + 697, 100);
+  decimate_init(&dec, RATIO, ORDER, 1);
+  float alias = out_magnitude(decimate_run(&dec, in8, 1, IN_LEN, out), 697) / decimate_gain(&dec);
+
+  TEST_ASSERT_FLOAT_WITHIN(3, 95, row); // -0.4dB
+  TEST_ASSERT_FLOAT_WITHIN(3, 81, col); // -1.8dB
+  TEST_ASSERT_LESS_THAN(1, alias); // Better than -40dB
+}
+
+/**
+ * Tones synthesized at 48kHz should decode after decimation
+ */
+void test_dtmf_end_to_end(void) {
+  static const char symbols[] = "159D";
+  static uint8_t in[4*IN_LEN];
+  static uint16_t decimated[4*IN_LEN/RATIO + 1];
+  decimate_t dec;
+  dtmf_decoder_t dtmf;
+  dtmf_event_t events[8];
+
+  // 100ms of tone and 100ms of silence for each symbol
+  for (int s = 0; s < 4; s++) {
+    float f_row, f_col;
+    TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_get_tones(symbols[s], &f_row, &f_col));
+
+    for (int i = 0; i < IN_LEN; i++) {
+      float v = 0;
+      if (i < IN_LEN/2) {
+        v = 50*sinf(2*M_PI*f_row*i/FS_IN) + 50*sinf(2*M_PI*f_col*i/FS_IN);
+      }
+      in[s*IN_LEN + i] = 127 + roundf(v);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(DECIMATE_OKAY, decimate_init(&dec, RATIO, ORDER, 1));
+  float gain = decimate_gain(&dec);
+
+  dtmf_decoder_init(&dtmf, FS_IN/RATIO, 0.5, NULL, NULL, DTMF_BACKEND_FIXED);
+  dtmf_decoder_set_calibration(&dtmf, 127*gain, 127*gain, false);
+  dtmf.state.events = events;
+  dtmf.state.max_events = 8;
+
+  // Feed it the way the ADC callback does, one DMA half at a time
+  for (int i = 0; i < 4*IN_LEN; i += 2*RATIO*200) {
+    uint16_t n_out = decimate_run(&dec, in+i, 1, 2*RATIO*200, decimated);
+    TEST_ASSERT_EQUAL(400, n_out);
+    dtmf_decoder_process16(&dtmf, decimated, 200);
+    dtmf_decoder_process16(&dtmf, decimated+200, 200);
+  }
+  dtmf_decoder_process16(&dtmf, NULL, 0);
+
+  TEST_ASSERT_EQUAL(4, dtmf.state.n_events);
+  for (int s = 0; s < 4; s++) {
+    TEST_ASSERT_EQUAL(symbols[s], events[s].symbol);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[]) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_init__invalid);
+  RUN_TEST(test_init__overflow);
+  RUN_TEST(test_dc_gain);
+  RUN_TEST(test_chunked_matches_oneshot);
+  RUN_TEST(test_strided);
+  RUN_TEST(test_passband_and_alias);
+  RUN_TEST(test_dtmf_end_to_end);
+
+  return UNITY_END();
+}
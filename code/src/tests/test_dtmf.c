@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
 
 #include "unity.h"
 
@@ -185,6 +186,562 @@ void test_all_zeros(void) {
 }
 
 
+/**
+ * The original tone-at-a-time Goertzel loop, kept here as a reference
+ * for the single-pass kernel in dtmf_goertzel().
+ */
+static void reference_goertzel(const uint8_t *buf, uint16_t buflen, float Fs, float *mags) {
+  const float tones[8] = { 697, 770, 852, 941, 1209, 1336, 1477, 1633 };
+
+  for (int tone_no = 0; tone_no < 8; tone_no++) {
+    float w = 2 * M_PI * tones[tone_no]/Fs;
+    float cos_w = cosf(w);
+    float sin_w = sinf(w);
+    float z2 = 0;
+    float z1 = 0;
+
+    for (int i = 0; i < buflen; i++) {
+      float x = (buf[i] - 127.0)/127.0;
+      float z0 = x + (2*cos_w * z1) - z2;
+      z2 = z1;
+      z1 = z0;
+    }
+
+    float res_i = z1 * cos_w - z2;
+    float res_q = z1 * sin_w;
+
+    float mag = res_i*res_i + res_q*res_q;
+    mag /= buflen/2;
+    mags[tone_no] = mag;
+  }
+}
+
+void test_goertzel_matches_reference(void) {
+  const int buf_stride = 200;
+  char errmsg[64];
+
+  dtmf_init(FIXTURE_DTMF_FS, 0.5, button_down, button_up);
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > buf_stride ? buf_stride : l);
+
+    float expected[8];
+    float got[8];
+
+    reference_goertzel(fixture_dtmf_buffer+i, l, FIXTURE_DTMF_FS, expected);
+    dtmf_goertzel(fixture_dtmf_buffer+i, l, got);
+
+    for (int tone_no = 0; tone_no < 8; tone_no++) {
+      snprintf(errmsg, sizeof(errmsg), "offset %d tone %d", i, tone_no);
+      TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-5 + 1e-5*expected[tone_no],
+                                       expected[tone_no], got[tone_no], errmsg);
+    }
+  }
+}
+
+/**
+ * Run the fixture through the decoder on the given backend
+ */
+static void decode_fixture(dtmf_backend_t backend, int buf_stride) {
+  dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, backend);
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > buf_stride ? buf_stride : l);
+
+    dtmf_process((const uint8_t*)fixture_dtmf_buffer+i, l);
+  }
+  dtmf_process(NULL, 0);
+}
+
+void test_fixed__happy_path(void) {
+  decode_fixture(DTMF_BACKEND_FIXED, 200);
+
+  TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+  TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+}
+
+void test_fixed__matches_float(void) {
+  const int strides[] = { 80, 100, 128, 200, 256, 400 };
+  uint8_t float_down[DUMMY_LEN];
+  uint8_t float_up[DUMMY_LEN];
+  char errmsg[32];
+
+  for (size_t k = 0; k < sizeof(strides)/sizeof(strides[0]); k++) {
+    snprintf(errmsg, sizeof(errmsg), "stride %d", strides[k]);
+
+    setUp();
+    decode_fixture(DTMF_BACKEND_FLOAT, strides[k]);
+    memcpy(float_down, rx_down, DUMMY_LEN);
+    memcpy(float_up, rx_up, DUMMY_LEN);
+
+    setUp();
+    decode_fixture(DTMF_BACKEND_FIXED, strides[k]);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(float_down, rx_down, errmsg);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(float_up, rx_up, errmsg);
+  }
+}
+
+void test_fixed__magnitudes(void) {
+  const int buf_stride = 200;
+  char errmsg[64];
+
+  dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, DTMF_BACKEND_FIXED);
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > buf_stride ? buf_stride : l);
+
+    float expected[8];
+    int64_t got[8];
+
+    dtmf_goertzel(fixture_dtmf_buffer+i, l, expected);
+    dtmf_goertzel_fixed(fixture_dtmf_buffer+i, l, got);
+
+    for (int tone_no = 0; tone_no < 8; tone_no++) {
+      float got_f = got[tone_no] / (127.0 * 127.0 * (1 << (2*DTMF_SAMPLE_SHIFT)) * (l/2));
+      snprintf(errmsg, sizeof(errmsg), "offset %d tone %d", i, tone_no);
+      TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.001 + 0.002*expected[tone_no],
+                                       expected[tone_no], got_f, errmsg);
+    }
+  }
+}
+
+void test_fixed__all_zeros(void) {
+  const int buf_stride = 200;
+
+  uint8_t zeros[FIXTURE_DTMF_BUFLEN];
+  memset(zeros, 0, FIXTURE_DTMF_BUFLEN);
+
+  dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, DTMF_BACKEND_FIXED);
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > buf_stride ? buf_stride : l);
+
+    dtmf_process(zeros+i, l);
+  }
+  dtmf_process(NULL, 0);
+
+  TEST_ASSERT_EQUAL_STRING("", rx_down);
+  TEST_ASSERT_EQUAL_STRING("", rx_up);
+}
+
+uint8_t rx2_down[DUMMY_LEN];
+uint8_t rx2_down_cursor = 0;
+
+uint8_t rx2_up[DUMMY_LEN];
+uint8_t rx2_up_cursor = 0;
+
+void button_down2(uint8_t symbol, float power) {
+  rx2_down[rx2_down_cursor] = symbol;
+  rx2_down_cursor++;
+  rx2_down[rx2_down_cursor] = 0;
+}
+
+void button_up2(uint8_t symbol, float dt) {
+  rx2_up[rx2_up_cursor] = symbol;
+  rx2_up_cursor++;
+  rx2_up[rx2_up_cursor] = 0;
+}
+
+/**
+ * Two channels interleaved, as a scanning ADC would give them to us:
+ * the fixture on channel 0, and silence on channel 1.
+ */
+void test_strided__two_channels(void) {
+  static uint8_t interleaved[2*FIXTURE_DTMF_BUFLEN];
+  const int buf_stride = 2*200;
+
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    dtmf_decoder_t decoders[2];
+
+    setUp();
+    rx2_down_cursor = 0;
+    rx2_up_cursor = 0;
+    rx2_down[0] = 0;
+    rx2_up[0] = 0;
+
+    for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i++) {
+      interleaved[2*i] = fixture_dtmf_buffer[i];
+      interleaved[2*i+1] = 127;
+    }
+
+    dtmf_decoder_init(&decoders[0], FIXTURE_DTMF_FS, 0.5, button_down, button_up, backend);
+    dtmf_decoder_init(&decoders[1], FIXTURE_DTMF_FS, 0.5, button_down2, button_up2, backend);
+
+    for (int i = 0; i < 2*FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+      uint16_t l = 2*FIXTURE_DTMF_BUFLEN - i;
+      l = (l > buf_stride ? buf_stride : l);
+
+      dtmf_decoder_process_strided(decoders, 2, interleaved+i, l);
+    }
+    dtmf_decoder_process_strided(decoders, 2, NULL, 0);
+
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+    TEST_ASSERT_EQUAL_STRING("", rx2_down);
+    TEST_ASSERT_EQUAL_STRING("", rx2_up);
+  }
+}
+
+/**
+ * Resetting a decoder mid-symbol should drop it without a button up
+ */
+void test_decoder__reset(void) {
+  dtmf_decoder_t dec;
+
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, button_down, button_up, DTMF_BACKEND_FLOAT);
+
+  // Find the first buffer that produces a button down
+  int i;
+  for (i = 0; i < FIXTURE_DTMF_BUFLEN && rx_down_cursor == 0; i += 200) {
+    dtmf_decoder_process(&dec, fixture_dtmf_buffer+i, 200);
+  }
+  TEST_ASSERT_EQUAL_INT(1, rx_down_cursor);
+  TEST_ASSERT_EQUAL(fixture_dtmf_symbols[0], dec.state.cur_symbol);
+
+  dtmf_decoder_reset(&dec);
+  TEST_ASSERT_EQUAL(DTMF_SYMBOL_NONE, dec.state.cur_symbol);
+
+  dtmf_decoder_process(&dec, NULL, 0);
+  TEST_ASSERT_EQUAL_STRING("", rx_up);
+}
+
+/**
+ * Run the fixture through the default decoder in streaming mode
+ */
+static void decode_fixture_stream(dtmf_backend_t backend, uint16_t window_len, uint16_t hop,
+                                  const int16_t *window, int buf_stride) {
+  dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, backend);
+  TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_set_window(window_len, hop, window));
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > buf_stride ? buf_stride : l);
+
+    dtmf_process((const uint8_t*)fixture_dtmf_buffer+i, l);
+  }
+  dtmf_process(NULL, 0);
+}
+
+/**
+ * The decisions should only depend on the window and hop, not on
+ * how the samples are chopped up on the way in.
+ */
+void test_stream__buffer_size_independent(void) {
+  const int strides[] = { 1, 37, 64, 200, 1024, FIXTURE_DTMF_BUFLEN };
+  char errmsg[32];
+
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    for (size_t k = 0; k < sizeof(strides)/sizeof(strides[0]); k++) {
+      snprintf(errmsg, sizeof(errmsg), "backend %d stride %d", backend, strides[k]);
+
+      setUp();
+      decode_fixture_stream(backend, 200, 100, NULL, strides[k]);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(fixture_dtmf_symbols, rx_down, errmsg);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(fixture_dtmf_symbols, rx_up, errmsg);
+    }
+  }
+}
+
+/**
+ * With hop == window_len and no window, streaming should match
+ * handing over buffers of exactly that size.
+ */
+void test_stream__matches_block(void) {
+  uint8_t block_down[DUMMY_LEN];
+  uint8_t block_up[DUMMY_LEN];
+
+  decode_fixture(DTMF_BACKEND_FLOAT, 200);
+  memcpy(block_down, rx_down, DUMMY_LEN);
+  memcpy(block_up, rx_up, DUMMY_LEN);
+
+  setUp();
+  decode_fixture_stream(DTMF_BACKEND_FLOAT, 200, 200, NULL, 64);
+  TEST_ASSERT_EQUAL_STRING(block_down, rx_down);
+  TEST_ASSERT_EQUAL_STRING(block_up, rx_up);
+}
+
+void test_stream__hann_overlap(void) {
+  static int16_t hann[256];
+  dtmf_window_hann(hann, 256);
+
+  TEST_ASSERT_EQUAL_INT16(0, hann[0]);
+  TEST_ASSERT_EQUAL_INT16(32767, hann[128]);
+  TEST_ASSERT_EQUAL_INT16(hann[1], hann[255]);
+
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    setUp();
+    decode_fixture_stream(backend, 256, 128, hann, 1024);
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+
+    setUp();
+    decode_fixture_stream(backend, 256, 128, hann, 50);
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+  }
+}
+
+void test_stream__invalid_inputs(void) {
+  int16_t zeros[16] = { 0 };
+
+  dtmf_init(FIXTURE_DTMF_FS, 0.5, button_down, button_up);
+
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_set_window(256, 0, NULL));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_set_window(256, 100, NULL));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_set_window(256, 256/(DTMF_MAX_OVERLAP*2), NULL));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_set_window(16, 8, zeros));
+
+  TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_set_window(256, 256/DTMF_MAX_OVERLAP, NULL));
+  TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_set_window(0, 0, NULL));
+}
+
+/**
+ * Batch decoding should find the same symbols as the callbacks do,
+ * with durations matching the dt's passed to button_up.
+ */
+void test_decode_buffer__fixture(void) {
+  dtmf_decoder_t dec;
+  dtmf_event_t events[32];
+  uint16_t n_events = 0xFFFF;
+  char symbols[33];
+
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, backend);
+
+    TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_decode_buffer(&dec, fixture_dtmf_buffer, FIXTURE_DTMF_BUFLEN, 200,
+                                                    events, 32, &n_events));
+    TEST_ASSERT_EQUAL(strlen(fixture_dtmf_symbols), n_events);
+
+    for (int i = 0; i < n_events; i++) {
+      symbols[i] = events[i].symbol;
+
+      TEST_ASSERT_EQUAL(0, events[i].start % 200);
+      TEST_ASSERT_GREATER_THAN(0, events[i].duration);
+      if (i > 0) {
+        TEST_ASSERT_GREATER_OR_EQUAL(events[i-1].start + events[i-1].duration, events[i].start);
+      }
+    }
+    symbols[n_events] = 0;
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, symbols);
+  }
+
+  // The callbacks still work alongside the event log
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, button_down, button_up, DTMF_BACKEND_FLOAT);
+  TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_decode_buffer(&dec, fixture_dtmf_buffer, FIXTURE_DTMF_BUFLEN, 256,
+                                                  events, 32, &n_events));
+  TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+  TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+  TEST_ASSERT_NULL(dec.state.events);
+}
+
+void test_decode_buffer__overflow(void) {
+  dtmf_decoder_t dec;
+  dtmf_event_t events[4];
+  uint16_t n_events;
+
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, DTMF_BACKEND_FLOAT);
+
+  TEST_ASSERT_EQUAL(DTMF_EVENTS_OVERFLOW, dtmf_decode_buffer(&dec, fixture_dtmf_buffer, FIXTURE_DTMF_BUFLEN, 200,
+                                                             events, 4, &n_events));
+  TEST_ASSERT_EQUAL(4, n_events);
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(fixture_dtmf_symbols[i], events[i].symbol);
+    TEST_ASSERT_GREATER_THAN(0, events[i].duration);
+  }
+}
+
+void test_decode_buffer__invalid(void) {
+  dtmf_decoder_t dec;
+  dtmf_event_t events[4];
+  uint16_t n_events;
+
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, DTMF_BACKEND_FLOAT);
+
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decode_buffer(NULL, fixture_dtmf_buffer, 200, 200, events, 4, &n_events));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decode_buffer(&dec, NULL, 200, 200, events, 4, &n_events));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decode_buffer(&dec, fixture_dtmf_buffer, 200, 0, events, 4, &n_events));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decode_buffer(&dec, fixture_dtmf_buffer, 200, 200, NULL, 4, &n_events));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decode_buffer(&dec, fixture_dtmf_buffer, 200, 200, events, 4, NULL));
+
+  // An empty recording is fine, though
+  TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_decode_buffer(&dec, NULL, 0, 200, events, 4, &n_events));
+  TEST_ASSERT_EQUAL(0, n_events);
+}
+
+//////////////////////////////
+// 12b samples
+
+static uint16_t fixture16[FIXTURE_DTMF_BUFLEN];
+
+/**
+ * Widen the fixture to 12b, as a 12b ADC would have seen it, then
+ * move it to the given bias point
+ */
+static void fill_fixture16(int32_t shift) {
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i++) {
+    fixture16[i] = fixture_dtmf_buffer[i]*16 + 8 + shift;
+  }
+}
+
+/**
+ * Run the 12b fixture through the default decoder
+ */
+static void decode_fixture16(int buf_stride) {
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= buf_stride) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > buf_stride ? buf_stride : l);
+
+    dtmf_process16(fixture16+i, l);
+  }
+  dtmf_process16(NULL, 0);
+}
+
+void test_process16__fixture(void) {
+  static int16_t hann[256];
+  dtmf_window_hann(hann, 256);
+
+  fill_fixture16(0);
+
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    for (int streaming = 0; streaming < 2; streaming++) {
+      setUp();
+      dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, backend);
+      TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_set_calibration(127*16+8, 127*16, false));
+      if (streaming) {
+        TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_set_window(256, 128, hann));
+      }
+
+      decode_fixture16(200);
+
+      TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+      TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+    }
+  }
+}
+
+/**
+ * The ADC callback version takes its length in bytes
+ */
+void test_process16__adc_callback(void) {
+  fill_fixture16(0);
+
+  dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, DTMF_BACKEND_FIXED);
+  dtmf_set_calibration(127*16+8, 127*16, false);
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= 200) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > 200 ? 200 : l);
+
+    dtmf_process_adc16((const uint8_t *)(fixture16+i), 2*l);
+  }
+  dtmf_process_adc16(NULL, 0);
+
+  TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+  TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+}
+
+/**
+ * The two backends should agree on the magnitudes they report
+ */
+void test_process16__magnitudes_match_8b(void) {
+  dtmf_decoder_t dec8, dec16;
+  dtmf_event_t events8[32], events16[32];
+  uint16_t n8, n16;
+
+  fill_fixture16(0);
+
+  dtmf_decoder_init(&dec8, FIXTURE_DTMF_FS, 0.5, NULL, NULL, DTMF_BACKEND_FIXED);
+  dtmf_decode_buffer(&dec8, fixture_dtmf_buffer, FIXTURE_DTMF_BUFLEN, 200, events8, 32, &n8);
+
+  dtmf_decoder_init(&dec16, FIXTURE_DTMF_FS, 0.5, NULL, NULL, DTMF_BACKEND_FIXED);
+  dtmf_decoder_set_calibration(&dec16, 127*16+7.5, 127*16, false);
+  dec16.state.events = events16;
+  dec16.state.max_events = 32;
+
+  for (int i = 0; i < FIXTURE_DTMF_BUFLEN; i+= 200) {
+    uint16_t l = FIXTURE_DTMF_BUFLEN - i;
+    l = (l > 200 ? 200 : l);
+
+    dtmf_decoder_process16(&dec16, fixture16+i, l);
+  }
+  dtmf_decoder_process16(&dec16, NULL, 0);
+  n16 = dec16.state.n_events;
+
+  TEST_ASSERT_EQUAL(n8, n16);
+  for (int i = 0; i < n8; i++) {
+    TEST_ASSERT_EQUAL(events8[i].symbol, events16[i].symbol);
+    TEST_ASSERT_EQUAL(events8[i].start, events16[i].start);
+    TEST_ASSERT_FLOAT_WITHIN(0.01*events8[i].power, events8[i].power, events16[i].power);
+  }
+}
+
+void test_calibrate16(void) {
+  dtmf_decoder_t dec;
+  uint16_t flat[100];
+
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, DTMF_BACKEND_FLOAT);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, DTMF_OFFSET16_DEFAULT, dec.state.offset16);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, DTMF_SCALE16_DEFAULT, dec.state.scale16);
+
+  for (int i = 0; i < 100; i++) {
+    flat[i] = 1000 + (i & 1); // Mean of 1000.5
+  }
+  TEST_ASSERT_EQUAL(DTMF_OKAY, dtmf_decoder_calibrate16(&dec, flat, 100));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 1000.5, dec.state.offset16);
+  TEST_ASSERT_EQUAL(1000.5 * (1 << DTMF_SAMPLE_SHIFT16), dec.state.offset16_q);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, DTMF_SCALE16_DEFAULT, dec.state.scale16);
+
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decoder_calibrate16(NULL, flat, 100));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decoder_calibrate16(&dec, NULL, 100));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decoder_calibrate16(&dec, flat, 0));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decoder_set_calibration(&dec, 2048, 0, false));
+  TEST_ASSERT_EQUAL(DTMF_INVALID_INPUTS, dtmf_decoder_set_calibration(NULL, 2048, 2047, false));
+}
+
+/**
+ * With tracking on, a decoder that starts with the wrong offset should
+ * find the right one, and still decode everything.
+ */
+void test_track_offset16(void) {
+  dtmf_decoder_t dec;
+  uint16_t flat[200];
+
+  for (int i = 0; i < 200; i++) {
+    flat[i] = 1000;
+  }
+
+  dtmf_decoder_init(&dec, FIXTURE_DTMF_FS, 0.5, NULL, NULL, DTMF_BACKEND_FIXED);
+  dtmf_decoder_process16(&dec, flat, 200);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, DTMF_OFFSET16_DEFAULT, dec.state.offset16);
+
+  dtmf_decoder_set_calibration(&dec, DTMF_OFFSET16_DEFAULT, DTMF_SCALE16_DEFAULT, true);
+  dtmf_decoder_process16(&dec, flat, 200);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 2048 - (2048-1000)/(float)(1 << DTMF_OFFSET_TRACK_SHIFT), dec.state.offset16);
+
+  for (int i = 0; i < 40 << DTMF_OFFSET_TRACK_SHIFT; i++) {
+    dtmf_decoder_process16(&dec, flat, 200);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 1000, dec.state.offset16);
+
+  // And a fixture well off center, starting from mid-scale
+  for (int backend = DTMF_BACKEND_FLOAT; backend <= DTMF_BACKEND_FIXED; backend++) {
+    setUp();
+    fill_fixture16(-800);
+
+    dtmf_init_backend(FIXTURE_DTMF_FS, 0.5, button_down, button_up, backend);
+    dtmf_set_calibration(DTMF_OFFSET16_DEFAULT, 127*16, true);
+
+    decode_fixture16(200);
+
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_down);
+    TEST_ASSERT_EQUAL_STRING(fixture_dtmf_symbols, rx_up);
+  }
+}
+
 //////////////////////////////
 // dtmf tests
 
@@ -197,6 +754,31 @@ int main(int argc, char *argv[]) {
   RUN_TEST(test_happy_path);
   RUN_TEST(test_all_zeros);
 
+  RUN_TEST(test_goertzel_matches_reference);
+
+  RUN_TEST(test_fixed__happy_path);
+  RUN_TEST(test_fixed__matches_float);
+  RUN_TEST(test_fixed__magnitudes);
+  RUN_TEST(test_fixed__all_zeros);
+
+  RUN_TEST(test_strided__two_channels);
+  RUN_TEST(test_decoder__reset);
+
+  RUN_TEST(test_stream__buffer_size_independent);
+  RUN_TEST(test_stream__matches_block);
+  RUN_TEST(test_stream__hann_overlap);
+  RUN_TEST(test_stream__invalid_inputs);
+
+  RUN_TEST(test_decode_buffer__fixture);
+  RUN_TEST(test_decode_buffer__overflow);
+  RUN_TEST(test_decode_buffer__invalid);
+
+  RUN_TEST(test_process16__fixture);
+  RUN_TEST(test_process16__adc_callback);
+  RUN_TEST(test_process16__magnitudes_match_8b);
+  RUN_TEST(test_calibrate16);
+  RUN_TEST(test_track_offset16);
+
   RUN_TEST(test_get_tones__invalid_inputs);
   RUN_TEST(test_get_tones__missing_symbol);
   RUN_TEST(test_get_tones__happy_path);
@@ -0,0 +1,221 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "unity.h"
+
+#include "goertzel.h"
+
+//! Our test dummy
+static goertzel_bank_t test_bank;
+
+#define TEST_FS 8000.0 //!< Sample rate used for all the tests
+#define TEST_N 800 //!< Number of samples in our test buffers (100ms)
+
+static uint8_t test_buf8[TEST_N];
+static uint8_t test_buf16[2*TEST_N];
+static uint8_t test_interleaved[3*TEST_N];
+
+static const float test_freqs[] = { 400, 1000, 1210, 2500 };
+
+//////////////////////////////////////////////////////////////////////
+// Unity requires a setUp and tearDown function.
+
+/**
+ * Blank out our bank and buffers
+ */
+void setUp(void) {
+  memset(&test_bank, 0xAA, sizeof(goertzel_bank_t));
+  memset(test_buf8, 0, sizeof(test_buf8));
+  memset(test_buf16, 0, sizeof(test_buf16));
+  memset(test_interleaved, 0, sizeof(test_interleaved));
+}
+
+/**
+ * There is nothing to tear down in this set of tests.
+ */
+void tearDown(void) {}
+
+//////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+ * Fill an 8b buffer with a sine wave centered on the given offset
+ */
+static void fill_sine8(uint8_t *buf, uint8_t stride, float f, float amplitude, float offset) {
+  for (int i = 0; i < TEST_N; i++) {
+    buf[i*stride] = lroundf(offset + amplitude * sinf(2 * M_PI * f * i / TEST_FS));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// The test case implementations
+
+void test_init__invalid(void) {
+  TEST_ASSERT_EQUAL(GOERTZEL_INVALID_INPUTS, goertzel_bank_init(NULL, TEST_FS, test_freqs, 4));
+  TEST_ASSERT_EQUAL(GOERTZEL_INVALID_INPUTS, goertzel_bank_init(&test_bank, TEST_FS, NULL, 4));
+  TEST_ASSERT_EQUAL(GOERTZEL_INVALID_INPUTS, goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 0));
+  TEST_ASSERT_EQUAL(GOERTZEL_INVALID_INPUTS, goertzel_bank_init(&test_bank, 0, test_freqs, 4));
+
+  float negative[] = { 100, -100 };
+  TEST_ASSERT_EQUAL(GOERTZEL_INVALID_INPUTS, goertzel_bank_init(&test_bank, TEST_FS, negative, 2));
+  TEST_ASSERT_EQUAL(0, test_bank.n_bins);
+
+  float many[GOERTZEL_MAX_BINS+1] = { 0 };
+  TEST_ASSERT_EQUAL(GOERTZEL_TOO_MANY_BINS, goertzel_bank_init(&test_bank, TEST_FS, many, GOERTZEL_MAX_BINS+1));
+
+  float nyquist[] = { 100, TEST_FS/2 };
+  TEST_ASSERT_EQUAL(GOERTZEL_UNDERSAMPLED, goertzel_bank_init(&test_bank, TEST_FS, nyquist, 2));
+  TEST_ASSERT_EQUAL(0, test_bank.n_bins);
+}
+
+void test_init__happy_path(void) {
+  TEST_ASSERT_EQUAL(GOERTZEL_OKAY, goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 4));
+
+  TEST_ASSERT_EQUAL(4, test_bank.n_bins);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, TEST_FS, test_bank.Fs);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1000, test_bank.freqs[1]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 2*cosf(2*M_PI*1000/TEST_FS), test_bank.coef[1]);
+}
+
+void test_status_name(void) {
+  TEST_ASSERT_EQUAL_STRING("OKAY", goertzel_status_name(GOERTZEL_OKAY));
+  TEST_ASSERT_EQUAL_STRING("UNDERSAMPLED", goertzel_status_name(GOERTZEL_UNDERSAMPLED));
+  TEST_ASSERT_NULL(goertzel_status_name(99));
+}
+
+/**
+ * A single tone should show up at its amplitude in its own bin, and
+ * not much anywhere else, regardless of the DC offset.
+ */
+void test_run__single_tone(void) {
+  float amps[4];
+
+  goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 4);
+
+  fill_sine8(test_buf8, 1, 1000, 100, 127);
+  goertzel_bank_run(&test_bank, test_buf8, 1, 1, TEST_N, amps);
+
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 100, amps[1]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[3]);
+
+  // Same thing, with the ADC biased way off center
+  fill_sine8(test_buf8, 1, 1000, 50, 200);
+  goertzel_bank_run(&test_bank, test_buf8, 1, 1, TEST_N, amps);
+
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 50, amps[1]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[3]);
+}
+
+/**
+ * 12b samples come in 16b little endian words
+ */
+void test_run__16bit(void) {
+  float amps[4];
+
+  goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 4);
+
+  for (int i = 0; i < TEST_N; i++) {
+    uint16_t x = lroundf(2048 + 1500 * sinf(2 * M_PI * 2500 * i / TEST_FS));
+    test_buf16[2*i] = x & 0xFF;
+    test_buf16[2*i+1] = x >> 8;
+  }
+  goertzel_bank_run(&test_bank, test_buf16, 2, 1, TEST_N, amps);
+
+  TEST_ASSERT_FLOAT_WITHIN(5.0, 1500, amps[3]);
+  TEST_ASSERT_FLOAT_WITHIN(5.0, 0, amps[0]);
+  TEST_ASSERT_FLOAT_WITHIN(5.0, 0, amps[1]);
+}
+
+/**
+ * Each channel of an interleaved buffer should only see its own tone
+ */
+void test_run__interleaved(void) {
+  float amps[3][4];
+
+  goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 4);
+
+  fill_sine8(test_interleaved+0, 3, 400, 60, 127);
+  fill_sine8(test_interleaved+1, 3, 1210, 90, 127);
+  fill_sine8(test_interleaved+2, 3, 2500, 30, 127);
+
+  for (int ch = 0; ch < 3; ch++) {
+    goertzel_bank_run(&test_bank, test_interleaved+ch, 1, 3, TEST_N, amps[ch]);
+  }
+
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 60, amps[0][0]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[0][2]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 90, amps[1][2]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[1][0]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 30, amps[2][3]);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 0, amps[2][2]);
+}
+
+void test_run__silence(void) {
+  float amps[4] = { 1, 1, 1, 1 };
+
+  goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 4);
+
+  memset(test_buf8, 0x80, TEST_N);
+  goertzel_bank_run(&test_bank, test_buf8, 1, 1, TEST_N, amps);
+  for (int bin = 0; bin < 4; bin++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, amps[bin]);
+  }
+
+  amps[0] = 1;
+  goertzel_bank_run(&test_bank, test_buf8, 1, 1, 0, amps);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, amps[0]);
+}
+
+/**
+ * The integer kernel should agree with the float one, for both widths
+ */
+void test_run_fixed__matches_float(void) {
+  float amps[4];
+  float amps_q[4];
+
+  goertzel_bank_init(&test_bank, TEST_FS, test_freqs, 4);
+
+  fill_sine8(test_interleaved+1, 3, 1210, 90, 140);
+  goertzel_bank_run(&test_bank, test_interleaved+1, 1, 3, TEST_N, amps);
+  goertzel_bank_run_fixed(&test_bank, test_interleaved+1, 1, 3, TEST_N, amps_q);
+
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 90, amps_q[2]);
+  for (int bin = 0; bin < 4; bin++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.5, amps[bin], amps_q[bin]);
+  }
+
+  for (int i = 0; i < TEST_N; i++) {
+    uint16_t x = lroundf(2048 + 1500 * sinf(2 * M_PI * 400 * i / TEST_FS));
+    test_buf16[2*i] = x & 0xFF;
+    test_buf16[2*i+1] = x >> 8;
+  }
+  goertzel_bank_run(&test_bank, test_buf16, 2, 1, TEST_N, amps);
+  goertzel_bank_run_fixed(&test_bank, test_buf16, 2, 1, TEST_N, amps_q);
+
+  TEST_ASSERT_FLOAT_WITHIN(5.0, 1500, amps_q[0]);
+  for (int bin = 0; bin < 4; bin++) {
+    TEST_ASSERT_FLOAT_WITHIN(2.0, amps[bin], amps_q[bin]);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Actual test runner
+
+int main(int argc, char *argv[]) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_init__invalid);
+  RUN_TEST(test_init__happy_path);
+  RUN_TEST(test_status_name);
+
+  RUN_TEST(test_run__single_tone);
+  RUN_TEST(test_run__16bit);
+  RUN_TEST(test_run__interleaved);
+  RUN_TEST(test_run__silence);
+  RUN_TEST(test_run_fixed__matches_float);
+
+  return UNITY_END();
+}
@@ -17,6 +17,8 @@ uint8_t G_rx_addr;
 uint8_t G_rx_control;
 uint8_t G_rx_fcs_match;
 
+uint16_t G_rx_digest; //!< FCS over every payload parsed, to compare parser runs
+
 uint8_t G_too_long_count;
 uint8_t G_pkt_interrupted_count;
 
@@ -48,6 +50,7 @@ static void parse_cb(uint8_t *buf, uint16_t buflen, uint8_t addr, uint8_t contro
   G_rx_addr = addr;
   G_rx_control = control;
   G_rx_fcs_match = fcs_match;
+  G_rx_digest = packet_fcs(buf, buflen, G_rx_digest ^ fcs_match);
 
   //  dump_buf("G_rx_buf", G_rx_buf, buflen);
   printf("\n");
@@ -72,6 +75,7 @@ void reset_globals(void) {
   G_rx_addr = '*';
   G_rx_control = '$';
   G_rx_fcs_match = 0;
+  G_rx_digest = PACKET_FCS_INITIAL;
 
   G_too_long_count = 0;
   G_pkt_interrupted_count = 0;
@@ -147,6 +151,47 @@ void test_string_sets(void) {
   }
 }
 
+/**
+ * Bit at a time FCS, as in Framer.fcs(), to check the tables against
+ */
+static uint16_t reference_fcs(const uint8_t *buf, uint16_t buflen, uint16_t crc) {
+  for (int i = 0; i < buflen; i++) {
+    uint8_t x = buf[i];
+    for (int j = 0; j < 8; j++) {
+      crc = ((crc&1)^(x&1)) ? (crc>>1)^0x8408 : crc>>1;
+      x >>= 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * Every length and alignment, in one go or a byte at a time, should
+ * match the bitwise FCS, whichever PACKET_FCS_SLICES we're built with
+ */
+void test_fcs_matches_reference(void) {
+  uint8_t buf[67];
+  uint32_t lfsr = 0xACE1;
+
+  for (unsigned i = 0; i < sizeof(buf); i++) {
+    lfsr = lfsr * 1103515245 + 12345;
+    buf[i] = lfsr >> 16;
+  }
+
+  for (int start = 0; start < 8; start++) {
+    for (int len = 0; len + start <= (int)sizeof(buf); len++) {
+      uint16_t expected = reference_fcs(buf+start, len, PACKET_FCS_INITIAL);
+      TEST_ASSERT_EQUAL(expected, packet_fcs(buf+start, len, PACKET_FCS_INITIAL));
+
+      uint16_t crc = PACKET_FCS_INITIAL;
+      for (int k = 0; k < len; k++) crc = packet_fcs(buf+start+k, 1, crc);
+      TEST_ASSERT_EQUAL(expected, crc);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(reference_fcs(buf, 13, 0x1234), packet_fcs(buf, 13, 0x1234));
+}
+
 struct framing_case {
   uint8_t *buf;
   uint16_t len;
@@ -181,7 +226,11 @@ void test_packet_framing() {
 };
 
 
-void test_packet_parsing() {
+/**
+ * Run the parsing cases through either packet_rx_byte() or
+ * packet_rx_buffer()
+ */
+static void run_packet_parsing(int bulk) {
 #undef NCASES
 #define NCASES 3
   struct framing_case cases [NCASES] = {
@@ -199,12 +248,16 @@ void test_packet_parsing() {
     reset_globals();
     memset(G_buf, '!', 1024);
 
-    for (int j = 0; j < cases[i].expected_len; j++) {
-      uint8_t x = cases[i].expected[j];
-      packet_rx_byte(x);
+    if (bulk) {
+      packet_rx_buffer(cases[i].expected, cases[i].expected_len);
+    } else {
+      for (int j = 0; j < cases[i].expected_len; j++) {
+        uint8_t x = cases[i].expected[j];
+        packet_rx_byte(x);
 
-      printf("%s %3d] %02x -> %14s: ", caseno, j, x, parser_state_name());
-      dump_buf(caseno, G_buf, cases[i].expected_len);
+        printf("%s %3d] %02x -> %14s: ", caseno, j, x, parser_state_name());
+        dump_buf(caseno, G_buf, cases[i].expected_len);
+      }
     }
     TEST_ASSERT_EQUAL_MESSAGE(1, G_frames_parsed, caseno);
     TEST_ASSERT_EQUAL_MESSAGE(G_buf+1+1+1+2, G_rx_buf, caseno); // We expect that our rx buf is the buf we passed in
@@ -220,6 +273,14 @@ void test_packet_parsing() {
   }
 }
 
+void test_packet_parsing() {
+  run_packet_parsing(0);
+}
+
+void test_packet_parsing_bulk() {
+  run_packet_parsing(1);
+}
+
 struct rt_case {
   char *buf;
   uint16_t buflen;
@@ -288,6 +349,245 @@ void test_packet_roundtrip() {
   }
 }
 
+/**
+ * A long stream of frames, noise, and interrupted frames should parse
+ * the same through packet_rx_buffer() as through packet_rx_byte(), no
+ * matter how it's chunked up
+ */
+void test_packet_rx_buffer_matches_bytewise() {
+  static uint8_t stream[4096];
+  uint16_t stream_len = 0;
+  uint8_t payload[600];
+  uint32_t lfsr = 12345;
+
+  for (int k = 0; k < 8; k++) {
+    uint16_t len = 50 + 70*k;
+    uint16_t escaped_len = 0;
+    for (int i = 0; i < len; i++) {
+      lfsr = lfsr * 1103515245 + 12345;
+      payload[i] = lfsr >> 16;
+      if (0 == (i % 37)) payload[i] = (k & 1) ? PACKET_FLAG : PACKET_ESCAPE;
+      escaped_len += (payload[i] == PACKET_FLAG || payload[i] == PACKET_ESCAPE) ? 2 : 1;
+    }
+
+    // packet_frame() only leaves room for an unescaped length, so
+    // steer clear of lengths that would need escaping
+    while ((escaped_len & 0xFF) == PACKET_FLAG || (escaped_len & 0xFF) == PACKET_ESCAPE) {
+      len--;
+      escaped_len -= (payload[len] == PACKET_FLAG || payload[len] == PACKET_ESCAPE) ? 2 : 1;
+    }
+
+    stream[stream_len++] = 'x';  // Line noise while idle
+    stream_len += packet_frame(stream + stream_len, payload, len, 'a' + k, k);
+
+    if (3 == k) {  // Chop a frame off partway, so the next one interrupts it
+      stream_len += packet_frame(stream + stream_len, payload, 40, 'z', 0) - 20;
+    }
+  }
+
+  setUp();
+  for (int i = 0; i < stream_len; i++) packet_rx_byte(stream[i]);
+
+  uint32_t frames = G_frames_parsed;
+  uint16_t digest = G_rx_digest;
+  uint8_t interrupted = G_pkt_interrupted_count;
+
+  // Noise straight after a closing flag looks like the start of a new
+  // frame, so all but one of the 'x's interrupt one, as does the chop.
+  TEST_ASSERT_EQUAL(8, frames);
+  TEST_ASSERT_EQUAL(7, interrupted);
+
+  const uint16_t chunks[] = { 1, 3, 7, 64, 500, 4096 };
+  for (unsigned c = 0; c < sizeof(chunks)/sizeof(chunks[0]); c++) {
+    setUp();  // Both the globals and the parser
+
+    for (uint16_t i = 0; i < stream_len; i += chunks[c]) {
+      uint16_t n = (stream_len - i < chunks[c]) ? stream_len - i : chunks[c];
+      packet_rx_buffer(stream + i, n);
+    }
+
+    TEST_ASSERT_EQUAL(frames, G_frames_parsed);
+    TEST_ASSERT_EQUAL(digest, G_rx_digest);
+    TEST_ASSERT_EQUAL(interrupted, G_pkt_interrupted_count);
+    TEST_ASSERT_EQUAL(1, G_rx_fcs_match);
+  }
+}
+
+static uint8_t G_link_b_addr; //!< Address of the last packet on link B
+static uint16_t G_link_b_buflen; //!< Length of the last packet on link B
+static uint8_t G_link_b_fcs_match; //!< Whether it checked out
+
+static void link_b_cb(uint8_t *buf, uint16_t buflen, uint8_t addr, uint8_t control, uint8_t fcs_match) {
+  G_link_b_addr = addr;
+  G_link_b_buflen = buflen;
+  G_link_b_fcs_match = fcs_match;
+}
+
+/**
+ * Two parser instances, fed interleaved bytes from two links, should
+ * each get their own packet with their own callback
+ */
+void test_parser_instances() {
+  packet_parser_data_t link_a, link_b;
+  uint8_t buf_a[128], buf_b[128];
+  uint8_t frame_a[64], frame_b[64];
+
+  uint16_t len_a = packet_frame(frame_a, (const uint8_t *)"Hello ~}link", 12, 'A', 0);
+  uint16_t len_b = packet_frame(frame_b, (const uint8_t *)"B", 1, 'B', 0);
+
+  reset_globals();
+  G_link_b_buflen = 0;
+  packet_parser_init(&link_a, parse_cb, buf_a, sizeof(buf_a));
+  packet_parser_init(&link_b, link_b_cb, buf_b, sizeof(buf_b));
+
+  for (int i = 0; i < len_a || i < len_b; i++) {
+    if (i < len_a) packet_parser_rx_byte(&link_a, frame_a[i]);
+    if (i < len_b) packet_parser_rx_buffer(&link_b, frame_b + i, 1);
+  }
+
+  TEST_ASSERT_EQUAL(1, G_frames_parsed);
+  TEST_ASSERT_EQUAL('A', G_rx_addr);
+  TEST_ASSERT_EQUAL(12, G_rx_buflen);
+  TEST_ASSERT_EQUAL(1, G_rx_fcs_match);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY("Hello ~}link", G_rx_buf, 12);
+  TEST_ASSERT_TRUE(G_rx_buf >= buf_a && G_rx_buf < buf_a + sizeof(buf_a));
+
+  TEST_ASSERT_EQUAL('B', G_link_b_addr);
+  TEST_ASSERT_EQUAL(1, G_link_b_buflen);
+  TEST_ASSERT_EQUAL(1, G_link_b_fcs_match);
+  TEST_ASSERT_EQUAL('B', buf_b[5]);
+
+  // And the built-in parser was left alone
+  TEST_ASSERT_EQUAL_STRING("IDLE", parser_state_name());
+}
+
+/**
+ * A parser with a small buffer should drop frames that don't fit it,
+ * through the too-long callback, without writing past its end
+ */
+void test_parser_small_buffer() {
+  packet_parser_data_t link;
+  uint8_t buf[32 + 8];
+  uint8_t frame[64];
+  uint8_t payload[26];
+  uint8_t canary[8];
+
+  memset(payload, 'x', sizeof(payload));
+  memset(canary, 0xA5, sizeof(canary));
+
+  for (int bulk = 0; bulk < 2; bulk++) {
+    // Only the first 32 bytes are the parser's, the rest are a canary
+    memset(buf, 0xA5, sizeof(buf));
+    reset_globals();
+    packet_parser_init(&link, parse_cb, buf, 32);
+    packet_parser_register_too_long_cb(&link, too_long_cb);
+
+    // 25 bytes of payload fill the buffer exactly...
+    uint16_t len = packet_frame(frame, payload, 25, 'A', 0);
+    if (bulk) {
+      packet_parser_rx_buffer(&link, frame, len);
+    } else {
+      for (int i = 0; i < len; i++) packet_parser_rx_byte(&link, frame[i]);
+    }
+
+    TEST_ASSERT_EQUAL(1, G_frames_parsed);
+    TEST_ASSERT_EQUAL(25, G_rx_buflen);
+    TEST_ASSERT_EQUAL(1, G_rx_fcs_match);
+    TEST_ASSERT_EQUAL(0, G_too_long_count);
+
+    // ... and one more is too many
+    len = packet_frame(frame, payload, 26, 'A', 0);
+    if (bulk) {
+      packet_parser_rx_buffer(&link, frame, len);
+    } else {
+      for (int i = 0; i < len; i++) packet_parser_rx_byte(&link, frame[i]);
+    }
+
+    TEST_ASSERT_EQUAL(1, G_frames_parsed);
+    TEST_ASSERT_EQUAL(1, G_too_long_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(canary, buf + 32, sizeof(canary));
+  }
+}
+
+static uint8_t G_tx_buf[1024]; //!< Where the streaming framer's output goes
+static uint16_t G_tx_len; //!< How much of G_tx_buf is used
+
+static void tx_cb(const uint8_t *buf, uint16_t buflen) {
+  memcpy(G_tx_buf + G_tx_len, buf, buflen);
+  G_tx_len += buflen;
+}
+
+/**
+ * The streaming framer should produce exactly what packet_frame()
+ * does, however the payload is split up
+ */
+void test_packet_framer_matches_frame() {
+  const char *msg = "Log line with ~flags~ and }escapes} in it";
+  const uint16_t msglen = strlen(msg);
+  uint8_t expected[128];
+  uint16_t expected_len = packet_frame(expected, (const uint8_t *)msg, msglen, 'L', 'I');
+
+  TEST_ASSERT_EQUAL(msglen + 4, packet_escaped_len((const uint8_t *)msg, msglen));
+
+  for (uint16_t piece = 1; piece <= msglen; piece++) {
+    packet_framer_t framer;
+
+    G_tx_len = 0;
+    packet_framer_begin(&framer, tx_cb, 'L', 'I', packet_escaped_len((const uint8_t *)msg, msglen));
+    for (uint16_t i = 0; i < msglen; i += piece) {
+      uint16_t n = (msglen - i < piece) ? msglen - i : piece;
+      packet_framer_append(&framer, (const uint8_t *)msg + i, n);
+    }
+    TEST_ASSERT_EQUAL(1, packet_framer_end(&framer));
+
+    TEST_ASSERT_EQUAL(expected_len, G_tx_len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, G_tx_buf, expected_len);
+  }
+}
+
+/**
+ * The framer escapes the header too, including the length, and the
+ * parser should take it all back apart
+ */
+void test_packet_framer_roundtrip() {
+  uint8_t payload[121];
+  packet_framer_t framer;
+
+  // 116 plain bytes and 5 flags escape out to 126 bytes: 0x7E, a flag
+  memset(payload, 'a', sizeof(payload));
+  for (int i = 0; i < 5; i++) payload[20*i] = PACKET_FLAG;
+  uint16_t escaped_len = packet_escaped_len(payload, sizeof(payload));
+  TEST_ASSERT_EQUAL(PACKET_FLAG, escaped_len);
+
+  G_tx_len = 0;
+  packet_framer_begin(&framer, tx_cb, PACKET_ESCAPE, PACKET_FLAG, escaped_len);
+  packet_framer_append(&framer, payload, 50);
+  packet_framer_append(&framer, payload + 50, sizeof(payload) - 50);
+  TEST_ASSERT_EQUAL(1, packet_framer_end(&framer));
+
+  setUp();
+  packet_rx_buffer(G_tx_buf, G_tx_len);
+
+  TEST_ASSERT_EQUAL(1, G_frames_parsed);
+  TEST_ASSERT_EQUAL(1, G_rx_fcs_match);
+  TEST_ASSERT_EQUAL(PACKET_ESCAPE, G_rx_addr);
+  TEST_ASSERT_EQUAL(PACKET_FLAG, G_rx_control);
+  TEST_ASSERT_EQUAL(sizeof(payload), G_rx_buflen);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, G_rx_buf, sizeof(payload));
+}
+
+/**
+ * Promising the wrong length gets flagged
+ */
+void test_packet_framer_bad_length() {
+  packet_framer_t framer;
+
+  G_tx_len = 0;
+  packet_framer_begin(&framer, tx_cb, 'L', 'I', 3);
+  packet_framer_append(&framer, (const uint8_t *)"~~", 2);
+  TEST_ASSERT_EQUAL(0, packet_framer_end(&framer));
+}
+
 //////////////////////////////////////////////////////////////////////
 // Actual test runner
 
@@ -295,12 +595,22 @@ int main(int argc, char *argv[]) {
   UNITY_BEGIN();
   RUN_TEST(test_empty_string);
   RUN_TEST(test_string_sets);
+  RUN_TEST(test_fcs_matches_reference);
 
   RUN_TEST(test_packet_framing);
 
   RUN_TEST(test_packet_parsing);
+  RUN_TEST(test_packet_parsing_bulk);
+  RUN_TEST(test_packet_rx_buffer_matches_bytewise);
 
   RUN_TEST(test_packet_roundtrip);
 
+  RUN_TEST(test_parser_instances);
+  RUN_TEST(test_parser_small_buffer);
+
+  RUN_TEST(test_packet_framer_matches_frame);
+  RUN_TEST(test_packet_framer_roundtrip);
+  RUN_TEST(test_packet_framer_bad_length);
+
   return UNITY_END();
 }
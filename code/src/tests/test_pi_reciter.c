@@ -230,6 +230,21 @@ void test_next_digit_repeated(void) {
   }
 }
 
+void test_digit(void) {
+  pi_reciter_init();
+
+  for (int i = 0; i < N_PI_DIGITS; i++) {
+    TEST_ASSERT_EQUAL(PI_DIGITS[i], pi_reciter_digit(i));
+  }
+  TEST_ASSERT_EQUAL('#', pi_reciter_digit(N_PI_DIGITS));
+  TEST_ASSERT_EQUAL('#', pi_reciter_digit(0xFFFF));
+
+  // It doesn't care about the cursor, or wrong digits
+  TEST_ASSERT_EQUAL(PI_RECITER_WRONG_DIGIT, pi_reciter_rx_digit('B'));
+  TEST_ASSERT_EQUAL('A', pi_reciter_next_digit());
+  TEST_ASSERT_EQUAL('1', pi_reciter_digit(1));
+}
+
 //////////////////////////////////////////////////////////////////////
 // Actual test runner
 
@@ -242,6 +257,7 @@ int main(int argc, char *argv[]) {
   RUN_TEST(test_exhaustion);
   RUN_TEST(test_wrong_digit__at_end);
   RUN_TEST(test_next_digit_repeated);
+  RUN_TEST(test_digit);
 
   return UNITY_END();
 }
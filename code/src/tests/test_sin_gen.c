@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -168,6 +169,52 @@ void test_sin_scaled(void) {
   }
 }
 
+/**
+ * Negative angles should wrap around like positive ones do
+ */
+void test_sin_negative(void) {
+  char errmsg[256];
+
+  for (int i = 0; i < 1024; i++) {
+    float theta = COS_THETA0 * i / 256;
+
+    snprintf(errmsg, 255, "Case %d/%0.3f", i, theta);
+    TEST_ASSERT_EQUAL_MESSAGE(sin_gen_sin(theta, 1), sin_gen_sin(theta - 8*COS_THETA0, 1), errmsg);
+    TEST_ASSERT_EQUAL_MESSAGE(sin_gen_sin(theta, 1), sin_gen_sin(theta - 4*COS_THETA0, 1), errmsg);
+  }
+
+  // Just below zero is just below the midpoint
+  TEST_ASSERT_EQUAL(127 - expected_sin_table[7], sin_gen_sin(-8 * COS_THETA0 / 256, 1));
+}
+
+/**
+ * Binary angles should hit every table entry, and round to the nearest
+ */
+void test_sin_bam(void) {
+  char errmsg[256];
+
+  for (int i = 0; i < 1024; i++) {
+    int quadrant = i / 256;
+    int offset = i % 256;
+
+    if (quadrant % 2) offset = 255 - offset;
+
+    uint8_t expected = expected_sin_table[offset];
+    expected = 127 + (quadrant > 1 ? -expected : expected);
+
+    snprintf(errmsg, 255, "Case %d", i);
+
+    TEST_ASSERT_EQUAL_MESSAGE(expected, sin_gen_sin_bam32((uint32_t)i << 22, 1), errmsg);
+    TEST_ASSERT_EQUAL_MESSAGE(expected, sin_gen_sin_bam32(((uint32_t)i << 22) - (1UL << 21), 1), errmsg);
+    TEST_ASSERT_EQUAL_MESSAGE(expected, sin_gen_sin_bam32(((uint32_t)i << 22) + (1UL << 21) - 1, 1), errmsg);
+    TEST_ASSERT_EQUAL_MESSAGE(expected, sin_gen_sin_bam16(i << 6, 1), errmsg);
+    TEST_ASSERT_EQUAL_MESSAGE(expected, sin_gen_sin_bam16((i << 6) + 31, 1), errmsg);
+  }
+
+  TEST_ASSERT_EQUAL(127 + expected_sin_table[255]/4, sin_gen_sin_bam16(0x4000, 4));
+  TEST_ASSERT_EQUAL(127 - expected_sin_table[255]/4, sin_gen_sin_bam32(0xC0000000, 4));
+}
+
 //////////////////////////////
 // sin_gen_generate tests
 /**
@@ -363,6 +410,398 @@ void test_generate_downsample3(void) {
   TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_wav, test_req->buf, 341);
 }
 
+//////////////////////////////
+// Oscillator (NCO) tests
+
+/**
+ * Check that bad oscillator setups are rejected
+ */
+void test_nco_invalid(void) {
+  sin_gen_nco_t nco;
+
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_nco_init(NULL, 1000, 8000, 0, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_nco_init(&nco, 0, 8000, 0, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_nco_init(&nco, -10, 8000, 0, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_nco_init(&nco, 1000, 0, 0, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_nco_init(&nco, 1000, 8000, 0, 0));
+
+  TEST_ASSERT_EQUAL(SIN_GEN_UNDERSAMPLED, sin_gen_nco_init(&nco, 4000, 8000, 0, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_nco_init(&nco, 3999.5, 8000, 0, 1));
+
+  // A failed retune leaves the oscillator alone
+  uint32_t step = nco.step;
+  TEST_ASSERT_EQUAL(SIN_GEN_UNDERSAMPLED, sin_gen_nco_set_freq(&nco, 5000, 8000));
+  TEST_ASSERT_EQUAL(step, nco.step);
+}
+
+/**
+ * Tuning words should be exact where they can be
+ */
+void test_nco_tuning_word(void) {
+  TEST_ASSERT_EQUAL_UINT32(1UL << 22, sin_gen_nco_tuning_word(1, 1024));
+  TEST_ASSERT_EQUAL_UINT32(1UL << 30, sin_gen_nco_tuning_word(2000, 8000));
+  TEST_ASSERT_EQUAL_UINT32(374199026, sin_gen_nco_tuning_word(697, 8000)); // 697/8000 * 2^32, rounded
+  TEST_ASSERT_EQUAL_UINT32(1UL << 21, sin_gen_nco_tuning_word(0.5, 1024));
+}
+
+/**
+ * An oscillator stepping through the table one entry at a time should
+ * give the same wave as sin_gen_generate()
+ */
+void test_nco_matches_generate(void) {
+  sin_gen_nco_t nco;
+  uint8_t nco_buf[1024];
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_populate(test_req, dummy_buf, 1024, 1, 1024));
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate(test_req));
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_nco_init(&nco, 1, 1024, SIN_THETA0, 1));
+  sin_gen_nco_fill(&nco, nco_buf, 1024);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(dummy_buf, nco_buf, 1024);
+
+  // And it should have wrapped right around
+  TEST_ASSERT_EQUAL_UINT32(0, nco.phase);
+
+  // Same again, scaled
+  test_req->scale = 3;
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate(test_req));
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_nco_init(&nco, 1, 1024, SIN_THETA0, 3));
+  sin_gen_nco_fill(&nco, nco_buf, 1024);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(dummy_buf, nco_buf, 1024);
+}
+
+/**
+ * Filling a bit at a time should be seamless
+ */
+void test_nco_continuous(void) {
+  sin_gen_nco_t nco;
+  uint8_t oneshot[1000];
+  uint8_t chunked[1000];
+
+  sin_gen_nco_init(&nco, 1209.25, 8000, 0, 1);
+  sin_gen_nco_fill(&nco, oneshot, 1000);
+  uint32_t end_phase = nco.phase;
+
+  sin_gen_nco_init(&nco, 1209.25, 8000, 0, 1);
+  for (int i = 0; i < 1000; i += 7) {
+    sin_gen_nco_fill(&nco, chunked+i, (1000-i < 7 ? 1000-i : 7));
+  }
+
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(oneshot, chunked, 1000);
+  TEST_ASSERT_EQUAL_UINT32(end_phase, nco.phase);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)(1000 * nco.step), nco.phase);
+
+  // Retuning keeps the phase where it was
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_nco_set_freq(&nco, 697, 8000));
+  TEST_ASSERT_EQUAL_UINT32(end_phase, nco.phase);
+}
+
+/**
+ * Fractional frequencies should track the float generator, give or
+ * take rounding at the table index
+ */
+void test_nco_fractional(void) {
+  sin_gen_nco_t nco;
+  uint8_t buf[1024];
+
+  sin_gen_nco_init(&nco, 852.5, 8000, 0, 1);
+  sin_gen_nco_fill(&nco, buf, 1024);
+
+  for (int i = 0; i < 1024; i++) {
+    // Keep theta small, as the float version loses precision
+    float turns = 852.5f * i / 8000;
+    turns -= (int)turns;
+    TEST_ASSERT_INT_WITHIN(1, sin_gen_sin(4*COS_THETA0 * turns, 1), buf[i]);
+  }
+}
+
+/**
+ * The initial phase should work for cos, and for negative angles
+ */
+void test_nco_theta0(void) {
+  sin_gen_nco_t nco;
+  uint8_t buf[4];
+
+  sin_gen_nco_init(&nco, 2000, 8000, COS_THETA0, 1);
+  sin_gen_nco_fill(&nco, buf, 4);
+  TEST_ASSERT_EQUAL(254, buf[0]);
+  TEST_ASSERT_EQUAL(127, buf[1]);
+  TEST_ASSERT_EQUAL(0, buf[2]);
+  TEST_ASSERT_EQUAL(127, buf[3]);
+
+  sin_gen_nco_init(&nco, 2000, 8000, -COS_THETA0, 1);
+  sin_gen_nco_fill(&nco, buf, 4);
+  TEST_ASSERT_EQUAL(0, buf[0]);
+  TEST_ASSERT_EQUAL(127, buf[1]);
+  TEST_ASSERT_EQUAL(254, buf[2]);
+  TEST_ASSERT_EQUAL(127, buf[3]);
+}
+
+/**
+ * The 12b lookup should hit the peaks and zero crossings exactly, and
+ * be within an LSB of the real thing everywhere else
+ */
+void test_sin12(void) {
+  TEST_ASSERT_EQUAL(2048, sin_gen_sin12_bam32(0, 1));
+  TEST_ASSERT_EQUAL(4095, sin_gen_sin12_bam32(0x40000000, 1));
+  TEST_ASSERT_EQUAL(2048, sin_gen_sin12_bam32(0x80000000, 1));
+  TEST_ASSERT_EQUAL(1, sin_gen_sin12_bam32(0xC0000000, 1));
+
+  TEST_ASSERT_EQUAL(2048+1023, sin_gen_sin12_bam32(0x40000000, 2));
+  TEST_ASSERT_EQUAL(2048-1023, sin_gen_sin12_bam32(0xC0000000, 2));
+
+  // Deliberately not a multiple of the table step, to exercise the interpolation
+  for (uint32_t angle = 0; angle < 0xFFF00000; angle += 0x00100007) {
+    double expected = 2048 + 2047 * sin(angle * (2*M_PI / 4294967296.0));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, expected, sin_gen_sin12_bam32(angle, 1));
+  }
+}
+
+/**
+ * The 12b oscillator should follow the same phase as the 8b one
+ */
+void test_nco_fill12(void) {
+  sin_gen_nco_t nco;
+  uint16_t buf12[64];
+
+  sin_gen_nco_init(&nco, 1000, 8000, SIN_THETA0, 1);
+  sin_gen_nco_fill12(&nco, buf12, 10);
+  TEST_ASSERT_EQUAL(10 * nco.step, nco.phase);
+  sin_gen_nco_fill12(&nco, buf12+10, 54);
+
+  for (int i = 0; i < 64; i++) {
+    TEST_ASSERT_EQUAL(sin_gen_sin12_bam32(i * 0x20000000UL, 1), buf12[i]);
+  }
+  TEST_ASSERT_EQUAL(4095, buf12[2]);
+  TEST_ASSERT_EQUAL(1, buf12[6]);
+}
+
+/**
+ * A single full-scale tone should come out exactly as the oscillator
+ * would make it, and the usual input checks apply
+ */
+void test_multi12(void) {
+  sin_gen_nco_t nco;
+  uint16_t expected[256];
+  uint16_t buf12[256];
+  sin_gen_component_t comps[2] = {
+    { .f_tone = 697, .amplitude = 1, .theta0 = COS_THETA0 },
+    { .f_tone = 1000, .amplitude = 1, .theta0 = 0 },
+  };
+
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi12(NULL, 256, 8000, comps, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi12(buf12, 0, 8000, comps, 1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi12(buf12, 256, 8000, comps, 0));
+  TEST_ASSERT_EQUAL(SIN_GEN_UNDERSAMPLED, sin_gen_generate_multi12(buf12, 256, 1000, comps, 1));
+
+  sin_gen_nco_init(&nco, 697, 8000, COS_THETA0, 1);
+  sin_gen_nco_fill12(&nco, expected, 256);
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_multi12(buf12, 256, 8000, comps, 1));
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, buf12, 256);
+
+  // Two full-scale tones clip at both ends
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_multi12(buf12, 256, 8000, comps, 2));
+  for (int i = 0; i < 256; i++) {
+    TEST_ASSERT_LESS_OR_EQUAL(4095, buf12[i]);
+  }
+  TEST_ASSERT_EQUAL(4095, buf12[0]); // cos(0) + sin(0) is all the way up there
+}
+
+/**
+ * I should be the plain 12b mix, and Q the same mix a quarter turn on
+ */
+void test_iq12(void) {
+  uint16_t expected_i[128], expected_q[128];
+  uint32_t iq[128];
+  sin_gen_component_t comps[2] = {
+    { .f_tone = 697, .amplitude = 0.5, .theta0 = 0 },
+    { .f_tone = 1209, .amplitude = 0.25, .theta0 = COS_THETA0 },
+  };
+
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_iq12(NULL, 128, 8000, comps, 2));
+  TEST_ASSERT_EQUAL(SIN_GEN_UNDERSAMPLED, sin_gen_generate_iq12(iq, 128, 2000, comps, 2));
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_iq12(iq, 128, 8000, comps, 2));
+  sin_gen_generate_multi12(expected_i, 128, 8000, comps, 2);
+
+  comps[0].theta0 += COS_THETA0;
+  comps[1].theta0 += COS_THETA0;
+  sin_gen_generate_multi12(expected_q, 128, 8000, comps, 2);
+
+  for (int i = 0; i < 128; i++) {
+    TEST_ASSERT_EQUAL(expected_i[i], iq[i] & 0xFFFF);
+    TEST_ASSERT_INT_WITHIN(1, expected_q[i], iq[i] >> 16); // theta0 goes through a float
+  }
+}
+
+//////////////////////////////
+// sin_gen_generate_multi tests
+
+/**
+ * Check that bad mixes are rejected, without touching the buffer
+ */
+void test_multi_invalid(void) {
+  sin_gen_component_t comps[SIN_GEN_MAX_COMPONENTS+1];
+  for (int k = 0; k < SIN_GEN_MAX_COMPONENTS+1; k++) {
+    comps[k] = (sin_gen_component_t){ .f_tone = 100*(k+1), .amplitude = 0.1, .theta0 = 0 };
+  }
+
+  memset(dummy_buf, 'x', dummy_buflen);
+
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(NULL, 1024, 8000, comps, 2));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 0, 8000, comps, 2));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 1024, 8000, NULL, 2));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 1024, 8000, comps, 0));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 1024, 8000, comps, SIN_GEN_MAX_COMPONENTS+1));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 1024, 0, comps, 2));
+
+  comps[1].amplitude = -0.1;
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 1024, 8000, comps, 2));
+  comps[1].amplitude = 1.1;
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_generate_multi(dummy_buf, 1024, 8000, comps, 2));
+  comps[1].amplitude = 0.1;
+
+  comps[1].f_tone = 4000;
+  TEST_ASSERT_EQUAL(SIN_GEN_UNDERSAMPLED, sin_gen_generate_multi(dummy_buf, 1024, 8000, comps, 2));
+
+  for (int i = 0; i < dummy_buflen; i++) {
+    TEST_ASSERT_EQUAL('x', dummy_buf[i]);
+  }
+
+  comps[1].f_tone = 200;
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_multi(dummy_buf, 1024, 8000, comps, SIN_GEN_MAX_COMPONENTS));
+}
+
+/**
+ * A single full-scale tone is just the oscillator's output
+ */
+void test_multi_single(void) {
+  sin_gen_component_t comp = { .f_tone = 697.5, .amplitude = 1, .theta0 = COS_THETA0 };
+  sin_gen_nco_t nco;
+  uint8_t expected[1024];
+
+  sin_gen_nco_init(&nco, 697.5, 8000, COS_THETA0, 1);
+  sin_gen_nco_fill(&nco, expected, 1024);
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_multi(dummy_buf, 1024, 8000, &comp, 1));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, dummy_buf, 1024);
+}
+
+/**
+ * Two half-scale tones should be the average of the two, as the old
+ * two-buffer DTMF generation did it
+ */
+void test_multi_dtmf(void) {
+  sin_gen_component_t comps[2] = {
+    { .f_tone = 770, .amplitude = 0.5, .theta0 = 0 },
+    { .f_tone = 1336, .amplitude = 0.5, .theta0 = 0 },
+  };
+  sin_gen_nco_t nco;
+  uint8_t row[1024], col[1024];
+
+  sin_gen_nco_init(&nco, 770, 50000, 0, 1);
+  sin_gen_nco_fill(&nco, row, 1024);
+  sin_gen_nco_init(&nco, 1336, 50000, 0, 1);
+  sin_gen_nco_fill(&nco, col, 1024);
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_multi(dummy_buf, 1024, 50000, comps, 2));
+
+  for (int i = 0; i < 1024; i++) {
+    TEST_ASSERT_INT_WITHIN(1, (row[i] + col[i])/2, dummy_buf[i]);
+  }
+}
+
+/**
+ * Overdriving the mix should clip, not wrap around
+ */
+void test_multi_clip(void) {
+  sin_gen_component_t comps[2] = {
+    { .f_tone = 1000, .amplitude = 1, .theta0 = 0 },
+    { .f_tone = 1000, .amplitude = 1, .theta0 = 0 },
+  };
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_generate_multi(dummy_buf, 8, 8000, comps, 2));
+
+  TEST_ASSERT_EQUAL(127, dummy_buf[0]);
+  TEST_ASSERT_EQUAL(254, dummy_buf[2]);
+  TEST_ASSERT_EQUAL(127, dummy_buf[4]);
+  TEST_ASSERT_EQUAL(0, dummy_buf[6]);
+}
+
+/**
+ * (Internal) Float version of the loop error, to check the planner with
+ */
+static float plan_loop_error(const float *f_tones, uint8_t n, uint32_t f_sample, uint16_t len) {
+  float err = 0;
+  for (int k = 0; k < n; k++) {
+    float cycles = f_tones[k] * len / f_sample;
+    float frac = cycles - (int)cycles;
+    err += (frac > 0.5 ? 1 - frac : frac);
+  }
+  return err * 4*COS_THETA0;
+}
+
+void test_plan_loop_invalid(void) {
+  const float tones[2] = { 697, 1209 };
+  uint16_t len = 0;
+
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_plan_loop(NULL, 2, 8000, 1024, &len, NULL));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_plan_loop(tones, 2, 8000, 1024, NULL, NULL));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_plan_loop(tones, 2, 8000, 0, &len, NULL));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_plan_loop(tones, 0, 8000, 1024, &len, NULL));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_plan_loop(tones, SIN_GEN_MAX_COMPONENTS+1, 8000, 1024, &len, NULL));
+  TEST_ASSERT_EQUAL(SIN_GEN_INVALID, sin_gen_plan_loop(tones, 2, 0, 1024, &len, NULL));
+  TEST_ASSERT_EQUAL(SIN_GEN_UNDERSAMPLED, sin_gen_plan_loop(tones, 2, 2000, 1024, &len, NULL));
+  TEST_ASSERT_EQUAL(0, len);
+
+  // Not even one wave of 697Hz fits in 10 samples
+  TEST_ASSERT_EQUAL(SIN_GEN_TOO_SHORT, sin_gen_plan_loop(tones, 2, 8000, 10, &len, NULL));
+  TEST_ASSERT_EQUAL(10, len);
+}
+
+/**
+ * Tones that can loop perfectly get the shortest perfect length
+ */
+void test_plan_loop_exact(void) {
+  const float tones[2] = { 1000, 1500 };
+  uint16_t len;
+  float phase_error = -1;
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_plan_loop(tones, 1, 8000, 1024, &len, &phase_error));
+  TEST_ASSERT_EQUAL(8, len);
+  TEST_ASSERT_EQUAL_FLOAT(0, phase_error);
+
+  // 1500Hz needs 16 samples to come back around; 32, 48, ... are just as good, but longer
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_plan_loop(tones, 2, 8000, 1024, &len, &phase_error));
+  TEST_ASSERT_EQUAL(16, len);
+  TEST_ASSERT_EQUAL_FLOAT(0, phase_error);
+}
+
+/**
+ * DTMF tones never loop perfectly, but nothing else in range should
+ * loop much better than what the planner picks
+ */
+void test_plan_loop_dtmf(void) {
+  const float tones[2] = { 697, 1209 };
+  const uint32_t f_sample = 8000;
+  const float slop = 4*COS_THETA0 / 1024; // One table step
+  uint16_t len;
+  float phase_error;
+
+  TEST_ASSERT_EQUAL(SIN_GEN_OKAY, sin_gen_plan_loop(tones, 2, f_sample, 1024, &len, &phase_error));
+  TEST_ASSERT_GREATER_OR_EQUAL(f_sample/697 + 1, len);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, plan_loop_error(tones, 2, f_sample, len), phase_error);
+
+  for (uint16_t n = f_sample/697 + 1; n <= 1024; n++) {
+    float err = plan_loop_error(tones, 2, f_sample, n);
+    TEST_ASSERT_TRUE(err > phase_error - slop - 1e-3);
+    if (n < len) {
+      TEST_ASSERT_TRUE(err > phase_error + slop - 1e-3); // Only longer if it's worth it
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////
 // Actual test runner
 
@@ -374,6 +813,8 @@ int main(int argc, char *argv[]) {
 
   RUN_TEST(test_sin);
   RUN_TEST(test_sin_scaled);
+  RUN_TEST(test_sin_negative);
+  RUN_TEST(test_sin_bam);
 
   RUN_TEST(test_generate_invalid_requests);
   RUN_TEST(test_generate_undersampling);
@@ -384,5 +825,25 @@ int main(int argc, char *argv[]) {
   RUN_TEST(test_generate_downsample2);
   RUN_TEST(test_generate_downsample3);
 
+  RUN_TEST(test_nco_invalid);
+  RUN_TEST(test_nco_tuning_word);
+  RUN_TEST(test_nco_matches_generate);
+  RUN_TEST(test_nco_continuous);
+  RUN_TEST(test_nco_fractional);
+  RUN_TEST(test_nco_theta0);
+  RUN_TEST(test_sin12);
+  RUN_TEST(test_nco_fill12);
+
+  RUN_TEST(test_multi_invalid);
+  RUN_TEST(test_multi_single);
+  RUN_TEST(test_multi_dtmf);
+  RUN_TEST(test_multi_clip);
+  RUN_TEST(test_multi12);
+  RUN_TEST(test_iq12);
+
+  RUN_TEST(test_plan_loop_invalid);
+  RUN_TEST(test_plan_loop_exact);
+  RUN_TEST(test_plan_loop_dtmf);
+
   return UNITY_END();
 }
@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "tone_seq.h"
+
+#define N_ENTRIES 4 //!< Ring size in the tests (so three can be queued)
+#define IDLE 2048 //!< Idle value in the tests
+#define WAVE_LEN 7 //!< Length of the test waveforms, deliberately odd
+
+static tone_seq_entry_t entries[N_ENTRIES];
+static tone_seq_t seq;
+static uint16_t wave_a[WAVE_LEN];
+static uint16_t wave_b[WAVE_LEN];
+
+//////////////////////////////////////////////////////////////////////
+// Unity requires a setUp and tearDown function.
+
+void setUp(void) {
+  for (int i = 0; i < WAVE_LEN; i++) {
+    wave_a[i] = 100 + i;
+    wave_b[i] = 200 + i;
+  }
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_init(&seq, entries, N_ENTRIES, IDLE));
+}
+
+/**
+ * There is nothing to tear down in this set of tests.
+ */
+void tearDown(void) {}
+
+/**
+ * Render n samples, a few at a time, the way the DAC's half-buffers would
+ */
+static void fill_in_chunks(uint16_t *buf, uint16_t n, uint16_t chunk) {
+  while (n > 0) {
+    uint16_t k = (n < chunk) ? n : chunk;
+    tone_seq_fill(&seq, buf, k);
+    buf += k;
+    n -= k;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Tests
+
+void test_init__invalid(void) {
+  TEST_ASSERT_EQUAL(TONE_SEQ_INVALID_INPUTS, tone_seq_init(NULL, entries, N_ENTRIES, IDLE));
+  TEST_ASSERT_EQUAL(TONE_SEQ_INVALID_INPUTS, tone_seq_init(&seq, NULL, N_ENTRIES, IDLE));
+  TEST_ASSERT_EQUAL(TONE_SEQ_INVALID_INPUTS, tone_seq_init(&seq, entries, 1, IDLE));
+  TEST_ASSERT_EQUAL(TONE_SEQ_INVALID_INPUTS, tone_seq_push(&seq, NULL, 0, 0, 0));
+
+  TEST_ASSERT_EQUAL_STRING("INVALID_INPUTS", tone_seq_status_name(TONE_SEQ_INVALID_INPUTS));
+}
+
+/**
+ * Tones need a waveform, and the ring holds one fewer than its size
+ */
+void test_push__full(void) {
+  TEST_ASSERT_EQUAL(TONE_SEQ_INVALID_INPUTS, tone_seq_push(&seq, NULL, WAVE_LEN, 10, 10));
+  TEST_ASSERT_EQUAL(TONE_SEQ_INVALID_INPUTS, tone_seq_push(&seq, wave_a, 0, 10, 10));
+
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, NULL, 0, 0, 10)); // A bare gap is fine
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_a, WAVE_LEN, 10, 10));
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_b, WAVE_LEN, 10, 10));
+  TEST_ASSERT_EQUAL(3, tone_seq_pending(&seq));
+  TEST_ASSERT_EQUAL(TONE_SEQ_FULL, tone_seq_push(&seq, wave_a, WAVE_LEN, 10, 10));
+
+  // Playing out the first frees a slot
+  uint16_t buf[10];
+  tone_seq_fill(&seq, buf, 10);
+  TEST_ASSERT_EQUAL(2, tone_seq_pending(&seq));
+  TEST_ASSERT_EQUAL(1, seq.played);
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_a, WAVE_LEN, 10, 10));
+
+  tone_seq_clear(&seq);
+  TEST_ASSERT_EQUAL(0, tone_seq_pending(&seq));
+}
+
+/**
+ * With nothing queued, it's all idle
+ */
+void test_fill__idle(void) {
+  uint16_t buf[32];
+
+  memset(buf, 0, sizeof(buf));
+  tone_seq_fill(&seq, buf, 32);
+  for (int i = 0; i < 32; i++) TEST_ASSERT_EQUAL(IDLE, buf[i]);
+  TEST_ASSERT_EQUAL(0, seq.played);
+}
+
+/**
+ * Tones and gaps are exactly as long as asked, back to back, no
+ * matter how the fills are split up
+ */
+void test_fill__timing(void) {
+  const uint16_t chunks[] = { 1, 5, 16, 64, 100 };
+  uint16_t buf[100];
+
+  for (unsigned c = 0; c < sizeof(chunks)/sizeof(chunks[0]); c++) {
+    TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_init(&seq, entries, N_ENTRIES, IDLE));
+    TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_a, WAVE_LEN, 20, 5));
+    TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_b, WAVE_LEN, 17, 3));
+
+    fill_in_chunks(buf, 100, chunks[c]);
+
+    int i = 0;
+    for (int k = 0; k < 20; k++, i++) TEST_ASSERT_EQUAL(wave_a[k % WAVE_LEN], buf[i]);
+    for (int k = 0; k < 5; k++, i++) TEST_ASSERT_EQUAL(IDLE, buf[i]);
+    for (int k = 0; k < 17; k++, i++) TEST_ASSERT_EQUAL(wave_b[k % WAVE_LEN], buf[i]);
+    for ( ; i < 100; i++) TEST_ASSERT_EQUAL(IDLE, buf[i]);
+
+    TEST_ASSERT_EQUAL(2, seq.played);
+    TEST_ASSERT_EQUAL(0, tone_seq_pending(&seq));
+  }
+}
+
+/**
+ * A tone with no gap runs straight into the next one, and its
+ * waveform starts over from the beginning
+ */
+void test_fill__no_gap(void) {
+  uint16_t buf[20];
+
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_a, WAVE_LEN, 10, 0));
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_a, WAVE_LEN, 10, 0));
+  tone_seq_fill(&seq, buf, 20);
+
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(wave_a[i % WAVE_LEN], buf[i]);
+    TEST_ASSERT_EQUAL(wave_a[i % WAVE_LEN], buf[10+i]);
+  }
+}
+
+/**
+ * Pushing while it's idling picks up at the next fill
+ */
+void test_fill__push_while_idle(void) {
+  uint16_t buf[16];
+
+  tone_seq_fill(&seq, buf, 16);
+  TEST_ASSERT_EQUAL(TONE_SEQ_OKAY, tone_seq_push(&seq, wave_b, WAVE_LEN, 8, 0));
+  tone_seq_fill(&seq, buf, 16);
+
+  for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL(wave_b[i % WAVE_LEN], buf[i]);
+  for (int i = 8; i < 16; i++) TEST_ASSERT_EQUAL(IDLE, buf[i]);
+}
+
+void test_ms_to_samples(void) {
+  TEST_ASSERT_EQUAL(2160, tone_seq_ms_to_samples(45, 48000));
+  TEST_ASSERT_EQUAL(480, tone_seq_ms_to_samples(10, 48000));
+  TEST_ASSERT_EQUAL(3456, tone_seq_ms_to_samples(45, 76800));
+  TEST_ASSERT_EQUAL(0, tone_seq_ms_to_samples(-1, 48000));
+  TEST_ASSERT_EQUAL(0, tone_seq_ms_to_samples(10, 0));
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[]) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_init__invalid);
+  RUN_TEST(test_push__full);
+  RUN_TEST(test_fill__idle);
+  RUN_TEST(test_fill__timing);
+  RUN_TEST(test_fill__no_gap);
+  RUN_TEST(test_fill__push_while_idle);
+  RUN_TEST(test_ms_to_samples);
+
+  return UNITY_END();
+}
@@ -0,0 +1,191 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "tx_queue.h"
+
+#define RING_LEN 64 //!< Size of each ring in the tests
+
+static uint8_t rings[TX_QUEUE_N_PRIOS][RING_LEN];
+static tx_queue_t q;
+
+static uint8_t sent[1024]; //!< Everything drain() has sent
+static uint16_t sent_len; //!< How much of sent is used
+
+//////////////////////////////////////////////////////////////////////
+// Unity requires a setUp and tearDown function.
+
+void setUp(void) {
+  memset(rings, 'x', sizeof(rings));
+  sent_len = 0;
+
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, tx_queue_init(&q));
+  for (int i = 0; i < TX_QUEUE_N_PRIOS; i++) {
+    TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, tx_queue_set_ring(&q, i, rings[i], RING_LEN));
+  }
+}
+
+/**
+ * There is nothing to tear down in this set of tests.
+ */
+void tearDown(void) {}
+
+/**
+ * Queue up a whole frame in one go
+ */
+static tx_queue_status_t queue(tx_queue_prio_t prio, const char *frame) {
+  uint16_t len = strlen(frame);
+  tx_queue_status_t res = tx_queue_begin(&q, prio, len);
+  if (TX_QUEUE_OKAY != res) return res;
+
+  tx_queue_write(&q, (const uint8_t *)frame, len);
+  return tx_queue_end(&q);
+}
+
+/**
+ * Pretend to be the DMA: send chunks until there's nothing left, or
+ * max_chunks have gone
+ */
+static void drain(int max_chunks) {
+  const uint8_t *chunk;
+  uint16_t n;
+
+  for (int i = 0; i < max_chunks && (n = tx_queue_next_chunk(&q, &chunk)); i++) {
+    memcpy(sent + sent_len, chunk, n);
+    sent_len += n;
+    tx_queue_chunk_done(&q);
+  }
+  sent[sent_len] = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Tests
+
+void test_init__invalid(void) {
+  TEST_ASSERT_EQUAL(TX_QUEUE_INVALID_INPUTS, tx_queue_init(NULL));
+  TEST_ASSERT_EQUAL(TX_QUEUE_INVALID_INPUTS, tx_queue_set_ring(&q, TX_QUEUE_N_PRIOS, rings[0], RING_LEN));
+  TEST_ASSERT_EQUAL(TX_QUEUE_INVALID_INPUTS, tx_queue_set_ring(&q, TX_PRIO_LOG, NULL, RING_LEN));
+  TEST_ASSERT_EQUAL(TX_QUEUE_INVALID_INPUTS, tx_queue_set_ring(&q, TX_PRIO_LOG, rings[0], 2));
+  TEST_ASSERT_EQUAL(TX_QUEUE_INVALID_INPUTS, tx_queue_end(&q));
+
+  TEST_ASSERT_EQUAL_STRING("OVERFLOW", tx_queue_status_name(TX_QUEUE_OVERFLOW));
+}
+
+/**
+ * Frames come back out whole and in order, in pieces or not
+ */
+void test_queue__roundtrip(void) {
+  tx_queue_stats_t stats;
+
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, tx_queue_begin(&q, TX_PRIO_LOG, 11));
+  TEST_ASSERT_EQUAL(TX_QUEUE_BUSY, tx_queue_begin(&q, TX_PRIO_DATA, 1));
+  tx_queue_write(&q, (const uint8_t *)"Hello", 5);
+  tx_queue_write(&q, (const uint8_t *)", ", 2);
+  tx_queue_write(&q, (const uint8_t *)"world", 5);
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, tx_queue_end(&q));
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_LOG, "!"));
+
+  drain(100);
+  TEST_ASSERT_EQUAL_STRING("Hello, world!", sent);
+
+  tx_queue_get_stats(&q, TX_PRIO_LOG, &stats);
+  TEST_ASSERT_EQUAL(2, stats.queued);
+  TEST_ASSERT_EQUAL(2, stats.sent);
+  TEST_ASSERT_EQUAL(0, stats.dropped);
+  TEST_ASSERT_EQUAL(2+12+2+1, stats.high_water);
+}
+
+/**
+ * More urgent classes go first, but only between frames
+ */
+void test_queue__priority(void) {
+  const uint8_t *chunk;
+
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_LOG, "[log1]"));
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_LOG, "[log2]"));
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_DATA, "[data]"));
+
+  // Start sending the data frame, and have a control reply turn up
+  TEST_ASSERT_EQUAL(6, tx_queue_next_chunk(&q, &chunk));
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_CONTROL, "[ctl]"));
+  TEST_ASSERT_EQUAL(6, tx_queue_next_chunk(&q, &chunk)); // Same chunk until it's done
+  TEST_ASSERT_EQUAL_UINT8_ARRAY("[data]", chunk, 6);
+  tx_queue_chunk_done(&q);
+
+  drain(100);
+  TEST_ASSERT_EQUAL_STRING("[ctl][log1][log2]", sent);
+}
+
+/**
+ * Frames that wrap around the end of the ring come out in two chunks
+ */
+void test_queue__wrap(void) {
+  char frame[41];
+
+  memset(frame, 'a', 40);
+  frame[40] = 0;
+
+  // Each of these takes 42 bytes of the ring, so the second wraps
+  for (int i = 0; i < 3; i++) {
+    frame[0] = '0' + i;
+    TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_DATA, frame));
+
+    sent_len = 0;
+    drain(100);
+    TEST_ASSERT_EQUAL(40, sent_len);
+    TEST_ASSERT_EQUAL_STRING(frame, sent);
+  }
+}
+
+/**
+ * Frames that won't fit are dropped and counted, and don't disturb
+ * the frames around them
+ */
+void test_queue__full(void) {
+  char frame[41];
+  tx_queue_stats_t stats;
+
+  memset(frame, 'b', 40);
+  frame[40] = 0;
+
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_LOG, frame));
+  TEST_ASSERT_EQUAL(RING_LEN - 1 - 42 - 2, tx_queue_room(&q, TX_PRIO_LOG));
+  TEST_ASSERT_EQUAL(TX_QUEUE_FULL, queue(TX_PRIO_LOG, frame));
+
+  // Promise less than gets written
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, tx_queue_begin(&q, TX_PRIO_LOG, 10));
+  tx_queue_write(&q, (const uint8_t *)frame, 10);
+  tx_queue_write(&q, (const uint8_t *)frame, 10);
+  TEST_ASSERT_EQUAL(TX_QUEUE_OVERFLOW, tx_queue_end(&q));
+
+  TEST_ASSERT_EQUAL(TX_QUEUE_OKAY, queue(TX_PRIO_LOG, "end"));
+
+  drain(100);
+  TEST_ASSERT_EQUAL(43, sent_len);
+  TEST_ASSERT_EQUAL_STRING("end", sent + 40);
+
+  tx_queue_get_stats(&q, TX_PRIO_LOG, &stats);
+  TEST_ASSERT_EQUAL(2, stats.queued);
+  TEST_ASSERT_EQUAL(2, stats.sent);
+  TEST_ASSERT_EQUAL(2, stats.dropped);
+
+  // Other classes are unaffected
+  tx_queue_get_stats(&q, TX_PRIO_CONTROL, &stats);
+  TEST_ASSERT_EQUAL(0, stats.dropped);
+  TEST_ASSERT_EQUAL(RING_LEN - 1 - 2, tx_queue_room(&q, TX_PRIO_CONTROL));
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[]) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_init__invalid);
+  RUN_TEST(test_queue__roundtrip);
+  RUN_TEST(test_queue__priority);
+  RUN_TEST(test_queue__wrap);
+  RUN_TEST(test_queue__full);
+
+  return UNITY_END();
+}
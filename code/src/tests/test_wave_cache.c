@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "wave_cache.h"
+#include "dtmf.h"
+#include "sin_gen.h"
+
+#define MAX_LEN 1024 //!< Longest waveform in the tests
+#define F_SAMPLE 50000 //!< DAC rate for the tests
+
+static uint16_t pool[WAVE_CACHE_N_SYMBOLS * MAX_LEN];
+#define POOL_LEN (WAVE_CACHE_N_SYMBOLS * MAX_LEN) //!< Samples in the pool
+#define POOL_FILL 0x7878 //!< What setUp() leaves in the pool
+static wave_cache_t cache;
+
+//////////////////////////////////////////////////////////////////////
+// Unity requires a setUp and tearDown function.
+
+void setUp(void) {
+  memset(pool, 'x', sizeof(pool));
+}
+
+/**
+ * There is nothing to tear down in this set of tests.
+ */
+void tearDown(void) {}
+
+//////////////////////////////////////////////////////////////////////
+// Tests
+
+void test_init__invalid(void) {
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_init(NULL, pool, POOL_LEN, MAX_LEN, 0.25, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_init(&cache, NULL, POOL_LEN, MAX_LEN, 0.25, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_init(&cache, pool, 0, MAX_LEN, 0.25, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_init(&cache, pool, POOL_LEN, 0, 0.25, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0.6, false));
+
+  TEST_ASSERT_EQUAL_STRING("INVALID_INPUTS", wave_cache_status_name(WAVE_CACHE_INVALID_INPUTS));
+}
+
+/**
+ * Nothing comes out before the cache is built
+ */
+void test_get__not_built(void) {
+  const uint16_t *buf;
+  uint16_t len;
+
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0.25, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_NOT_BUILT, wave_cache_get(&cache, '5', &buf, &len));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_INVALID_INPUTS, wave_cache_build(&cache, 0));
+}
+
+/**
+ * Every symbol's waveform should be what sin_gen would make for it
+ */
+void test_build__happy_path(void) {
+  static const uint8_t symbols[] = "0123456789ABCD*#";
+  uint16_t expected[MAX_LEN];
+
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0.25, false));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_build(&cache, F_SAMPLE));
+  TEST_ASSERT_EQUAL(POOL_LEN, cache.pool_used);
+
+  for (int i = 0; i < WAVE_CACHE_N_SYMBOLS; i++) {
+    const uint16_t *buf;
+    uint16_t len;
+    float f_row, f_col;
+
+    TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_get(&cache, symbols[i], &buf, &len));
+    TEST_ASSERT_EQUAL(MAX_LEN, len);
+
+    dtmf_get_tones(symbols[i], &f_row, &f_col);
+    const sin_gen_component_t tones[2] = {
+      { .f_tone = f_row, .amplitude = 0.25, .theta0 = 0 },
+      { .f_tone = f_col, .amplitude = 0.25, .theta0 = 0 },
+    };
+    sin_gen_generate_multi12(expected, MAX_LEN, F_SAMPLE, tones, 2);
+
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, buf, MAX_LEN);
+  }
+
+  const uint16_t *buf;
+  uint16_t len;
+  TEST_ASSERT_EQUAL(WAVE_CACHE_SYMBOL_NOT_FOUND, wave_cache_get(&cache, 'E', &buf, &len));
+}
+
+/**
+ * Building again at the same rate is free; a new rate regenerates
+ */
+void test_build__rate_change(void) {
+  const uint16_t *buf;
+  uint16_t len;
+
+  wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0.25, false);
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_build(&cache, F_SAMPLE));
+  wave_cache_get(&cache, '1', &buf, &len);
+
+  uint16_t first = buf[1];
+  pool[1] = POOL_FILL;
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_build(&cache, F_SAMPLE));
+  TEST_ASSERT_EQUAL(POOL_FILL, buf[1]);
+
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_build(&cache, F_SAMPLE/2));
+  TEST_ASSERT_EQUAL(F_SAMPLE/2, cache.f_sample);
+  TEST_ASSERT_TRUE(first != buf[1]); // Twice the phase step now
+}
+
+/**
+ * A pool too small for everything fails cleanly
+ */
+void test_build__no_room(void) {
+  const uint16_t *buf;
+  uint16_t len;
+
+  wave_cache_init(&cache, pool, POOL_LEN - 1, MAX_LEN, 0.25, false);
+  TEST_ASSERT_EQUAL(WAVE_CACHE_NO_ROOM, wave_cache_build(&cache, F_SAMPLE));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_NOT_BUILT, wave_cache_get(&cache, '1', &buf, &len));
+  TEST_ASSERT_EQUAL(POOL_FILL, pool[POOL_LEN - 1]);
+
+  wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0.25, false);
+  TEST_ASSERT_EQUAL(WAVE_CACHE_GENERATION_FAILED, wave_cache_build(&cache, 2000));
+  TEST_ASSERT_EQUAL(WAVE_CACHE_NOT_BUILT, wave_cache_get(&cache, '1', &buf, &len));
+}
+
+/**
+ * Trimmed waveforms should be the planned length, and loop more cleanly
+ */
+void test_build__trim(void) {
+  static const uint8_t symbols[] = "0123456789ABCD*#";
+
+  wave_cache_init(&cache, pool, POOL_LEN, MAX_LEN, 0.25, true);
+  TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_build(&cache, F_SAMPLE));
+  TEST_ASSERT_LESS_THAN(POOL_LEN, cache.pool_used);
+
+  for (int i = 0; i < WAVE_CACHE_N_SYMBOLS; i++) {
+    const uint16_t *buf;
+    uint16_t len;
+    float f_row, f_col;
+
+    TEST_ASSERT_EQUAL(WAVE_CACHE_OKAY, wave_cache_get(&cache, symbols[i], &buf, &len));
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_LEN, len);
+
+    dtmf_get_tones(symbols[i], &f_row, &f_col);
+    const float f_tones[2] = { f_row, f_col };
+    uint16_t planned;
+    sin_gen_plan_loop(f_tones, 2, F_SAMPLE, MAX_LEN, &planned, NULL);
+    TEST_ASSERT_EQUAL(planned, len);
+
+    // Both tones within 5% of a cycle of wrapping cleanly
+    float row_cycles = f_row * len / F_SAMPLE;
+    float col_cycles = f_col * len / F_SAMPLE;
+    TEST_ASSERT_FLOAT_WITHIN(0.05, (int)(row_cycles + 0.5), row_cycles);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, (int)(col_cycles + 0.5), col_cycles);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[]) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_init__invalid);
+  RUN_TEST(test_get__not_built);
+  RUN_TEST(test_build__happy_path);
+  RUN_TEST(test_build__rate_change);
+  RUN_TEST(test_build__no_room);
+  RUN_TEST(test_build__trim);
+
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+#include "tone_seq.h"
+
+#include <string.h>
+
+/**
+ * \file tone_seq.c
+ * \brief A sample-timed sequencer for tone bursts
+ *
+ * \defgroup tone_seq Tone sequencer
+ * \addtogroup tone_seq
+ * \{
+ *
+ * Sending DTMF one digit at a time, with the CPU stopping and starting
+ * the DAC around each one, means the tone lengths and the gaps between
+ * them come down to when interrupts and callbacks happen to run.  This
+ * instead takes a queue of (waveform, on time, off time) entries and
+ * renders them into the DAC's stream with dac_setup_stream(), so every
+ * tone and gap is exactly as many samples long as was asked for.
+ *
+ * tone_seq_fill() is the streaming producer: it loops each entry's
+ * waveform for on_samples, emits the idle value for off_samples, and
+ * moves straight on to the next entry, within the same half-buffer if
+ * need be.  When the queue runs dry, it emits the idle value until
+ * something else gets pushed.  The waveforms themselves aren't copied,
+ * so they need to stay put until they've been played (a wave_cache is
+ * ideal for this).
+ *
+ * Each entry's waveform starts from its beginning, so the waveforms
+ * should start at a zero crossing to avoid a click on every tone.
+ */
+
+/**
+ * Set up a tone sequencer
+ *
+ * \param seq The sequencer to set up (caller-owned)
+ * \param entries The ring of entries to queue tones in (caller-owned)
+ * \param n_entries How many entries there are; the queue holds one fewer
+ * \param idle The sample value to emit when not playing a tone
+ *
+ * \returns TONE_SEQ_OKAY or TONE_SEQ_INVALID_INPUTS
+ */
+tone_seq_status_t tone_seq_init(tone_seq_t *seq, tone_seq_entry_t *entries, uint16_t n_entries,
+                                uint16_t idle) {
+  if (!seq) return TONE_SEQ_INVALID_INPUTS;
+
+  memset(seq, 0, sizeof(tone_seq_t));
+
+  if (!entries || n_entries < 2) return TONE_SEQ_INVALID_INPUTS;
+
+  seq->entries = entries;
+  seq->n_entries = n_entries;
+  seq->idle = idle;
+
+  return TONE_SEQ_OKAY;
+}
+
+/**
+ * Queue up a tone
+ *
+ * \param seq The sequencer
+ * \param wave The waveform to loop, which must stay put until it's played
+ * \param wave_len The length of wave, in samples
+ * \param on_samples How long to play the tone, in samples
+ * \param off_samples How long to be quiet after it, in samples
+ *
+ * \returns TONE_SEQ_OKAY, TONE_SEQ_FULL, or TONE_SEQ_INVALID_INPUTS
+ *
+ * This is safe to call while tone_seq_fill() is running in an
+ * interrupt.  A pure gap (on_samples of 0) doesn't need a waveform.
+ */
+tone_seq_status_t tone_seq_push(tone_seq_t *seq, const uint16_t *wave, uint16_t wave_len,
+                                uint32_t on_samples, uint32_t off_samples) {
+  if (!seq || !seq->entries) return TONE_SEQ_INVALID_INPUTS;
+  if (on_samples && (!wave || 0 == wave_len)) return TONE_SEQ_INVALID_INPUTS;
+
+  const uint16_t tail = seq->tail;
+  const uint16_t next = (tail + 1) % seq->n_entries;
+  if (next == seq->head) return TONE_SEQ_FULL;
+
+  volatile tone_seq_entry_t *entry = &seq->entries[tail];
+  entry->wave = wave;
+  entry->wave_len = wave_len;
+  entry->on_samples = on_samples;
+  entry->off_samples = off_samples;
+
+  // Only now can tone_seq_fill() see it
+  seq->tail = next;
+
+  return TONE_SEQ_OKAY;
+}
+
+/**
+ * Render the next stretch of the sequence
+ *
+ * \param seq The sequencer
+ * \param buf Where to put the samples
+ * \param n How many samples to render
+ *
+ * This is meant to be called from a dac_fill_cb, which has to supply
+ * seq itself, eg:
+ *
+ *     static void dac_seq_fill(uint16_t *buf, uint16_t n) {
+ *       tone_seq_fill(&seq, buf, n);
+ *     }
+ */
+void tone_seq_fill(tone_seq_t *seq, uint16_t *buf, uint16_t n) {
+  uint32_t pos = seq->pos;
+  uint16_t wave_pos = seq->wave_pos;
+  uint16_t head = seq->head;
+
+  while (n > 0) {
+    if (head == seq->tail) {
+      // Nothing queued: idle out the rest of the buffer
+      while (n--) *buf++ = seq->idle;
+      break;
+    }
+
+    volatile tone_seq_entry_t *entry = &seq->entries[head];
+    const uint32_t on_samples = entry->on_samples;
+    const uint32_t total = on_samples + entry->off_samples;
+    uint32_t chunk;
+
+    if (pos < on_samples) {
+      const uint16_t *wave = entry->wave;
+      const uint16_t wave_len = entry->wave_len;
+
+      chunk = on_samples - pos;
+      if (chunk > n) chunk = n;
+
+      for (uint32_t i = 0; i < chunk; i++) {
+        *buf++ = wave[wave_pos];
+        if (++wave_pos == wave_len) wave_pos = 0;
+      }
+    } else {
+      chunk = total - pos;
+      if (chunk > n) chunk = n;
+
+      for (uint32_t i = 0; i < chunk; i++) *buf++ = seq->idle;
+    }
+
+    pos += chunk;
+    n -= chunk;
+
+    if (pos == total) {
+      head = (head + 1) % seq->n_entries;
+      seq->head = head;
+      seq->played++;
+      pos = 0;
+      wave_pos = 0;
+    }
+  }
+
+  seq->pos = pos;
+  seq->wave_pos = wave_pos;
+}
+
+/**
+ * How many entries are yet to finish playing
+ *
+ * \param seq The sequencer
+ *
+ * \returns The number of queued entries, including the one playing now
+ */
+uint16_t tone_seq_pending(const tone_seq_t *seq) {
+  if (!seq || !seq->entries) return 0;
+
+  return (seq->tail + seq->n_entries - seq->head) % seq->n_entries;
+}
+
+/**
+ * Drop everything in the queue
+ *
+ * \param seq The sequencer
+ *
+ * This moves head, so it must not race tone_seq_fill(): only call it
+ * with the DAC stopped.
+ */
+void tone_seq_clear(tone_seq_t *seq) {
+  if (!seq) return;
+
+  seq->head = seq->tail;
+  seq->pos = 0;
+  seq->wave_pos = 0;
+}
+
+/**
+ * Convert a duration to a sample count
+ *
+ * \param ms The duration, in milliseconds
+ * \param f_sample The sample rate
+ *
+ * \returns The number of samples, rounded to the nearest
+ */
+uint32_t tone_seq_ms_to_samples(float ms, float f_sample) {
+  if (!(ms > 0) || !(f_sample > 0)) return 0;
+
+  return (uint32_t)(ms * f_sample / 1000 + 0.5f);
+}
+
+/**
+ * Get a printable name for a tone_seq_status_t
+ *
+ * \param status The status to look up
+ *
+ * \returns A constant string, or NULL for unknown values
+ */
+const char *tone_seq_status_name(tone_seq_status_t status) {
+  switch(status) {
+  case TONE_SEQ_OKAY: return "OKAY";
+  case TONE_SEQ_INVALID_INPUTS: return "INVALID_INPUTS";
+  case TONE_SEQ_FULL: return "FULL";
+  default: return NULL;
+  }
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+/**
+ * \file tone_seq.h
+ * \brief Header for the tone sequencer
+ *
+ * \addtogroup tone_seq
+ * \{
+ */
+
+/**
+ * Status codes for the tone sequencer
+ */
+typedef enum tone_seq_status {
+				TONE_SEQ_OKAY = 0, //!< All went well
+				TONE_SEQ_INVALID_INPUTS, //!< NULL pointer or zero length
+				TONE_SEQ_FULL, //!< No room left in the queue
+} tone_seq_status_t;
+
+/**
+ * One tone in the sequence: a waveform to loop, then some silence
+ */
+typedef struct tone_seq_entry {
+  const uint16_t *wave; //!< Waveform to loop while the tone is on, in 12b samples
+  uint16_t wave_len; //!< Length of wave, in samples
+  uint32_t on_samples; //!< How long to play the tone, in samples
+  uint32_t off_samples; //!< How long to be quiet afterwards, in samples
+} tone_seq_entry_t;
+
+/**
+ * A queue of tones, played out by tone_seq_fill()
+ *
+ * These are caller-owned, as is the ring of entries.  tone_seq_push()
+ * is the only thing that moves tail, and tone_seq_fill() is the only
+ * thing that moves head, so one can run in an interrupt while the
+ * other runs in the main loop.
+ */
+typedef struct tone_seq {
+  volatile tone_seq_entry_t *entries; //!< The ring of queued tones
+  uint16_t n_entries; //!< Size of the ring (it holds one fewer than this)
+  uint16_t idle; //!< Sample value to emit when quiet
+
+  volatile uint16_t head; //!< The entry being played
+  volatile uint16_t tail; //!< Where the next tone_seq_push() goes
+
+  uint32_t pos; //!< Samples into the current entry
+  uint16_t wave_pos; //!< Samples into the current entry's waveform
+  volatile uint32_t played; //!< Entries completed since tone_seq_init()
+} tone_seq_t;
+
+tone_seq_status_t tone_seq_init(tone_seq_t *, tone_seq_entry_t *, uint16_t, uint16_t);
+tone_seq_status_t tone_seq_push(tone_seq_t *, const uint16_t *, uint16_t, uint32_t, uint32_t);
+void tone_seq_fill(tone_seq_t *, uint16_t *, uint16_t);
+uint16_t tone_seq_pending(const tone_seq_t *);
+void tone_seq_clear(tone_seq_t *);
+uint32_t tone_seq_ms_to_samples(float, float);
+const char *tone_seq_status_name(tone_seq_status_t);
+
+/** \} */ // End doxygen group
@@ -0,0 +1,291 @@
+#include "tx_queue.h"
+
+#include <string.h>
+
+/**
+ * \file tx_queue.c
+ * \brief A prioritized queue of frames waiting to be transmitted
+ *
+ * \defgroup tx_queue Transmit queue
+ * \addtogroup tx_queue
+ * \{
+ *
+ * Sending a packet used to mean spinning on the console USART for
+ * every byte of it: at 115200 baud, a 1kB packet ties the CPU up for
+ * about 90ms, even when called from an interrupt.  This instead
+ * queues up whole frames in RAM, so that sending one is a copy, and
+ * leaves it to the console's DMA to trickle them out.
+ *
+ * Frames are queued in one of a few priority classes, each with its
+ * own caller-owned ring.  Whenever the sender is ready for more, it
+ * takes from the most urgent class with anything waiting, but only
+ * ever switches classes between frames, so a control reply can jump
+ * ahead of a queue of logs without getting spliced into one.
+ *
+ * If a class's ring hasn't got room for a frame, the frame is
+ * dropped and counted (see tx_queue_get_stats()), rather than waiting.
+ * Callers that would rather wait can check tx_queue_room() first.
+ *
+ * To queue a frame, call tx_queue_begin(), then tx_queue_write() as
+ * many times as needed, then tx_queue_end(), which makes the frame
+ * visible to the sender.  The sender calls tx_queue_next_chunk() to
+ * find the next run of bytes to send, and tx_queue_chunk_done() once
+ * it's gone.
+ *
+ * There can be only one frame open for writing at a time, and none of
+ * this locks, so the caller needs to keep writers from interrupting
+ * each other or the sender.
+ */
+
+#define TX_QUEUE_LEN_BYTES 2 //!< Bytes of length stored ahead of each frame
+
+/**
+ * \brief (INTERNAL) How many bytes of a ring are in use, up to a cursor
+ */
+static uint16_t ring_used(const tx_queue_ring_t *ring, uint16_t cursor) {
+  return (cursor + ring->size - ring->head) % ring->size;
+}
+
+/**
+ * Set up an empty transmit queue
+ *
+ * \param q The queue to set up (caller-owned)
+ *
+ * \returns TX_QUEUE_OKAY or TX_QUEUE_INVALID_INPUTS
+ *
+ * Each class needs a ring from tx_queue_set_ring() before frames can
+ * be queued in it.
+ */
+tx_queue_status_t tx_queue_init(tx_queue_t *q) {
+  if (!q) return TX_QUEUE_INVALID_INPUTS;
+
+  memset(q, 0, sizeof(tx_queue_t));
+  q->open_prio = TX_QUEUE_N_PRIOS;
+  q->send_prio = TX_QUEUE_N_PRIOS;
+
+  return TX_QUEUE_OKAY;
+}
+
+/**
+ * Give a priority class its ring
+ *
+ * \param q The queue
+ * \param prio The class
+ * \param buf Memory for the ring (caller-owned)
+ * \param buflen Length of buf, which bounds how big a frame can be
+ *
+ * \returns TX_QUEUE_OKAY or TX_QUEUE_INVALID_INPUTS
+ */
+tx_queue_status_t tx_queue_set_ring(tx_queue_t *q, tx_queue_prio_t prio, uint8_t *buf, uint16_t buflen) {
+  if (!q || prio >= TX_QUEUE_N_PRIOS || !buf) return TX_QUEUE_INVALID_INPUTS;
+  if (buflen <= TX_QUEUE_LEN_BYTES) return TX_QUEUE_INVALID_INPUTS;
+
+  tx_queue_ring_t *ring = &q->rings[prio];
+  memset(ring, 0, sizeof(tx_queue_ring_t));
+  ring->buf = buf;
+  ring->size = buflen;
+
+  return TX_QUEUE_OKAY;
+}
+
+/**
+ * How big a frame a class has room for right now
+ *
+ * \param q The queue
+ * \param prio The class
+ *
+ * \returns The longest frame that tx_queue_begin() would accept
+ */
+uint16_t tx_queue_room(const tx_queue_t *q, tx_queue_prio_t prio) {
+  if (!q || prio >= TX_QUEUE_N_PRIOS) return 0;
+
+  const tx_queue_ring_t *ring = &q->rings[prio];
+  if (!ring->buf) return 0;
+
+  // One byte always stays empty, to tell full from empty
+  uint16_t unused = ring->size - 1 - ring_used(ring, ring->tail);
+  return (unused > TX_QUEUE_LEN_BYTES) ? unused - TX_QUEUE_LEN_BYTES : 0;
+}
+
+/**
+ * Start queueing a frame
+ *
+ * \param q The queue
+ * \param prio Which class to queue it in
+ * \param max_len The longest the frame could be
+ *
+ * \returns TX_QUEUE_OKAY, TX_QUEUE_FULL if there's not room for
+ * max_len (in which case the frame is counted as dropped),
+ * TX_QUEUE_BUSY, or TX_QUEUE_INVALID_INPUTS
+ */
+tx_queue_status_t tx_queue_begin(tx_queue_t *q, tx_queue_prio_t prio, uint16_t max_len) {
+  if (!q || prio >= TX_QUEUE_N_PRIOS || !q->rings[prio].buf) return TX_QUEUE_INVALID_INPUTS;
+  if (q->open_prio != TX_QUEUE_N_PRIOS) return TX_QUEUE_BUSY;
+
+  tx_queue_ring_t *ring = &q->rings[prio];
+
+  if (tx_queue_room(q, prio) < max_len) {
+    ring->stats.dropped++;
+    return TX_QUEUE_FULL;
+  }
+
+  q->open_prio = prio;
+  q->open_start = ring->tail;
+  q->open_cursor = (ring->tail + TX_QUEUE_LEN_BYTES) % ring->size;
+  q->open_overflow = false;
+
+  return TX_QUEUE_OKAY;
+}
+
+/**
+ * Add bytes to the frame being queued
+ *
+ * \param q The queue
+ * \param buf The bytes
+ * \param buflen How many
+ *
+ * If the frame runs out of room, the rest is discarded, and
+ * tx_queue_end() drops the whole frame.
+ */
+void tx_queue_write(tx_queue_t *q, const uint8_t *buf, uint16_t buflen) {
+  if (!q || q->open_prio == TX_QUEUE_N_PRIOS || q->open_overflow) return;
+
+  tx_queue_ring_t *ring = &q->rings[q->open_prio];
+
+  if (ring->size - 1 - ring_used(ring, q->open_cursor) < buflen) {
+    q->open_overflow = true;
+    return;
+  }
+
+  // At most two copies: up to the end of the ring, then from the start
+  uint16_t first = ring->size - q->open_cursor;
+  if (first > buflen) first = buflen;
+
+  memcpy(ring->buf + q->open_cursor, buf, first);
+  memcpy(ring->buf, buf + first, buflen - first);
+
+  q->open_cursor = (q->open_cursor + buflen) % ring->size;
+}
+
+/**
+ * Finish queueing a frame, and make it available to send
+ *
+ * \param q The queue
+ *
+ * \returns TX_QUEUE_OKAY, TX_QUEUE_OVERFLOW if the frame was dropped,
+ * or TX_QUEUE_INVALID_INPUTS if there's no frame open
+ */
+tx_queue_status_t tx_queue_end(tx_queue_t *q) {
+  if (!q || q->open_prio == TX_QUEUE_N_PRIOS) return TX_QUEUE_INVALID_INPUTS;
+
+  tx_queue_ring_t *ring = &q->rings[q->open_prio];
+  q->open_prio = TX_QUEUE_N_PRIOS;
+
+  if (q->open_overflow) {
+    ring->stats.dropped++;
+    return TX_QUEUE_OVERFLOW;
+  }
+
+  uint16_t len = (q->open_cursor + ring->size - q->open_start - TX_QUEUE_LEN_BYTES) % ring->size;
+  if (0 == len) return TX_QUEUE_OKAY;  // Nothing to send
+
+  ring->buf[q->open_start] = len >> 8;
+  ring->buf[(q->open_start + 1) % ring->size] = len & 0xFF;
+
+  // Only now can the sender see it
+  ring->tail = q->open_cursor;
+
+  ring->stats.queued++;
+  uint16_t used = ring_used(ring, ring->tail);
+  if (used > ring->stats.high_water) ring->stats.high_water = used;
+
+  return TX_QUEUE_OKAY;
+}
+
+/**
+ * Find the next run of bytes to send
+ *
+ * \param q The queue
+ * \param chunk[out] Where the run starts
+ *
+ * \returns How many bytes to send, or 0 if there's nothing waiting
+ *
+ * The run is contiguous in memory, so it can go straight to a DMA
+ * stream.  Until tx_queue_chunk_done() is called, this keeps
+ * returning the same run.
+ */
+uint16_t tx_queue_next_chunk(tx_queue_t *q, const uint8_t **chunk) {
+  if (!q || !chunk) return 0;
+
+  if (0 == q->send_rem) {
+    // Between frames: take the next one from the most urgent class
+    for (q->send_prio = 0; q->send_prio < TX_QUEUE_N_PRIOS; q->send_prio++) {
+      tx_queue_ring_t *ring = &q->rings[q->send_prio];
+      if (ring->buf && ring->head != ring->tail) break;
+    }
+    if (q->send_prio == TX_QUEUE_N_PRIOS) return 0;
+
+    tx_queue_ring_t *ring = &q->rings[q->send_prio];
+    q->send_rem = (ring->buf[ring->head] << 8) | ring->buf[(ring->head + 1) % ring->size];
+    ring->head = (ring->head + TX_QUEUE_LEN_BYTES) % ring->size;
+  }
+
+  tx_queue_ring_t *ring = &q->rings[q->send_prio];
+  uint16_t n = ring->size - ring->head;
+  if (n > q->send_rem) n = q->send_rem;
+
+  q->send_chunk = n;
+  *chunk = ring->buf + ring->head;
+  return n;
+}
+
+/**
+ * Mark the run from tx_queue_next_chunk() as sent
+ *
+ * \param q The queue
+ *
+ * This frees up its space in the ring.
+ */
+void tx_queue_chunk_done(tx_queue_t *q) {
+  if (!q || q->send_prio >= TX_QUEUE_N_PRIOS || 0 == q->send_chunk) return;
+
+  tx_queue_ring_t *ring = &q->rings[q->send_prio];
+  ring->head = (ring->head + q->send_chunk) % ring->size;
+  q->send_rem -= q->send_chunk;
+  q->send_chunk = 0;
+
+  if (0 == q->send_rem) ring->stats.sent++;
+}
+
+/**
+ * Get the accounting for a priority class
+ *
+ * \param q The queue
+ * \param prio The class
+ * \param stats[out] Where to put the statistics
+ */
+void tx_queue_get_stats(const tx_queue_t *q, tx_queue_prio_t prio, tx_queue_stats_t *stats) {
+  if (!q || prio >= TX_QUEUE_N_PRIOS || !stats) return;
+
+  *stats = q->rings[prio].stats;
+}
+
+/**
+ * Get a printable name for a tx_queue_status_t
+ *
+ * \param status The status to look up
+ *
+ * \returns A constant string, or NULL for unknown values
+ */
+const char *tx_queue_status_name(tx_queue_status_t status) {
+  switch(status) {
+  case TX_QUEUE_OKAY: return "OKAY";
+  case TX_QUEUE_INVALID_INPUTS: return "INVALID_INPUTS";
+  case TX_QUEUE_FULL: return "FULL";
+  case TX_QUEUE_BUSY: return "BUSY";
+  case TX_QUEUE_OVERFLOW: return "OVERFLOW";
+  default: return NULL;
+  }
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+/**
+ * \file tx_queue.h
+ * \brief Header for the prioritized transmit queue
+ *
+ * \addtogroup tx_queue
+ * \{
+ */
+
+/**
+ * Priority classes, most urgent first
+ */
+typedef enum tx_queue_prio {
+			    TX_PRIO_CONTROL = 0, //!< Replies to control commands
+			    TX_PRIO_DATA, //!< Bulk data, such as ADC captures
+			    TX_PRIO_LOG, //!< Log lines
+			    TX_QUEUE_N_PRIOS, //!< Number of priority classes
+} tx_queue_prio_t;
+
+/**
+ * Status codes for the transmit queue
+ */
+typedef enum tx_queue_status {
+			      TX_QUEUE_OKAY = 0, //!< All went well
+			      TX_QUEUE_INVALID_INPUTS, //!< NULL pointer, bad class, or no ring
+			      TX_QUEUE_FULL, //!< Not enough room for the frame, so it was dropped
+			      TX_QUEUE_BUSY, //!< A frame is already being written
+			      TX_QUEUE_OVERFLOW, //!< The frame outgrew the room left, so it was dropped
+} tx_queue_status_t;
+
+/**
+ * Accounting for one priority class
+ */
+typedef struct tx_queue_stats {
+  uint32_t queued; //!< Frames queued up
+  uint32_t sent; //!< Frames handed off in full
+  uint32_t dropped; //!< Frames dropped for lack of room
+  uint16_t high_water; //!< Most bytes ever waiting in the ring
+} tx_queue_stats_t;
+
+/**
+ * The ring of frames for one priority class
+ *
+ * Each frame is stored as a two byte length (big endian), then the
+ * frame itself, wrapping around the end of buf as need be.
+ */
+typedef struct tx_queue_ring {
+  uint8_t *buf; //!< The ring itself (caller-owned)
+  uint16_t size; //!< Length of buf
+  volatile uint16_t head; //!< Next byte to send
+  volatile uint16_t tail; //!< End of the last complete frame
+  tx_queue_stats_t stats; //!< See tx_queue_get_stats()
+} tx_queue_ring_t;
+
+/**
+ * A set of prioritized frame rings, drained in priority order a whole
+ * frame at a time
+ *
+ * These are caller-owned.
+ */
+typedef struct tx_queue {
+  tx_queue_ring_t rings[TX_QUEUE_N_PRIOS]; //!< One ring per class
+
+  uint8_t open_prio; //!< Class of the frame being written, or TX_QUEUE_N_PRIOS if none
+  uint16_t open_start; //!< Where its length goes
+  uint16_t open_cursor; //!< Where its next byte goes
+  bool open_overflow; //!< It ran out of room
+
+  uint8_t send_prio; //!< Class of the frame being sent
+  uint16_t send_rem; //!< Bytes of it left to hand off
+  uint16_t send_chunk; //!< Size of the chunk handed off, until tx_queue_chunk_done()
+} tx_queue_t;
+
+tx_queue_status_t tx_queue_init(tx_queue_t *);
+tx_queue_status_t tx_queue_set_ring(tx_queue_t *, tx_queue_prio_t, uint8_t *, uint16_t);
+uint16_t tx_queue_room(const tx_queue_t *, tx_queue_prio_t);
+tx_queue_status_t tx_queue_begin(tx_queue_t *, tx_queue_prio_t, uint16_t);
+void tx_queue_write(tx_queue_t *, const uint8_t *, uint16_t);
+tx_queue_status_t tx_queue_end(tx_queue_t *);
+uint16_t tx_queue_next_chunk(tx_queue_t *, const uint8_t **);
+void tx_queue_chunk_done(tx_queue_t *);
+void tx_queue_get_stats(const tx_queue_t *, tx_queue_prio_t, tx_queue_stats_t *);
+const char *tx_queue_status_name(tx_queue_status_t);
+
+/** \} */ // End doxygen group
@@ -0,0 +1,175 @@
+#include "wave_cache.h"
+
+#include <string.h>
+
+#include "dtmf.h"
+#include "sin_gen.h"
+
+/**
+ * \file wave_cache.c
+ * \brief A cache of precomputed DTMF waveforms
+ *
+ * \defgroup wave_cache DTMF waveform cache
+ * \addtogroup wave_cache
+ * \{
+ *
+ * Every time we send a digit, we need the DAC to play a new pair of
+ * tones.  Generating them takes a while, and the set of waveforms we
+ * could ever need is small: sixteen symbols, at whatever rate the DAC
+ * is running.  So this generates all of them once, and afterwards
+ * switching digits is just a matter of pointing the DAC's DMA at a
+ * different buffer.  The waveforms are 12b, for dac_setup12().
+ *
+ * The caller provides the memory (the pool) for the waveforms, which
+ * puts a hard bound on how much RAM this takes.  Each waveform gets at
+ * most max_len samples, and wave_cache_build() fails with
+ * WAVE_CACHE_NO_ROOM if they won't all fit.
+ *
+ * The DAC loops the buffer around, so any phase error at the end of
+ * the buffer is a glitch that repeats.  If trim is set, each waveform
+ * is cut down to the length sin_gen_plan_loop() picks: the shortest
+ * one where the two tones come closest to whole numbers of cycles.
+ * This makes for cleaner tones, and leaves a good chunk of the pool
+ * unused.
+ */
+
+static const uint8_t wave_cache_symbols[] = "123A456B789C*0#D"; //!< The symbols, in cache order
+
+/**
+ * Set up a waveform cache
+ *
+ * \param cache The cache to set up (caller-owned)
+ * \param pool The memory to keep the waveforms in (caller-owned)
+ * \param pool_len How big the pool is, in samples
+ * \param max_len The longest waveform to generate for any one symbol
+ * \param amplitude Amplitude of each tone, as a fraction of full
+ * scale (the two together must be at most 1)
+ * \param trim Whether to shorten the waveforms so they loop cleanly
+ *
+ * \returns WAVE_CACHE_OKAY or WAVE_CACHE_INVALID_INPUTS
+ *
+ * This doesn't generate anything yet: see wave_cache_build().
+ */
+wave_cache_status_t wave_cache_init(wave_cache_t *cache, uint16_t *pool, uint32_t pool_len,
+                                    uint16_t max_len, float amplitude, bool trim) {
+  if (!cache) return WAVE_CACHE_INVALID_INPUTS;
+
+  memset(cache, 0, sizeof(wave_cache_t));
+
+  if (!pool || 0 == pool_len || 0 == max_len) return WAVE_CACHE_INVALID_INPUTS;
+  if (!(amplitude > 0) || amplitude > 0.5f) return WAVE_CACHE_INVALID_INPUTS;
+
+  cache->pool = pool;
+  cache->pool_len = pool_len;
+  cache->max_len = max_len;
+  cache->amplitude = amplitude;
+  cache->trim = trim;
+
+  return WAVE_CACHE_OKAY;
+}
+
+/**
+ * Generate all the waveforms for a sample rate
+ *
+ * \param cache The cache, set up by wave_cache_init()
+ * \param f_sample The DAC's sample rate
+ *
+ * \returns WAVE_CACHE_OKAY on success, WAVE_CACHE_NO_ROOM if the pool
+ * is too small, or WAVE_CACHE_GENERATION_FAILED if the sample rate is
+ * too low for the tones.  On error, the cache is left empty.
+ *
+ * If the cache was already built for this sample rate, this returns
+ * straight away, so it's cheap to call before every use.
+ */
+wave_cache_status_t wave_cache_build(wave_cache_t *cache, uint32_t f_sample) {
+  if (!cache || !cache->pool || 0 == f_sample) return WAVE_CACHE_INVALID_INPUTS;
+
+  if (cache->f_sample == f_sample) return WAVE_CACHE_OKAY;
+
+  cache->f_sample = 0;
+  cache->pool_used = 0;
+
+  for (int i = 0; i < WAVE_CACHE_N_SYMBOLS; i++) {
+    wave_cache_entry_t *entry = &cache->entries[i];
+    float f_row, f_col;
+
+    dtmf_get_tones(wave_cache_symbols[i], &f_row, &f_col);
+
+    uint16_t len = cache->max_len;
+    if (cache->trim) {
+      const float f_tones[2] = { f_row, f_col };
+      // TOO_SHORT still gives us max_len, which is what we'd use untrimmed
+      sin_gen_result_t res = sin_gen_plan_loop(f_tones, 2, f_sample, cache->max_len, &len, NULL);
+      if (SIN_GEN_OKAY != res && SIN_GEN_TOO_SHORT != res) {
+        return WAVE_CACHE_GENERATION_FAILED;
+      }
+    }
+
+    if (cache->pool_used + len > cache->pool_len) return WAVE_CACHE_NO_ROOM;
+
+    const sin_gen_component_t tones[2] = {
+      { .f_tone = f_row, .amplitude = cache->amplitude, .theta0 = SIN_THETA0 },
+      { .f_tone = f_col, .amplitude = cache->amplitude, .theta0 = SIN_THETA0 },
+    };
+
+    entry->symbol = wave_cache_symbols[i];
+    entry->buf = cache->pool + cache->pool_used;
+    entry->len = len;
+
+    if (SIN_GEN_OKAY != sin_gen_generate_multi12(entry->buf, len, f_sample, tones, 2)) {
+      return WAVE_CACHE_GENERATION_FAILED;
+    }
+
+    cache->pool_used += len;
+  }
+
+  cache->f_sample = f_sample;
+  return WAVE_CACHE_OKAY;
+}
+
+/**
+ * Get the waveform for a symbol
+ *
+ * \param cache The cache, built by wave_cache_build()
+ * \param symbol The DTMF symbol to look up
+ * \param buf[out] The waveform
+ * \param len[out] Its length, in samples
+ *
+ * \returns WAVE_CACHE_OKAY, WAVE_CACHE_NOT_BUILT, or WAVE_CACHE_SYMBOL_NOT_FOUND
+ */
+wave_cache_status_t wave_cache_get(const wave_cache_t *cache, uint8_t symbol,
+                                   const uint16_t **buf, uint16_t *len) {
+  if (!cache || !buf || !len) return WAVE_CACHE_INVALID_INPUTS;
+  if (0 == cache->f_sample) return WAVE_CACHE_NOT_BUILT;
+
+  for (int i = 0; i < WAVE_CACHE_N_SYMBOLS; i++) {
+    if (cache->entries[i].symbol == symbol) {
+      *buf = cache->entries[i].buf;
+      *len = cache->entries[i].len;
+      return WAVE_CACHE_OKAY;
+    }
+  }
+
+  return WAVE_CACHE_SYMBOL_NOT_FOUND;
+}
+
+/**
+ * Get a printable name for a wave_cache_status_t
+ *
+ * \param status The status to look up
+ *
+ * \returns A constant string, or NULL for unknown values
+ */
+const char *wave_cache_status_name(wave_cache_status_t status) {
+  switch(status) {
+  case WAVE_CACHE_OKAY: return "OKAY";
+  case WAVE_CACHE_INVALID_INPUTS: return "INVALID_INPUTS";
+  case WAVE_CACHE_NO_ROOM: return "NO_ROOM";
+  case WAVE_CACHE_NOT_BUILT: return "NOT_BUILT";
+  case WAVE_CACHE_SYMBOL_NOT_FOUND: return "SYMBOL_NOT_FOUND";
+  case WAVE_CACHE_GENERATION_FAILED: return "GENERATION_FAILED";
+  default: return NULL;
+  }
+}
+
+/** \} */ // End doxygen group
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+/**
+ * \file wave_cache.h
+ * \brief Header for the DTMF waveform cache
+ *
+ * \addtogroup wave_cache
+ * \{
+ */
+
+#define WAVE_CACHE_N_SYMBOLS 16 //!< Number of DTMF symbols, and so waveforms, in a cache
+
+/**
+ * Status codes for the waveform cache
+ */
+typedef enum wave_cache_status {
+				WAVE_CACHE_OKAY = 0, //!< All went well
+				WAVE_CACHE_INVALID_INPUTS, //!< NULL pointer or zero length
+				WAVE_CACHE_NO_ROOM, //!< The waveforms don't all fit in the pool
+				WAVE_CACHE_NOT_BUILT, //!< wave_cache_build() hasn't succeeded yet
+				WAVE_CACHE_SYMBOL_NOT_FOUND, //!< Not a DTMF symbol
+				WAVE_CACHE_GENERATION_FAILED, //!< sin_gen didn't like the sample rate
+} wave_cache_status_t;
+
+/**
+ * One symbol's waveform, somewhere in the cache's pool
+ */
+typedef struct wave_cache_entry {
+  uint8_t symbol; //!< The DTMF symbol
+  uint16_t *buf; //!< Its waveform, in 12b samples
+  uint16_t len; //!< How long the waveform is, in samples
+} wave_cache_entry_t;
+
+/**
+ * A cache of all sixteen DTMF waveforms at one sample rate
+ *
+ * These are caller-owned, as is the pool of memory the waveforms
+ * live in: the pool's size is the cache's whole memory budget.
+ */
+typedef struct wave_cache {
+  uint16_t *pool; //!< Where the waveforms go
+  uint32_t pool_len; //!< How big the pool is, in samples
+  uint16_t max_len; //!< Longest waveform to generate per symbol
+  float amplitude; //!< Amplitude of each tone, as a fraction of full scale
+  bool trim; //!< Shorten each waveform to where it loops most cleanly
+
+  uint32_t f_sample; //!< Sample rate the cache was built for, or 0 if not built
+  uint32_t pool_used; //!< How much of the pool the waveforms take up
+  wave_cache_entry_t entries[WAVE_CACHE_N_SYMBOLS]; //!< The waveforms
+} wave_cache_t;
+
+wave_cache_status_t wave_cache_init(wave_cache_t *, uint16_t *, uint32_t, uint16_t, float, bool);
+wave_cache_status_t wave_cache_build(wave_cache_t *, uint32_t);
+wave_cache_status_t wave_cache_get(const wave_cache_t *, uint8_t, const uint16_t **, uint16_t *);
+const char *wave_cache_status_name(wave_cache_status_t);
+
+/** \} */ // End doxygen group
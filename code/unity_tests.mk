@@ -68,6 +68,11 @@ $(PATHB)test_%.$(TARGET_EXTENSION):  $(PATHO)test_%.o $(PATHO)%.o $(PATHU)unity.
 	$(LINK) -o $@ $^ -lm
 # Note janky addition of -lm above for the DTMF tests
 
+# Tests that need more than their own module list the extra objects here
+$(PATHB)test_dtmf.$(TARGET_EXTENSION): $(PATHO)goertzel.o
+$(PATHB)test_decimate.$(TARGET_EXTENSION): $(PATHO)dtmf.o $(PATHO)goertzel.o
+$(PATHB)test_wave_cache.$(TARGET_EXTENSION): $(PATHO)dtmf.o $(PATHO)goertzel.o $(PATHO)sin_gen.o
+
 $(PATHO)%.o:: $(PATHT)%.c
 	$(COMPILE) $(CFLAGS) $< -o $@
 